@@ -0,0 +1,138 @@
+#pragma once
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <type_traits>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace oguna
+{
+	/// 擪AlignmentoCgEɂ낦Œ蒷z
+	/// SIMDł̂܂ܓǂ߂悤Ƀ[߂̗]
+	template<typename T, size_t Alignment = 32>
+	class AlignedArray
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "AlignedArray requires trivially copyable type");
+	protected:
+		T *data;
+		size_t size;
+
+		static size_t PaddedBytes(size_t count)
+		{
+			return ((sizeof(T) * count + Alignment - 1) / Alignment) * Alignment;
+		}
+
+	public:
+		AlignedArray()
+			: data(nullptr)
+			, size(0)
+		{}
+
+		explicit AlignedArray(size_t count)
+			: data(nullptr)
+			, size(0)
+		{
+			Resize(count);
+		}
+
+		~AlignedArray()
+		{
+			Clear();
+		}
+
+		AlignedArray(const AlignedArray&) = delete;
+		AlignedArray& operator=(const AlignedArray&) = delete;
+
+		AlignedArray(AlignedArray &&other)
+			: data(other.data)
+			, size(other.size)
+		{
+			other.data = nullptr;
+			other.size = 0;
+		}
+
+		AlignedArray& operator=(AlignedArray &&other)
+		{
+			if (this != &other)
+			{
+				Clear();
+				data = other.data;
+				size = other.size;
+				other.data = nullptr;
+				other.size = 0;
+			}
+			return *this;
+		}
+
+		/// countvfmۂă[Ŗ߂(ȑO̓e͔j)
+		void Resize(size_t count)
+		{
+			Clear();
+			if (count == 0)
+			{
+				return;
+			}
+			size_t bytes = PaddedBytes(count);
+#ifdef _WIN32
+			void *memory = ::_aligned_malloc(bytes, Alignment);
+#else
+			void *memory = nullptr;
+			if (::posix_memalign(&memory, Alignment, bytes) != 0)
+			{
+				memory = nullptr;
+			}
+#endif
+			if (memory == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+			memset(memory, 0, bytes);
+			data = (T*) memory;
+			size = count;
+		}
+
+		/// 
+		void Clear()
+		{
+			if (data)
+			{
+#ifdef _WIN32
+				::_aligned_free(data);
+#else
+				::free(data);
+#endif
+			}
+			data = nullptr;
+			size = 0;
+		}
+
+		/// vf
+		size_t Size() const
+		{
+			return size;
+		}
+
+		T* Data()
+		{
+			return data;
+		}
+
+		const T* Data() const
+		{
+			return data;
+		}
+
+		T& operator[](size_t index)
+		{
+			return data[index];
+		}
+
+		const T& operator[](size_t index) const
+		{
+			return data[index];
+		}
+	};
+}
\ No newline at end of file
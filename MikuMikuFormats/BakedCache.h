@@ -0,0 +1,359 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MappedFile.h"
+#include "AlignedArray.h"
+
+namespace oguna
+{
+	/// Cũo[W
+	/// LbV̌`AfE[Vϊʂςグ(ÂLbV͎gȂȂ)
+	const uint32_t LibraryVersion = 1;
+
+	/// LbV̎
+	enum class BakedKind : uint32_t
+	{
+		Model = 1,
+		Motion = 2,
+	};
+
+	/// oCg64bitnbV(xxHash64Ɠ菇)
+	inline uint64_t HashBytes(const char *data, size_t size, uint64_t seed = 0)
+	{
+		const uint64_t prime1 = 11400714785074694791ULL;
+		const uint64_t prime2 = 14029467366897019727ULL;
+		const uint64_t prime3 = 1609587929392839161ULL;
+		const uint64_t prime4 = 9650029242287828579ULL;
+		const uint64_t prime5 = 2870177450012600261ULL;
+		auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+		auto round = [&](uint64_t acc, uint64_t input) { acc += input * prime2; acc = rotl(acc, 31); return acc * prime1; };
+		auto read64 = [](const char *p) { uint64_t v; memcpy(&v, p, 8); return v; };
+		const char *p = data;
+		const char *end = data + size;
+		uint64_t h;
+		if (size >= 32)
+		{
+			uint64_t v[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+			for (; end - p >= 32; p += 32)
+			{
+				v[0] = round(v[0], read64(p));
+				v[1] = round(v[1], read64(p + 8));
+				v[2] = round(v[2], read64(p + 16));
+				v[3] = round(v[3], read64(p + 24));
+			}
+			h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+			for (int i = 0; i < 4; i++)
+			{
+				h ^= round(0, v[i]);
+				h = h * prime1 + prime4;
+			}
+		}
+		else
+		{
+			h = seed + prime5;
+		}
+		h += (uint64_t) size;
+		for (; end - p >= 8; p += 8)
+		{
+			h ^= round(0, read64(p));
+			h = rotl(h, 27) * prime1 + prime4;
+		}
+		if (end - p >= 4)
+		{
+			uint32_t v;
+			memcpy(&v, p, 4);
+			h ^= (uint64_t) v * prime1;
+			h = rotl(h, 23) * prime2 + prime3;
+			p += 4;
+		}
+		for (; p < end; p++)
+		{
+			h ^= (uint64_t) (uint8_t) *p * prime5;
+			h = rotl(h, 11) * prime1;
+		}
+		h ^= h >> 33;
+		h *= prime2;
+		h ^= h >> 29;
+		h *= prime3;
+		h ^= h >> 32;
+		return h;
+	}
+
+	/// LbṼwb_
+	/// ɐ߂̕\(BakedSection*section_count)ƁAAlignmentoCgEɂ낦߂̃f[^
+	/// ʒuׂ͂ăLbV̐擪̃oCgȂ̂ŁAǂɃ}bvĂ̂܂܎g
+	struct BakedHeader
+	{
+		char magic[8];
+		uint32_t library_version;
+		BakedKind kind;
+		/// ̃t@C̃nbVƃoCg
+		uint64_t source_hash;
+		uint64_t source_size;
+		/// LbVŜ̃oCg
+		uint64_t total_size;
+		uint32_t section_count;
+		uint32_t reserved;
+	};
+
+	/// (z)̈ʒu
+	struct BakedSection
+	{
+		uint32_t id;
+		uint32_t element_size;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	/// z߂ƂĕׂLbVgݗĂ
+	class BakedWriter
+	{
+	public:
+		/// ߂̃f[^̋E(AlignedArrayƓ)
+		static const size_t Alignment = 32;
+
+		/// ߂ǉ(vf͂̂܂܃Rs[ł^Ɍ)
+		template<typename T>
+		void Add(uint32_t id, const T *data, size_t count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "baked arrays must be trivially copyable");
+			BakedSection section;
+			section.id = id;
+			section.element_size = (uint32_t) sizeof(T);
+			section.offset = (uint64_t) body.size();
+			section.size = (uint64_t) (count * sizeof(T));
+			sections.push_back(section);
+			size_t padded = (body.size() + section.size + Alignment - 1) / Alignment * Alignment;
+			size_t begin = body.size();
+			body.resize(padded, 0);
+			if (count)
+			{
+				memcpy(&body[begin], data, count * sizeof(T));
+			}
+		}
+
+		template<typename T>
+		void Add(uint32_t id, const std::vector<T> &data)
+		{
+			Add(id, data.data(), data.size());
+		}
+
+		void Add(uint32_t id, const std::string &data)
+		{
+			Add(id, data.data(), data.size());
+		}
+
+		template<typename T>
+		void Add(uint32_t id, const AlignedArray<T> &data)
+		{
+			Add(id, data.Data(), data.Size());
+		}
+
+		/// wb_Ɛ߂̕\tĈ̃oCgɂ
+		std::vector<char> Finish(BakedKind kind, uint64_t source_hash, uint64_t source_size) const
+		{
+			size_t table = sizeof(BakedHeader) + sections.size() * sizeof(BakedSection);
+			size_t data_begin = (table + Alignment - 1) / Alignment * Alignment;
+			std::vector<char> result(data_begin + body.size(), 0);
+			BakedHeader header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, "MMFBAKE", 8);
+			header.library_version = LibraryVersion;
+			header.kind = kind;
+			header.source_hash = source_hash;
+			header.source_size = source_size;
+			header.total_size = (uint64_t) result.size();
+			header.section_count = (uint32_t) sections.size();
+			memcpy(result.data(), &header, sizeof(header));
+			for (size_t i = 0; i < sections.size(); i++)
+			{
+				BakedSection section = sections[i];
+				section.offset += data_begin;
+				memcpy(&result[sizeof(BakedHeader) + i * sizeof(BakedSection)], &section, sizeof(section));
+			}
+			if (!body.empty())
+			{
+				memcpy(&result[data_begin], body.data(), body.size());
+			}
+			return result;
+		}
+
+		/// t@Cɏo
+		/// rŎsĂꂽLbVcȂ悤ɁAꎞt@CɏĂu
+		bool Save(const char *filename, BakedKind kind, uint64_t source_hash, uint64_t source_size) const
+		{
+			std::vector<char> blob = Finish(kind, source_hash, source_size);
+			std::string temporary = std::string(filename) + ".tmp";
+			{
+				std::ofstream stream(temporary.c_str(), std::ios::binary | std::ios::trunc);
+				if (!stream.write(blob.data(), blob.size()))
+				{
+					return false;
+				}
+			}
+			::remove(filename);
+			return ::rename(temporary.c_str(), filename) == 0;
+		}
+
+	private:
+		std::vector<BakedSection> sections;
+		/// ߂̃f[^(߂̕\̕)
+		std::vector<char> body;
+	};
+
+	/// LbVǂ
+	/// ߂̃f[^̓}bv܂܂̃oCgŵŁAvfƂɉ͂ɎQƂRs[ł
+	class BakedFile
+	{
+	public:
+		BakedFile()
+			: data(nullptr)
+			, size(0)
+		{}
+
+		BakedFile(const BakedFile&) = delete;
+		BakedFile& operator=(const BakedFile&) = delete;
+
+		/// LbVt@C}bvAށECũo[WẼt@C̃nbVƃoCgv邩m߂
+		bool Open(const char *filename, BakedKind kind, uint64_t source_hash, uint64_t source_size)
+		{
+			data = nullptr;
+			size = 0;
+			if (!file.Open(filename))
+			{
+				return false;
+			}
+			return Open(file.Data(), file.Size(), kind, source_hash, source_size);
+		}
+
+		/// ĂяoLoCgǂ(擪AlignmentoCgEɂĂ邱)
+		bool Open(const char *bytes, size_t byte_count, BakedKind kind, uint64_t source_hash, uint64_t source_size)
+		{
+			data = nullptr;
+			size = 0;
+			if (bytes == nullptr || byte_count < sizeof(BakedHeader))
+			{
+				return false;
+			}
+			BakedHeader header;
+			memcpy(&header, bytes, sizeof(header));
+			if (memcmp(header.magic, "MMFBAKE", 8) != 0
+				|| header.library_version != LibraryVersion
+				|| header.kind != kind
+				|| header.source_hash != source_hash
+				|| header.source_size != source_size
+				|| header.total_size != byte_count
+				|| (byte_count - sizeof(BakedHeader)) / sizeof(BakedSection) < header.section_count)
+			{
+				return false;
+			}
+			const BakedSection *table = (const BakedSection*) (bytes + sizeof(BakedHeader));
+			for (uint32_t i = 0; i < header.section_count; i++)
+			{
+				if (table[i].offset > byte_count || table[i].size > byte_count - table[i].offset
+					|| table[i].offset % BakedWriter::Alignment != 0)
+				{
+					return false;
+				}
+			}
+			data = bytes;
+			size = byte_count;
+			return true;
+		}
+
+		bool IsOpen() const
+		{
+			return data != nullptr;
+		}
+
+		/// id̐擪Ɨvf(vf̑傫ႤȂnullptr)
+		template<typename T>
+		const T* Section(uint32_t id, size_t *count) const
+		{
+			const BakedSection *section = Find(id);
+			if (section == nullptr || section->element_size != sizeof(T))
+			{
+				*count = 0;
+				return nullptr;
+			}
+			*count = (size_t) (section->size / sizeof(T));
+			return (const T*) (data + section->offset);
+		}
+
+		/// idzɃRs[
+		template<typename T>
+		bool Read(uint32_t id, std::vector<T> *out) const
+		{
+			size_t count;
+			const T *p = Section<T>(id, &count);
+			if (p == nullptr)
+			{
+				return false;
+			}
+			out->assign(p, p + count);
+			return true;
+		}
+
+		bool Read(uint32_t id, std::string *out) const
+		{
+			size_t count;
+			const char *p = Section<char>(id, &count);
+			if (p == nullptr)
+			{
+				return false;
+			}
+			out->assign(p, count);
+			return true;
+		}
+
+		template<typename T>
+		bool Read(uint32_t id, AlignedArray<T> *out) const
+		{
+			size_t count;
+			const T *p = Section<T>(id, &count);
+			if (p == nullptr)
+			{
+				return false;
+			}
+			if (out->Size() != count)
+			{
+				out->Resize(count);
+			}
+			if (count)
+			{
+				memcpy(out->Data(), p, count * sizeof(T));
+			}
+			return true;
+		}
+
+	private:
+		MappedFile file;
+		const char *data;
+		size_t size;
+
+		const BakedSection* Find(uint32_t id) const
+		{
+			if (data == nullptr)
+			{
+				return nullptr;
+			}
+			BakedHeader header;
+			memcpy(&header, data, sizeof(header));
+			const BakedSection *table = (const BakedSection*) (data + sizeof(BakedHeader));
+			for (uint32_t i = 0; i < header.section_count; i++)
+			{
+				if (table[i].id == id)
+				{
+					return &table[i];
+				}
+			}
+			return nullptr;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace oguna
+{
+	/// oCg擪ǂݐi߂鋫E`FbNtJ[\
+	/// ̃oCĝ܂ܓǂނAstd::istream傫ȓobt@oRœǂ
+	class BinaryReader
+	{
+	protected:
+		const char *begin;
+		const char *cursor;
+		const char *end;
+		/// ̓Xg[(̃oCgǂޏꍇnullptr)
+		std::istream *stream;
+		/// Xg[ǂݍݗpobt@
+		std::vector<char> buffer;
+		/// obt@擪̃Xg[̈ʒu
+		size_t buffer_offset;
+
+		/// c肪sizeoCgȂ[AłȂΗO𓊂
+		void Require(size_t size)
+		{
+			if ((size_t) (end - cursor) < size && !Fill(size))
+			{
+				throw "unexpected end of data";
+			}
+		}
+
+		/// ȂƂsizeoCgǂ߂悤ɃXg[obt@[
+		bool Fill(size_t size)
+		{
+			if (stream == nullptr)
+			{
+				return false;
+			}
+			size_t remain = end - cursor;
+			buffer_offset += cursor - begin;
+			if (buffer.size() < size)
+			{
+				std::vector<char> grown(size);
+				if (remain > 0)
+				{
+					memcpy(grown.data(), cursor, remain);
+				}
+				buffer.swap(grown);
+			}
+			else if (remain > 0)
+			{
+				memmove(buffer.data(), cursor, remain);
+			}
+			stream->read(buffer.data() + remain, buffer.size() - remain);
+			begin = cursor = buffer.data();
+			end = begin + remain + (size_t) stream->gcount();
+			return (size_t) (end - cursor) >= size;
+		}
+
+	public:
+		/// ĂяoLoCgǂރJ[\쐬
+		BinaryReader(const void *data, size_t size)
+			: begin((const char*) data)
+			, cursor((const char*) data)
+			, end((const char*) data + size)
+			, stream(nullptr)
+			, buffer_offset(0)
+		{}
+
+		/// Xg[buffer_sizeoCg܂Ƃ߂ēǂރJ[\쐬
+		BinaryReader(std::istream *stream, size_t buffer_size = 1 << 16)
+			: begin(nullptr)
+			, cursor(nullptr)
+			, end(nullptr)
+			, stream(stream)
+			, buffer(buffer_size)
+			, buffer_offset(0)
+		{}
+
+		/// ǂ݉߂Xg[̈ʒu߂
+		~BinaryReader()
+		{
+			if (stream && cursor != end)
+			{
+				stream->clear();
+				stream->seekg(-(std::streamoff) (end - cursor), std::ios::cur);
+			}
+		}
+
+		BinaryReader(const BinaryReader&) = delete;
+		BinaryReader& operator=(const BinaryReader&) = delete;
+
+		/// 擪̈ʒu
+		size_t Position() const
+		{
+			return buffer_offset + (cursor - begin);
+		}
+
+		/// obt@ɎcĂoCg
+		size_t Remain() const
+		{
+			return end - cursor;
+		}
+
+		/// I[ɒBǂ
+		bool Eof()
+		{
+			return cursor == end && !Fill(1);
+		}
+
+		/// lǂݍ
+		template<typename T>
+		T Read()
+		{
+			Require(sizeof(T));
+			T value;
+			memcpy(&value, cursor, sizeof(T));
+			cursor += sizeof(T);
+			return value;
+		}
+
+		/// Œ蒷̒lcount܂Ƃ߂ēǂݍ
+		template<typename T>
+		void Read(T *out, size_t count)
+		{
+			size_t size = sizeof(T) * count;
+			if ((size_t) (end - cursor) < size && stream && size > buffer.size())
+			{
+				// obt@傫ꍇ̓Xg[璼ړǂ
+				size_t remain = end - cursor;
+				if (remain > 0)
+				{
+					memcpy(out, cursor, remain);
+				}
+				buffer_offset += end - begin;
+				begin = cursor = end = buffer.data();
+				stream->read((char*) out + remain, size - remain);
+				buffer_offset += (size_t) stream->gcount();
+				if ((size_t) stream->gcount() != size - remain)
+				{
+					throw "unexpected end of data";
+				}
+				return;
+			}
+			Require(size);
+			if (size)
+			{
+				memcpy(out, cursor, size);
+			}
+			cursor += size;
+		}
+
+		/// sizeoCgRs[ɂ̏ŎQƂ
+		/// Xg[ǂޏꍇAQƂ͎̓ǂݍ݂܂ŗL
+		const char* View(size_t size)
+		{
+			Require(size);
+			const char *result = cursor;
+			cursor += size;
+			return result;
+		}
+
+		/// sizeoCgǂݔ΂
+		void Skip(size_t size)
+		{
+			while ((size_t) (end - cursor) < size && stream)
+			{
+				size -= end - cursor;
+				cursor = end;
+				if (!Fill(1))
+				{
+					throw "unexpected end of data";
+				}
+			}
+			Require(size);
+			cursor += size;
+		}
+
+		/// NULLI[̌Œ蒷ǂݍ
+		std::string ReadFixedString(size_t size)
+		{
+			const char *data = View(size);
+			const char *terminal = (const char*) memchr(data, '\0', size);
+			return std::string(data, terminal ? terminal : data + size);
+		}
+	};
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace oguna
+{
+	/// oCg𖖔֏Ăo̓obt@
+	/// ŜɑgݗĂ邩Astd::ostream֑傫Ȃ܂Ƃ܂育Ƃɏo
+	class BinaryWriter
+	{
+	protected:
+		/// ݗpobt@(size()͊mۍς݂̃oCg)
+		std::vector<char> buffer;
+		/// obt@̏ݍς݃oCg
+		size_t used;
+		/// o̓Xg[(ɑgݗĂꍇnullptr)
+		std::ostream *stream;
+		/// ̃oCg𒴂Xg[֏o
+		size_t flush_size;
+		/// Xg[֏ooCg
+		size_t flushed;
+		/// Xg[ւ̏oɎsǂ
+		bool failed;
+
+		/// sizeoCg̗̈mۂĐ擪Ԃ
+		char* Grow(size_t size)
+		{
+			if (stream && used > 0 && used + size > flush_size)
+			{
+				Flush();
+			}
+			if (buffer.size() - used < size)
+			{
+				size_t capacity = buffer.size() * 2;
+				if (capacity < used + size)
+				{
+					capacity = used + size;
+				}
+				buffer.resize(capacity);
+			}
+			char *result = buffer.data() + used;
+			used += size;
+			return result;
+		}
+
+	public:
+		/// ɑgݗĂobt@쐬
+		explicit BinaryWriter(size_t capacity = 0)
+			: buffer(capacity)
+			, used(0)
+			, stream(nullptr)
+			, flush_size(0)
+			, flushed(0)
+			, failed(false)
+		{}
+
+		/// flush_sizeoCg܂Ƃ߂ăXg[֏oobt@쐬
+		BinaryWriter(std::ostream *stream, size_t flush_size = 1 << 20)
+			: buffer(flush_size)
+			, used(0)
+			, stream(stream)
+			, flush_size(flush_size)
+			, flushed(0)
+			, failed(false)
+		{}
+
+		/// cXg[֏o
+		~BinaryWriter()
+		{
+			Flush();
+		}
+
+		BinaryWriter(const BinaryWriter&) = delete;
+		BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+		/// 擪̈ʒu
+		size_t Position() const
+		{
+			return flushed + used;
+		}
+
+		/// ȂƂsizeoCg߂悤ɊmۂĂ
+		void Reserve(size_t size)
+		{
+			if (buffer.size() - used < size)
+			{
+				buffer.resize(used + size);
+			}
+		}
+
+		/// l
+		template<typename T>
+		void Write(const T &value)
+		{
+			memcpy(Grow(sizeof(T)), &value, sizeof(T));
+		}
+
+		/// Œ蒷̒lcount܂Ƃ߂ď
+		template<typename T>
+		void Write(const T *values, size_t count)
+		{
+			size_t size = sizeof(T) * count;
+			if (size)
+			{
+				memcpy(Grow(size), values, size);
+			}
+		}
+
+		/// sizeoCg̗̈𖖔ɒǉĐ擪Ԃ(݂̏܂ŗL)
+		char* Append(size_t size)
+		{
+			return Grow(size);
+		}
+
+		/// sizeoCg0
+		void WriteZero(size_t size)
+		{
+			if (size)
+			{
+				memset(Grow(size), 0, size);
+			}
+		}
+
+		/// Œ蒷̕(ΐ؂l߁AZ0Ŗ߂)
+		void WriteFixedString(const std::string &value, size_t size)
+		{
+			char *out = Grow(size);
+			size_t length = value.size() < size ? value.size() : size;
+			memcpy(out, value.data(), length);
+			memset(out + length, 0, size - length);
+		}
+
+		/// obt@̓eXg[֏o
+		bool Flush()
+		{
+			if (stream == nullptr || used == 0)
+			{
+				return !failed;
+			}
+			if (!stream->write(buffer.data(), used))
+			{
+				failed = true;
+			}
+			flushed += used;
+			used = 0;
+			return !failed;
+		}
+
+		/// Xg[ւ̏oɎsĂȂǂ
+		bool Good() const
+		{
+			return !failed;
+		}
+
+		/// oĂȂoCg
+		const char* Data() const
+		{
+			return buffer.data();
+		}
+
+		/// oĂȂoCg
+		size_t Size() const
+		{
+			return used;
+		}
+
+		/// gݗĂoCgoċɂ
+		std::vector<char> Detach()
+		{
+			buffer.resize(used);
+			std::vector<char> result;
+			result.swap(buffer);
+			flushed += used;
+			used = 0;
+			return result;
+		}
+	};
+}
\ No newline at end of file
@@ -1,26 +1,378 @@
-#include <locale.h>
-#include <stdio.h>
+#pragma once
+#include <stdint.h>
+#include <string.h>
 #include <string>
-#include <wchar.h>
-#include <Windows.h>
-#include <memory>
 #include <vector>
+#include "SimdHelper.h"
+#ifdef _WIN32
+#include <Windows.h>
+#endif
 
 namespace oguna
 {
 	/// CP932,UTF8,UTF16𑊌ݕϊ
+	/// UTF8UTF16̕ϊ̓vbgtH[ɈˑAASCII̘ASIMDł܂Ƃ߂ĕϊ
+	/// std::wstringwchar_t16bit̊łUTF16A32bit̊łUTF32ƂĈ
 	class EncodingConverter
 	{
 	protected:
 		std::vector<char> buffer;
 
+		/// ASCIÎ݂16oCgwchar_t֍Lď
+		static void WidenAscii(const uint8_t *src, wchar_t *dst)
+		{
+#if defined(OGUNA_AVX2)
+			__m128i chunk = _mm_loadu_si128((const __m128i*) src);
+			if (sizeof(wchar_t) == 2)
+			{
+				_mm256_storeu_si256((__m256i*) dst, _mm256_cvtepu8_epi16(chunk));
+			}
+			else
+			{
+				_mm256_storeu_si256((__m256i*) dst, _mm256_cvtepu8_epi32(chunk));
+				_mm256_storeu_si256((__m256i*) (dst + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(chunk, 8)));
+			}
+#elif defined(OGUNA_SSE2)
+			__m128i chunk = _mm_loadu_si128((const __m128i*) src);
+			__m128i zero = _mm_setzero_si128();
+			__m128i lo = _mm_unpacklo_epi8(chunk, zero);
+			__m128i hi = _mm_unpackhi_epi8(chunk, zero);
+			if (sizeof(wchar_t) == 2)
+			{
+				_mm_storeu_si128((__m128i*) dst, lo);
+				_mm_storeu_si128((__m128i*) (dst + 8), hi);
+			}
+			else
+			{
+				_mm_storeu_si128((__m128i*) dst, _mm_unpacklo_epi16(lo, zero));
+				_mm_storeu_si128((__m128i*) (dst + 4), _mm_unpackhi_epi16(lo, zero));
+				_mm_storeu_si128((__m128i*) (dst + 8), _mm_unpacklo_epi16(hi, zero));
+				_mm_storeu_si128((__m128i*) (dst + 12), _mm_unpackhi_epi16(hi, zero));
+			}
+#else
+			for (int i = 0; i < 16; i++)
+			{
+				dst[i] = src[i];
+			}
+#endif
+		}
+
+		/// 擪16oCgׂASCIIǂ
+		static bool IsAscii16(const uint8_t *src)
+		{
+#ifdef OGUNA_SSE2
+			return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) src)) == 0;
+#else
+			uint64_t a, b;
+			memcpy(&a, src, 8);
+			memcpy(&b, src + 8, 8);
+			return ((a | b) & 0x8080808080808080ull) == 0;
+#endif
+		}
+
+		/// R[h|Cgwchar_tŏ݁A񂾗vfԂ
+		static int PutCodePoint(uint32_t code, wchar_t *dst)
+		{
+			if (sizeof(wchar_t) == 2 && code >= 0x10000)
+			{
+				code -= 0x10000;
+				dst[0] = (wchar_t) (0xD800 | (code >> 10));
+				dst[1] = (wchar_t) (0xDC00 | (code & 0x3FF));
+				return 2;
+			}
+			dst[0] = (wchar_t) code;
+			return 1;
+		}
+
 	public:
-		/// w肵TCỸobt@Ro[^(l:MAX_PATH)
-		EncodingConverter(int initial_buffer_size = MAX_PATH)
+		EncodingConverter()
+		{}
+
+		/// UTF8UTF16(std::wstring)֕ϊ
+		static int Utf8ToUtf16(const char *src, int length, std::wstring *out)
+		{
+			// o̗͂vf͓͂̃oCg𒴂Ȃ
+			out->resize(length);
+			if (length == 0)
+			{
+				return 0;
+			}
+			const uint8_t *s = (const uint8_t*) src;
+			const uint8_t *end = s + length;
+			wchar_t *begin = &(*out)[0];
+			wchar_t *d = begin;
+			while (s < end)
+			{
+#ifdef OGUNA_AVX2
+				while (end - s >= 32 && _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*) s)) == 0)
+				{
+					WidenAscii(s, d);
+					WidenAscii(s + 16, d + 16);
+					s += 32;
+					d += 32;
+				}
+#endif
+				while (end - s >= 16 && IsAscii16(s))
+				{
+					WidenAscii(s, d);
+					s += 16;
+					d += 16;
+				}
+				if (s == end)
+				{
+					break;
+				}
+				// ASCIIȊO̕Ԃ1ϊ
+				do
+				{
+					uint32_t c = *s;
+					int trail;
+					uint32_t minimum;
+					if (c < 0x80)
+					{
+						*d++ = (wchar_t) c;
+						s++;
+						continue;
+					}
+					else if ((c & 0xE0) == 0xC0)
+					{
+						c &= 0x1F;
+						trail = 1;
+						minimum = 0x80;
+					}
+					else if ((c & 0xF0) == 0xE0)
+					{
+						c &= 0x0F;
+						trail = 2;
+						minimum = 0x800;
+					}
+					else if ((c & 0xF8) == 0xF0)
+					{
+						c &= 0x07;
+						trail = 3;
+						minimum = 0x10000;
+					}
+					else
+					{
+						*d++ = (wchar_t) 0xFFFD;
+						s++;
+						continue;
+					}
+					if (end - s <= trail)
+					{
+						*d++ = (wchar_t) 0xFFFD;
+						s++;
+						continue;
+					}
+					bool valid = true;
+					for (int i = 1; i <= trail; i++)
+					{
+						if ((s[i] & 0xC0) != 0x80)
+						{
+							valid = false;
+							break;
+						}
+						c = (c << 6) | (s[i] & 0x3F);
+					}
+					if (!valid || c < minimum || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+					{
+						*d++ = (wchar_t) 0xFFFD;
+						s++;
+						continue;
+					}
+					d += PutCodePoint(c, d);
+					s += trail + 1;
+				} while (s < end && (*s & 0x80));
+			}
+			int size = (int) (d - begin);
+			out->resize(size);
+			return size;
+		}
+
+		/// UTF16LẼoCg񂩂UTF16(std::wstring)֕ϊ
+		static int Utf16LeToUtf16(const char *src, int size, std::wstring *out)
+		{
+			int length = size / 2;
+			out->resize(length);
+			if (length == 0)
+			{
+				return 0;
+			}
+			wchar_t *begin = &(*out)[0];
+			if (sizeof(wchar_t) == 2)
+			{
+				memcpy(begin, src, length * sizeof(wchar_t));
+				return length;
+			}
+			// wchar_t32bit̏ꍇ̓TQ[gyA
+			const uint8_t *s = (const uint8_t*) src;
+			wchar_t *d = begin;
+			int i = 0;
+			while (i < length)
+			{
+#ifdef OGUNA_SSE2
+				while (length - i >= 8)
+				{
+					__m128i units = _mm_loadu_si128((const __m128i*) (s + i * 2));
+					__m128i surrogate = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16((short) 0xF800)), _mm_set1_epi16((short) 0xD800));
+					if (_mm_movemask_epi8(surrogate))
+					{
+						break;
+					}
+					__m128i zero = _mm_setzero_si128();
+					_mm_storeu_si128((__m128i*) d, _mm_unpacklo_epi16(units, zero));
+					_mm_storeu_si128((__m128i*) (d + 4), _mm_unpackhi_epi16(units, zero));
+					i += 8;
+					d += 8;
+				}
+				if (i == length)
+				{
+					break;
+				}
+#endif
+				uint32_t c = s[i * 2] | (s[i * 2 + 1] << 8);
+				i++;
+				if (c >= 0xD800 && c <= 0xDBFF && i < length)
+				{
+					uint32_t low = s[i * 2] | (s[i * 2 + 1] << 8);
+					if (low >= 0xDC00 && low <= 0xDFFF)
+					{
+						c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+						i++;
+					}
+				}
+				*d++ = (wchar_t) c;
+			}
+			int result = (int) (d - begin);
+			out->resize(result);
+			return result;
+		}
+
+		/// UTF16(std::wstring)UTF16LẼoCg(std::string)֕ϊ
+		static int Utf16ToUtf16Le(const wchar_t *src, int length, std::string *out)
+		{
+			out->resize(length * 4);
+			if (length == 0)
+			{
+				return 0;
+			}
+			char *begin = &(*out)[0];
+			if (sizeof(wchar_t) == 2)
+			{
+				memcpy(begin, src, length * sizeof(wchar_t));
+				out->resize(length * 2);
+				return length * 2;
+			}
+			// wchar_t32bit̏ꍇBMPO̕TQ[gyAɕ
+			uint8_t *d = (uint8_t*) begin;
+			for (int i = 0; i < length; i++)
+			{
+				uint32_t c = (uint32_t) src[i];
+				if (c >= 0x10000)
+				{
+					uint32_t high = 0xD800 + ((c - 0x10000) >> 10);
+					uint32_t low = 0xDC00 + ((c - 0x10000) & 0x3FF);
+					*d++ = (uint8_t) high;
+					*d++ = (uint8_t) (high >> 8);
+					c = low;
+				}
+				*d++ = (uint8_t) c;
+				*d++ = (uint8_t) (c >> 8);
+			}
+			int size = (int) ((char*) d - begin);
+			out->resize(size);
+			return size;
+		}
+
+		/// UTF16(std::wstring)UTF8(std::string)֕ϊ
+		static int Utf16ToUtf8(const wchar_t *src, int length, std::string *out)
 		{
-			buffer.resize(initial_buffer_size);
+			out->resize(length * (sizeof(wchar_t) == 2 ? 3 : 4));
+			if (length == 0)
+			{
+				return 0;
+			}
+			char *begin = &(*out)[0];
+			char *d = begin;
+			int i = 0;
+			while (i < length)
+			{
+#ifdef OGUNA_SSE2
+				// ASCII8͂܂Ƃ߂ċl߂
+				while (length - i >= 8)
+				{
+					__m128i packed;
+					if (sizeof(wchar_t) == 2)
+					{
+						__m128i units = _mm_loadu_si128((const __m128i*) (src + i));
+						if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16((short) 0xFF80)), _mm_setzero_si128())) != 0xFFFF)
+						{
+							break;
+						}
+						packed = _mm_packus_epi16(units, units);
+					}
+					else
+					{
+						__m128i lo = _mm_loadu_si128((const __m128i*) (src + i));
+						__m128i hi = _mm_loadu_si128((const __m128i*) (src + i + 4));
+						__m128i mask = _mm_set1_epi32((int) 0xFFFFFF80);
+						__m128i zero = _mm_setzero_si128();
+						__m128i ascii = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(lo, mask), zero), _mm_cmpeq_epi32(_mm_and_si128(hi, mask), zero));
+						if (_mm_movemask_epi8(ascii) != 0xFFFF)
+						{
+							break;
+						}
+						__m128i units = _mm_packs_epi32(lo, hi);
+						packed = _mm_packus_epi16(units, units);
+					}
+					_mm_storel_epi64((__m128i*) d, packed);
+					i += 8;
+					d += 8;
+				}
+				if (i == length)
+				{
+					break;
+				}
+#endif
+				uint32_t c = (uint32_t) src[i++];
+				if (sizeof(wchar_t) == 2 && c >= 0xD800 && c <= 0xDBFF && i < length)
+				{
+					uint32_t low = (uint32_t) src[i];
+					if (low >= 0xDC00 && low <= 0xDFFF)
+					{
+						c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+						i++;
+					}
+				}
+				if (c < 0x80)
+				{
+					*d++ = (char) c;
+				}
+				else if (c < 0x800)
+				{
+					*d++ = (char) (0xC0 | (c >> 6));
+					*d++ = (char) (0x80 | (c & 0x3F));
+				}
+				else if (c < 0x10000)
+				{
+					*d++ = (char) (0xE0 | (c >> 12));
+					*d++ = (char) (0x80 | ((c >> 6) & 0x3F));
+					*d++ = (char) (0x80 | (c & 0x3F));
+				}
+				else
+				{
+					*d++ = (char) (0xF0 | (c >> 18));
+					*d++ = (char) (0x80 | ((c >> 12) & 0x3F));
+					*d++ = (char) (0x80 | ((c >> 6) & 0x3F));
+					*d++ = (char) (0x80 | (c & 0x3F));
+				}
+			}
+			int size = (int) (d - begin);
+			out->resize(size);
+			return size;
 		}
 
+#ifdef _WIN32
 		/// UTF8CP932(std::string)֕ϊ
 		int Utf8ToCp932(const char* src, int size, std::string *out)
 		{
@@ -41,9 +393,9 @@ namespace oguna
 		int Cp932ToUtf16(const char *src, int length, std::wstring *out)
 		{
 			int size;
-			size = ::MultiByteToWideChar(CP_ACP, MB_PRECOMPOSED, src, length, NULL, NULL);
+			size = ::MultiByteToWideChar(932, MB_PRECOMPOSED, src, length, NULL, NULL);
 			buffer.resize(size * sizeof(wchar_t) * 2);
-			MultiByteToWideChar(CP_ACP, MB_PRECOMPOSED, src, length, (LPWSTR) buffer.data(), buffer.size() * 2);
+			MultiByteToWideChar(932, MB_PRECOMPOSED, src, length, (LPWSTR) buffer.data(), buffer.size() * 2);
 			out->assign((wchar_t*) buffer.data(), size);
 			return size;
 		}
@@ -52,33 +404,12 @@ namespace oguna
 		int Utf16ToCp932(const wchar_t *src, int length, std::string *out)
 		{
 			int size;
-			size = WideCharToMultiByte(CP_ACP, NULL, src, length, NULL, NULL, NULL, NULL);
-			buffer.resize(size);
-			WideCharToMultiByte(CP_ACP, NULL, src, length, (LPSTR) buffer.data(), buffer.size(), NULL, NULL);
-			out->assign(buffer.data(), size);
-			return size;
-		}
-
-		/// UTF8UTF16(std::wstring)֕ϊ
-		int Utf8ToUtf16(const char *src, int length, std::wstring *out)
-		{
-			int size;
-			size = ::MultiByteToWideChar(CP_UTF8, 0, src, length, NULL, NULL);
-			buffer.resize(size * sizeof(wchar_t));
-			MultiByteToWideChar(CP_UTF8, 0, src, length, (LPWSTR) buffer.data(), buffer.size());
-			out->swap(std::wstring((wchar_t*) buffer.data(), size));
-			return size;
-		}
-
-		/// UTF16UTF8(std::string)֕ϊ
-		int Utf16ToUtf8(const wchar_t *src, int length, std::string *out)
-		{
-			int size;
-			size = WideCharToMultiByte(CP_UTF8, NULL, src, length, NULL, NULL, NULL, NULL);
+			size = WideCharToMultiByte(932, NULL, src, length, NULL, NULL, NULL, NULL);
 			buffer.resize(size);
-			WideCharToMultiByte(CP_UTF8, NULL, src, length, (LPSTR) buffer.data(), buffer.size(), NULL, NULL);
+			WideCharToMultiByte(932, NULL, src, length, (LPSTR) buffer.data(), buffer.size(), NULL, NULL);
 			out->assign(buffer.data(), size);
 			return size;
 		}
+#endif
 	};
-}
\ No newline at end of file
+}
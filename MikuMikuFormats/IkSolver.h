@@ -0,0 +1,441 @@
+#pragma once
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Pmx.h"
+#include "Pmd.h"
+#include "Vmd.h"
+#include "MathHelper.h"
+#include "RuntimeModel.h"
+
+namespace mmd
+{
+	/// CCD@IK
+	///
+	/// {[̏Ԃ̓{[CfbNX̔zŎ󂯎
+	/// translations({[*3)͐e̍Wnł̏p̈ړArotations({[*4)̓[J̉](x, y, z, w)A
+	/// globals({[*16)̓O[os(sxNgɉE|DirectX`)Ƃ
+	/// Solve̓NrotationsAN^[Qbg܂ł̃{[globalsvZ
+	/// ԂmۂȂ̂ŁAIkSolverŕ̃f̃|[Yɉ
+	class IkSolver
+	{
+	public:
+		/// ^[QbgƖڕW̋̓悪菬Ȃł؂
+		static constexpr float ConvergedDistance = 1e-8f;
+
+		/// PMXIK{[(0x0020)
+		void Setup(const pmx::PmxModel &model)
+		{
+			chains.clear();
+			links.clear();
+			paths.clear();
+			SetupBones(model.bone_count, [&model](int i) { return model.bones[i].parent_index; }, [&model](int i) { return model.bones[i].position; });
+			for (int i = 0; i < model.bone_count; i++)
+			{
+				const pmx::PmxBone &bone = model.bones[i];
+				if (!(bone.bone_flag & 0x0020))
+				{
+					continue;
+				}
+				Chain chain;
+				chain.ik_bone = i;
+				chain.target = bone.ik_target_bone_index;
+				chain.loop = bone.ik_loop;
+				chain.unit_angle = bone.ik_loop_angle_limit;
+				chain.link_begin = (int) links.size();
+				for (int k = 0; k < bone.ik_link_count; k++)
+				{
+					const pmx::PmxIkLink &ik_link = bone.ik_links[k];
+					Link link;
+					link.bone = ik_link.link_target;
+					link.limited = ik_link.angle_lock != 0;
+					for (int c = 0; c < 3; c++)
+					{
+						link.min_radian[c] = ik_link.min_radian[c];
+						link.max_radian[c] = ik_link.max_radian[c];
+					}
+					links.push_back(link);
+				}
+				AddChain(chain);
+			}
+		}
+
+		/// PMDIK(pxƁuЂv̐PmdIkŋ߂)
+		void Setup(const pmd::PmdModel &model)
+		{
+			int bone_count = (int) model.bones.size();
+			chains.clear();
+			links.clear();
+			paths.clear();
+			SetupBones(bone_count, [&model](int i) { return model.bones[i].parent_bone_index == 0xFFFF ? -1 : (int) model.bones[i].parent_bone_index; }, [&model](int i) { return model.bones[i].bone_head_pos; });
+			for (auto &ik : model.iks)
+			{
+				Chain chain;
+				chain.ik_bone = ik.ik_bone_index;
+				chain.target = ik.target_bone_index;
+				chain.loop = ik.interations;
+				chain.unit_angle = ik.UnitAngle();
+				chain.link_begin = (int) links.size();
+				for (uint16_t bone : ik.ik_child_bone_index)
+				{
+					Link link;
+					link.bone = bone;
+					link.limited = pmd::PmdIk::LinkLimit(model.bones, bone, link.min_radian, link.max_radian);
+					links.push_back(link);
+				}
+				AddChain(chain);
+			}
+		}
+
+		/// RuntimeModelIK(PMD̂͐pxƁuЂv̐ϊς)
+		void Setup(const RuntimeModel &model)
+		{
+			chains.clear();
+			links.clear();
+			paths.clear();
+			SetupBones(model.BoneCount(), [&model](int i) { return model.bones[i].parent; }, [&model](int i) { return model.bones[i].position; });
+			for (auto &ik : model.iks)
+			{
+				Chain chain;
+				chain.ik_bone = ik.bone;
+				chain.target = ik.target;
+				chain.loop = ik.loop;
+				chain.unit_angle = ik.unit_angle;
+				chain.link_begin = (int) links.size();
+				for (int k = ik.link_begin; k < ik.link_end; k++)
+				{
+					const RuntimeIkLink &ik_link = model.ik_links[k];
+					Link link;
+					link.bone = ik_link.bone;
+					link.limited = ik_link.limited != 0;
+					for (int c = 0; c < 3; c++)
+					{
+						link.min_radian[c] = ik_link.min_radian[c];
+						link.max_radian[c] = ik_link.max_radian[c];
+					}
+					links.push_back(link);
+				}
+				AddChain(chain);
+			}
+		}
+
+		int ChainCount() const
+		{
+			return (int) chains.size();
+		}
+
+		/// `F[IK{[
+		int IkBone(int chain) const
+		{
+			return chains[chain].ik_bone;
+		}
+
+		/// IK{[`F[(Ȃ-1)
+		int FindChain(int ik_bone) const
+		{
+			for (size_t i = 0; i < chains.size(); i++)
+			{
+				if (chains[i].ik_bone == ik_bone)
+				{
+					return (int) i;
+				}
+			}
+			return -1;
+		}
+
+		/// `F[̃Ñ{[(^[Qbgɋ߂)
+		int LinkCount(int chain) const
+		{
+			return chains[chain].link_end - chains[chain].link_begin;
+		}
+
+		int LinkBone(int chain, int link) const
+		{
+			return links[chains[chain].link_begin + link].bone;
+		}
+
+		/// VMDIKt[̗LEAIK{[̖Ov`F[enabled(`F[)ɏ
+		/// bone_names̓{[CfbNXCP932̖OŁAt[ɂȂ`F[͕ύXȂ
+		void ApplyIkFrame(const vmd::VmdIkFrame &frame, const std::string *bone_names, bool *enabled) const
+		{
+			for (auto &ik_enable : frame.ik_enable)
+			{
+				for (size_t i = 0; i < chains.size(); i++)
+				{
+					if (bone_names[chains[i].ik_bone] == ik_enable.ik_name)
+					{
+						enabled[i] = ik_enable.enable;
+					}
+				}
+			}
+		}
+
+		/// `F[̃^[QbgIK{[̈ʒu֋߂Â悤ɃN
+		void Solve(int chain_index, const float *translations, float *rotations, float *globals) const
+		{
+			const Chain &chain = chains[chain_index];
+			if (chain.path_begin == chain.path_end)
+			{
+				return;
+			}
+			const float *goal = globals + chain.ik_bone * 16 + 12;
+			const float *target = globals + chain.target * 16 + 12;
+			for (int iteration = 0; iteration < chain.loop; iteration++)
+			{
+				for (int i = chain.link_begin; i < chain.link_end; i++)
+				{
+					const Link &link = links[i];
+					if (link.path_index < 0)
+					{
+						continue;
+					}
+					// ^[QbgƖڕWւ̌N̍Wnŋ߂
+					const float *m = globals + link.bone * 16;
+					float to_target[3], to_goal[3];
+					for (int c = 0; c < 3; c++)
+					{
+						to_target[c] = target[c] - m[12 + c];
+						to_goal[c] = goal[c] - m[12 + c];
+					}
+					float a[3], b[3];
+					for (int row = 0; row < 3; row++)
+					{
+						a[row] = to_target[0] * m[row * 4] + to_target[1] * m[row * 4 + 1] + to_target[2] * m[row * 4 + 2];
+						b[row] = to_goal[0] * m[row * 4] + to_goal[1] * m[row * 4 + 1] + to_goal[2] * m[row * 4 + 2];
+					}
+					float length_a = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+					float length_b = sqrtf(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+					if (length_a < 1e-6f || length_b < 1e-6f)
+					{
+						continue;
+					}
+					float axis[3] = {
+						a[1] * b[2] - a[2] * b[1],
+						a[2] * b[0] - a[0] * b[2],
+						a[0] * b[1] - a[1] * b[0],
+					};
+					float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+					float angle;
+					if (link.axis >= 0)
+					{
+						// ꎲŋȂ郊ŃA̎ɐȖʂɎˉepx
+						int k = link.axis;
+						angle = atan2f(axis[k], dot - a[k] * b[k]);
+						axis[0] = axis[1] = axis[2] = 0.0f;
+						axis[k] = angle < 0.0f ? -1.0f : 1.0f;
+						angle = fabsf(angle);
+					}
+					else
+					{
+						float sin_angle = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+						if (sin_angle < 1e-7f * length_a * length_b)
+						{
+							continue;
+						}
+						angle = atan2f(sin_angle, dot);
+						for (int c = 0; c < 3; c++)
+						{
+							axis[c] /= sin_angle;
+						}
+					}
+					if (chain.unit_angle > 0.0f)
+					{
+						angle = std::min(angle, chain.unit_angle);
+					}
+					if (angle < 1e-6f)
+					{
+						continue;
+					}
+
+					// N̍Wnŉ񂵂Ă獡̉]
+					float half_sin = sinf(angle * 0.5f);
+					float delta[4] = { axis[0] * half_sin, axis[1] * half_sin, axis[2] * half_sin, cosf(angle * 0.5f) };
+					float *rotation = rotations + link.bone * 4;
+					oguna::QuaternionMultiply(rotation, delta, rotation);
+					if (link.limited)
+					{
+						LimitAngle(link, rotation);
+					}
+					oguna::QuaternionNormalize(rotation);
+					UpdateGlobals(&paths[chain.path_begin + link.path_index], chain.path_end - chain.path_begin - link.path_index, translations, rotations, globals);
+				}
+				float distance = 0.0f;
+				for (int c = 0; c < 3; c++)
+				{
+					distance += (target[c] - goal[c]) * (target[c] - goal[c]);
+				}
+				if (distance < ConvergedDistance)
+				{
+					break;
+				}
+			}
+		}
+
+		/// bones(eɂȂ鏇)̃O[osA[J̉]ƈړƐẽO[os񂩂vZ
+		void UpdateGlobals(const int *bones, int count, const float *translations, const float *rotations, float *globals) const
+		{
+			static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+			for (int i = 0; i < count; i++)
+			{
+				int bone = bones[i];
+				const float *q = rotations + bone * 4;
+				const float *p = parents[bone] >= 0 ? globals + parents[bone] * 16 : identity;
+				float x = q[0], y = q[1], z = q[2], w = q[3];
+				float local[12] = {
+					1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y),
+					2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x),
+					2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y),
+					translations[bone * 3] + offsets[bone * 3], translations[bone * 3 + 1] + offsets[bone * 3 + 1], translations[bone * 3 + 2] + offsets[bone * 3 + 2],
+				};
+				float *m = globals + bone * 16;
+				for (int row = 0; row < 4; row++)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						m[row * 4 + c] = local[row * 3] * p[c] + local[row * 3 + 1] * p[4 + c] + local[row * 3 + 2] * p[8 + c] + (row == 3 ? p[12 + c] : 0.0f);
+					}
+				}
+			}
+		}
+
+	private:
+		struct Chain
+		{
+			int ik_bone;
+			int target;
+			int loop;
+			/// ̌vZŉ񂷊px̏(0ȉȂ琧Ȃ)
+			float unit_angle;
+			/// links͈̔
+			int link_begin;
+			int link_end;
+			/// ł̃N^[Qbg܂ł̃{[(paths͈̔́Ae)
+			int path_begin;
+			int path_end;
+		};
+
+		struct Link
+		{
+			int bone;
+			/// `F[pathł̈ʒu(^[Qbg̑cłȂ-1)
+			int path_index;
+			bool limited;
+			/// ꎲŋȂȂ炻̎(X, Y, Z0, 1, 2)AłȂ-1
+			int axis;
+			/// X, Y, Z̉]͈̔(X, Y, Z̏ɉ񂷃IC[p)
+			float min_radian[3];
+			float max_radian[3];
+		};
+
+		/// {[Ƃ̐e(Ȃ-1)Ɛȅʒu̍
+		std::vector<int> parents;
+		std::vector<float> offsets;
+		std::vector<Chain> chains;
+		std::vector<Link> links;
+		std::vector<int> paths;
+
+		template<typename Parent, typename Position>
+		void SetupBones(int bone_count, Parent parent_of, Position position_of)
+		{
+			parents.resize(bone_count);
+			offsets.resize(bone_count * 3);
+			for (int i = 0; i < bone_count; i++)
+			{
+				int parent = parent_of(i);
+				parents[i] = (parent >= 0 && parent < bone_count && parent != i) ? parent : -1;
+			}
+			for (int i = 0; i < bone_count; i++)
+			{
+				const float *position = position_of(i);
+				for (int c = 0; c < 3; c++)
+				{
+					offsets[i * 3 + c] = position[c] - (parents[i] >= 0 ? position_of(parents[i])[c] : 0.0f);
+				}
+			}
+		}
+
+		/// ^[QbgeǂAł̃N܂łpathɂ
+		void AddChain(Chain chain)
+		{
+			int bone_count = (int) parents.size();
+			chain.link_end = (int) links.size();
+			chain.path_begin = chain.path_end = (int) paths.size();
+			bool valid = chain.ik_bone >= 0 && chain.ik_bone < bone_count && chain.target >= 0 && chain.target < bone_count;
+			std::vector<int> ancestors;
+			for (int bone = valid ? chain.target : -1; bone >= 0 && (int) ancestors.size() < bone_count; bone = parents[bone])
+			{
+				ancestors.push_back(bone);
+			}
+			int top = -1;
+			for (int i = chain.link_begin; i < chain.link_end; i++)
+			{
+				Link &link = links[i];
+				link.axis = -1;
+				for (int c = 0; c < 3 && link.limited; c++)
+				{
+					bool others_fixed = true;
+					for (int other = 0; other < 3; other++)
+					{
+						others_fixed = others_fixed && (other == c || (link.min_radian[other] == 0.0f && link.max_radian[other] == 0.0f));
+					}
+					if (others_fixed && link.min_radian[c] != link.max_radian[c])
+					{
+						link.axis = c;
+					}
+				}
+				auto found = std::find(ancestors.begin(), ancestors.end(), link.bone);
+				link.path_index = -1;
+				if (found != ancestors.end() && *found != chain.target)
+				{
+					top = std::max(top, (int) (found - ancestors.begin()));
+				}
+			}
+			for (int i = top; i >= 0; i--)
+			{
+				paths.push_back(ancestors[i]);
+			}
+			chain.path_end = (int) paths.size();
+			for (int i = chain.link_begin; i < chain.link_end; i++)
+			{
+				auto found = std::find(paths.begin() + chain.path_begin, paths.end(), links[i].bone);
+				if (found != paths.end() && *found != chain.target)
+				{
+					links[i].path_index = (int) (found - paths.begin()) - chain.path_begin;
+				}
+			}
+			if (!valid)
+			{
+				chain.loop = 0;
+			}
+			chains.push_back(chain);
+		}
+
+		/// ]X, Y, Z̏ɉ񂷃IC[pɕĔ͈͂Ɏ߂
+		static void LimitAngle(const Link &link, float *q)
+		{
+			float x = q[0], y = q[1], z = q[2], w = q[3];
+			float m01 = 2.0f * (x * y + w * z);
+			float m00 = 1.0f - 2.0f * (y * y + z * z);
+			float m02 = 2.0f * (x * z - w * y);
+			float m12 = 2.0f * (y * z + w * x);
+			float m22 = 1.0f - 2.0f * (x * x + y * y);
+			float angles[3] = {
+				atan2f(m12, m22),
+				asinf(std::max(-1.0f, std::min(1.0f, -m02))),
+				atan2f(m01, m00),
+			};
+			for (int c = 0; c < 3; c++)
+			{
+				angles[c] = std::max(link.min_radian[c], std::min(link.max_radian[c], angles[c]));
+			}
+			// Z * Y * X ̐(X̉]ŏ)
+			float rx[4] = { sinf(angles[0] * 0.5f), 0.0f, 0.0f, cosf(angles[0] * 0.5f) };
+			float ry[4] = { 0.0f, sinf(angles[1] * 0.5f), 0.0f, cosf(angles[1] * 0.5f) };
+			float rz[4] = { 0.0f, 0.0f, sinf(angles[2] * 0.5f), cosf(angles[2] * 0.5f) };
+			oguna::QuaternionMultiply(rz, ry, q);
+			oguna::QuaternionMultiply(q, rx, q);
+		}
+	};
+}
\ No newline at end of file
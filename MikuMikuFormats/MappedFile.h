@@ -0,0 +1,147 @@
+#pragma once
+#include <stddef.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace oguna
+{
+	/// ǂݍݐpŃɃ}bvt@C
+	class MappedFile
+	{
+	protected:
+		const char *data;
+		size_t size;
+#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+#endif
+
+	public:
+		MappedFile()
+			: data(nullptr)
+			, size(0)
+#ifdef _WIN32
+			, file(INVALID_HANDLE_VALUE)
+			, mapping(NULL)
+#endif
+		{}
+
+		~MappedFile()
+		{
+			Close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/// t@C}bv
+		bool Open(const char *filename)
+		{
+			Close();
+#ifdef _WIN32
+			file = ::CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+			LARGE_INTEGER file_size;
+			if (!::GetFileSizeEx(file, &file_size))
+			{
+				Close();
+				return false;
+			}
+			size = (size_t) file_size.QuadPart;
+			if (size == 0)
+			{
+				return true;
+			}
+			mapping = ::CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping == NULL)
+			{
+				Close();
+				return false;
+			}
+			data = (const char*) ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (data == nullptr)
+			{
+				Close();
+				return false;
+			}
+#else
+			int fd = ::open(filename, O_RDONLY);
+			if (fd < 0)
+			{
+				return false;
+			}
+			struct stat st;
+			if (::fstat(fd, &st) != 0)
+			{
+				::close(fd);
+				return false;
+			}
+			size = (size_t) st.st_size;
+			if (size == 0)
+			{
+				::close(fd);
+				return true;
+			}
+			void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (address == MAP_FAILED)
+			{
+				size = 0;
+				return false;
+			}
+			::madvise(address, size, MADV_SEQUENTIAL);
+			data = (const char*) address;
+#endif
+			return true;
+		}
+
+		/// }bv
+		void Close()
+		{
+#ifdef _WIN32
+			if (data)
+			{
+				::UnmapViewOfFile(data);
+			}
+			if (mapping != NULL)
+			{
+				::CloseHandle(mapping);
+				mapping = NULL;
+			}
+			if (file != INVALID_HANDLE_VALUE)
+			{
+				::CloseHandle(file);
+				file = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (data)
+			{
+				::munmap((void*) data, size);
+			}
+#endif
+			data = nullptr;
+			size = 0;
+		}
+
+		/// 擪AhX
+		const char* Data() const
+		{
+			return data;
+		}
+
+		/// oCg
+		size_t Size() const
+		{
+			return size;
+		}
+	};
+}
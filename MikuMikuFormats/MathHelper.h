@@ -0,0 +1,183 @@
+#pragma once
+#include <math.h>
+
+namespace oguna
+{
+	/// `
+	inline float Lerp(float a, float b, float t)
+	{
+		return a + (b - a) * t;
+	}
+
+	/// l(x, y, z, w)𐳋K
+	inline void QuaternionNormalize(float *q)
+	{
+		float length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		if (length > 0.0f)
+		{
+			float inv = 1.0f / length;
+			q[0] *= inv;
+			q[1] *= inv;
+			q[2] *= inv;
+			q[3] *= inv;
+		}
+		else
+		{
+			q[0] = q[1] = q[2] = 0.0f;
+			q[3] = 1.0f;
+		}
+	}
+
+	/// l(x, y, z, w)̐a * b(b̉]̌ả])AoutabƓł悢
+	inline void QuaternionMultiply(const float *a, const float *b, float *out)
+	{
+		float x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+		float y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+		float z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+		float w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+		out[0] = x;
+		out[1] = y;
+		out[2] = z;
+		out[3] = w;
+	}
+
+	/// l(x, y, z, w)̋ʐ`(Žʂʂ)
+	inline void QuaternionSlerp(const float *a, const float *b, float t, float *out)
+	{
+		float cos_theta = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+		float sign = 1.0f;
+		if (cos_theta < 0.0f)
+		{
+			cos_theta = -cos_theta;
+			sign = -1.0f;
+		}
+		float wa, wb;
+		if (cos_theta > 0.9995f)
+		{
+			// قړȂ`ԂĐK
+			wa = 1.0f - t;
+			wb = t * sign;
+			for (int i = 0; i < 4; i++)
+			{
+				out[i] = a[i] * wa + b[i] * wb;
+			}
+			QuaternionNormalize(out);
+			return;
+		}
+		float theta = acosf(cos_theta);
+		float inv_sin = 1.0f / sinf(theta);
+		wa = sinf((1.0f - t) * theta) * inv_sin;
+		wb = sinf(t * theta) * inv_sin * sign;
+		for (int i = 0; i < 4; i++)
+		{
+			out[i] = a[i] * wa + b[i] * wb;
+		}
+	}
+
+	/// sxNgɉE|4x4s(DirectX`Asړ12`14)̉]l(x, y, z, w)ɂ
+	/// s͊gk܂܂Ȃ̂Ƃ
+	inline void QuaternionFromMatrix(const float *m, float *q)
+	{
+		// xNgɊ|`̍sRƂ R[r][c] = m[c * 4 + r]
+		float r00 = m[0], r01 = m[4], r02 = m[8];
+		float r10 = m[1], r11 = m[5], r12 = m[9];
+		float r20 = m[2], r21 = m[6], r22 = m[10];
+		float trace = r00 + r11 + r22;
+		if (trace > 0.0f)
+		{
+			float s = 0.5f / sqrtf(trace + 1.0f);
+			q[0] = (r21 - r12) * s;
+			q[1] = (r02 - r20) * s;
+			q[2] = (r10 - r01) * s;
+			q[3] = 0.25f / s;
+		}
+		else if (r00 > r11 && r00 > r22)
+		{
+			float s = 2.0f * sqrtf(1.0f + r00 - r11 - r22);
+			q[0] = 0.25f * s;
+			q[1] = (r01 + r10) / s;
+			q[2] = (r02 + r20) / s;
+			q[3] = (r21 - r12) / s;
+		}
+		else if (r11 > r22)
+		{
+			float s = 2.0f * sqrtf(1.0f + r11 - r00 - r22);
+			q[0] = (r01 + r10) / s;
+			q[1] = 0.25f * s;
+			q[2] = (r12 + r21) / s;
+			q[3] = (r02 - r20) / s;
+		}
+		else
+		{
+			float s = 2.0f * sqrtf(1.0f + r22 - r00 - r11);
+			q[0] = (r02 + r20) / s;
+			q[1] = (r12 + r21) / s;
+			q[2] = 0.25f * s;
+			q[3] = (r10 - r01) / s;
+		}
+	}
+
+	/// (0,0),(x1,y1),(x2,y2),(1,1)𐧌_Ƃ3xWFȐŁAxɑ΂y߂
+	/// _x[0,1]Ɏ܂Ăx͒PȂ̂ŁAj[g@Ɠ񕪖@t߂
+	inline float BezierEase(float x1, float y1, float x2, float y2, float x)
+	{
+		if (x <= 0.0f)
+		{
+			return 0.0f;
+		}
+		if (x >= 1.0f)
+		{
+			return 1.0f;
+		}
+		// B(t) = 3(1-t)^2 t p1 + 3(1-t) t^2 p2 + t^3 𑽍̌Wŕ\
+		float cx = 3.0f * x1;
+		float bx = 3.0f * (x2 - x1) - cx;
+		float ax = 1.0f - cx - bx;
+		float cy = 3.0f * y1;
+		float by = 3.0f * (y2 - y1) - cy;
+		float ay = 1.0f - cy - by;
+
+		float t = x;
+		for (int i = 0; i < 8; i++)
+		{
+			float error = ((ax * t + bx) * t + cx) * t - x;
+			if (fabsf(error) < 1e-6f)
+			{
+				return ((ay * t + by) * t + cy) * t;
+			}
+			float slope = (3.0f * ax * t + 2.0f * bx) * t + cx;
+			if (fabsf(slope) < 1e-6f)
+			{
+				break;
+			}
+			t -= error / slope;
+			if (t < 0.0f || t > 1.0f)
+			{
+				break;
+			}
+		}
+
+		// Ȃꍇ͓񕪖@ŋ߂
+		float low = 0.0f;
+		float high = 1.0f;
+		t = x;
+		for (int i = 0; i < 32; i++)
+		{
+			float value = ((ax * t + bx) * t + cx) * t;
+			if (fabsf(value - x) < 1e-6f)
+			{
+				break;
+			}
+			if (value < x)
+			{
+				low = t;
+			}
+			else
+			{
+				high = t;
+			}
+			t = (low + high) * 0.5f;
+		}
+		return ((ay * t + by) * t + cy) * t;
+	}
+}
\ No newline at end of file
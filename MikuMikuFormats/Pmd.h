@@ -1,8 +1,11 @@
+#pragma once
 #include <vector>
 #include <string>
 #include <memory>
 #include <iostream>
 #include <fstream>
+#include "BinaryReader.h"
+#include "MappedFile.h"
 
 namespace pmd
 {
@@ -19,23 +22,17 @@ namespace pmd
 		/// Rg(p)
 		std::string comment_english;
 
-		bool Read(std::ifstream* stream)
+		bool Read(oguna::BinaryReader *reader)
 		{
-			char buffer[256];
-			stream->read(buffer, 20);
-			name = std::string(buffer);
-			stream->read(buffer, 256);
-			comment = std::string(buffer);
+			name = reader->ReadFixedString(20);
+			comment = reader->ReadFixedString(256);
 			return true;
 		}
 
-		bool ReadExtension(std::ifstream* stream)
+		bool ReadExtension(oguna::BinaryReader *reader)
 		{
-			char buffer[256];
-			stream->read(buffer, 20);
-			name_english = std::string(buffer);
-			stream->read(buffer, 256);
-			comment_english = std::string(buffer);
+			name_english = reader->ReadFixedString(20);
+			comment_english = reader->ReadFixedString(256);
 			return true;
 		}
 	};
@@ -62,14 +59,16 @@ namespace pmd
 		/// GbWs
 		bool edge_invisible;
 
-		bool Read(std::ifstream* stream)
+		bool Read(oguna::BinaryReader *reader)
 		{
-			stream->read((char*) position, sizeof(float) * 3);
-			stream->read((char*) normal, sizeof(float) * 3);
-			stream->read((char*) uv, sizeof(float) * 2);
-			stream->read((char*) bone_index, sizeof(uint16_t) * 2);
-			stream->read((char*) &bone_weight, sizeof(uint8_t));
-			stream->read((char*) &edge_invisible, sizeof(uint8_t));
+			// 38oCǧŒ蒷R[h܂Ƃ߂ĎQƂ
+			const char *record = reader->View(38);
+			memcpy(position, record, sizeof(float) * 3);
+			memcpy(normal, record + 12, sizeof(float) * 3);
+			memcpy(uv, record + 24, sizeof(float) * 2);
+			memcpy(bone_index, record + 32, sizeof(uint16_t) * 2);
+			bone_weight = (uint8_t) record[36];
+			edge_invisible = record[37] != 0;
 			return true;
 		}
 	};
@@ -97,27 +96,25 @@ namespace pmd
 		/// XtBAt@C
 		std::string sphere_filename;
 
-		bool Read(std::ifstream* stream)
+		bool Read(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read((char*) &diffuse, sizeof(float) * 4);
-			stream->read((char*) &power, sizeof(float));
-			stream->read((char*) &specular, sizeof(float) * 3);
-			stream->read((char*) &ambient, sizeof(float) * 3);
-			stream->read((char*) &toon_index, sizeof(uint8_t));
-			stream->read((char*) &edge_flag, sizeof(uint8_t));
-			stream->read((char*) &index_count, sizeof(uint32_t));
-			stream->read((char*) &buffer, sizeof(char) * 20);
-			char* pstar = strchr(buffer, '*');
-			if (NULL == pstar)
+			reader->Read(diffuse, 4);
+			power = reader->Read<float>();
+			reader->Read(specular, 3);
+			reader->Read(ambient, 3);
+			toon_index = reader->Read<uint8_t>();
+			edge_flag = reader->Read<uint8_t>();
+			index_count = reader->Read<uint32_t>();
+			std::string filename = reader->ReadFixedString(20);
+			size_t pstar = filename.find('*');
+			if (std::string::npos == pstar)
 			{
-				texture_filename = std::string(buffer);
+				texture_filename = filename;
 				sphere_filename.clear();
 			}
 			else {
-				*pstar = NULL;
-				texture_filename = std::string(buffer);
-				sphere_filename = std::string(pstar+1);
+				texture_filename = filename.substr(0, pstar);
+				sphere_filename = filename.substr(pstar + 1);
 			}
 			return true;
 		}
@@ -156,23 +153,19 @@ namespace pmd
 		/// {[̃wbḧʒu
 		float bone_head_pos[3];
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read(buffer, 20);
-			name = std::string(buffer);
-			stream->read((char*) &parent_bone_index, sizeof(uint16_t));
-			stream->read((char*) &tail_pos_bone_index, sizeof(uint16_t));
-			stream->read((char*) &bone_type, sizeof(uint8_t));
-			stream->read((char*) &ik_parent_bone_index, sizeof(uint16_t));
-			stream->read((char*) &bone_head_pos, sizeof(float) * 3);
+			name = reader->ReadFixedString(20);
+			parent_bone_index = reader->Read<uint16_t>();
+			tail_pos_bone_index = reader->Read<uint16_t>();
+			bone_type = reader->Read<BoneType>();
+			ik_parent_bone_index = reader->Read<uint16_t>();
+			reader->Read(bone_head_pos, 3);
 		}
 
-		void ReadExpantion(std::istream *stream)
+		void ReadExpantion(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read(buffer, 20);
-			name_english = std::string(buffer);
+			name_english = reader->ReadFixedString(20);
 		}
 	};
 
@@ -191,19 +184,39 @@ namespace pmd
 		/// e{[ԍ
 		std::vector<uint16_t> ik_child_bone_index;
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			stream->read((char *) &ik_bone_index, sizeof(uint16_t));
-			stream->read((char *) &target_bone_index, sizeof(uint16_t));
-			uint8_t ik_chain_length;
-			stream->read((char*) &ik_chain_length, sizeof(uint8_t));
-			stream->read((char *) &interations, sizeof(uint16_t));
-			stream->read((char *) &angle_limit, sizeof(float));
+			ik_bone_index = reader->Read<uint16_t>();
+			target_bone_index = reader->Read<uint16_t>();
+			uint8_t ik_chain_length = reader->Read<uint8_t>();
+			interations = reader->Read<uint16_t>();
+			angle_limit = reader->Read<float>();
 			ik_child_bone_index.resize(ik_chain_length);
-			for (int i = 0; i < ik_chain_length; i++)
+			reader->Read(ik_child_bone_index.data(), ik_chain_length);
+		}
+
+		/// 1̌vZŉ]łpx(px4{WA)
+		float UnitAngle() const
+		{
+			return angle_limit * 4.0f;
+		}
+
+		/// e{[bone̊pxmin_radian, max_radian(x, y, z)ɋ߁AȂtrueԂ
+		/// PMDɂ͊px̐ݒ肪Ȃ̂ŁAOɁuЂv܂ރ{[X-180x-0.5x͈̔͂ɋȂ悤ɂ
+		static bool LinkLimit(const std::vector<PmdBone> &bones, uint16_t bone, float *min_radian, float *max_radian)
+		{
+			static const char knee[] = "\x82\xd0\x82\xb4";
+			bool limited = bone < bones.size() && bones[bone].name.find(knee) != std::string::npos;
+			for (int c = 0; c < 3; c++)
 			{
-				stream->read((char *) &ik_child_bone_index[i], sizeof(uint16_t));
+				min_radian[c] = max_radian[c] = 0.0f;
 			}
+			if (limited)
+			{
+				min_radian[0] = -3.14159265f;
+				max_radian[0] = -0.00872665f;
+			}
+			return limited;
 		}
 	};
 
@@ -213,10 +226,10 @@ namespace pmd
 		int vertex_index;
 		float position[3];
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			stream->read((char *) &vertex_index, sizeof(int));
-			stream->read((char *) position, sizeof(float) * 3);
+			vertex_index = reader->Read<int>();
+			reader->Read(position, 3);
 		}
 	};
 
@@ -237,26 +250,20 @@ namespace pmd
 		std::vector<PmdFaceVertex> vertices;
 		std::string name_english;
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read(buffer, 20);
-			name = std::string(buffer);
-			int vertex_count;
-			stream->read((char*) &vertex_count, sizeof(int));
-			stream->read((char*) &type, sizeof(uint8_t));
+			name = reader->ReadFixedString(20);
+			int vertex_count = reader->Read<int>();
+			type = reader->Read<FaceCategory>();
 			vertices.resize(vertex_count);
-			for (int i = 0; i < vertex_count; i++)
-			{
-				vertices[i].Read(stream);
-			}
+			// PmdFaceVertex̓t@CƓ16oCg̃CAEgȂ̂ł܂Ƃ߂ēǂ
+			static_assert(sizeof(PmdFaceVertex) == 16, "unexpected PmdFaceVertex layout");
+			reader->Read(vertices.data(), vertex_count);
 		}
 
-		void ReadExpantion(std::istream *stream)
+		void ReadExpantion(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read(buffer, 20);
-			name_english = std::string(buffer);
+			name_english = reader->ReadFixedString(20);
 		}
 	};
 
@@ -267,18 +274,14 @@ namespace pmd
 		std::string bone_disp_name;
 		std::string bone_disp_name_english;
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			char buffer[50];
-			stream->read(buffer, 50);
-			bone_disp_name = std::string(buffer);
+			bone_disp_name = reader->ReadFixedString(50);
 			bone_disp_name_english.clear();
 		}
-		void ReadExpantion(std::istream *stream)
+		void ReadExpantion(oguna::BinaryReader *reader)
 		{
-			char buffer[50];
-			stream->read(buffer, 50);
-			bone_disp_name_english = std::string(buffer);
+			bone_disp_name_english = reader->ReadFixedString(50);
 		}
 	};
 
@@ -288,10 +291,10 @@ namespace pmd
 		uint16_t bone_index;
 		uint8_t bone_disp_index;
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			stream->read((char*) &bone_index, sizeof(uint16_t));
-			stream->read((char*) &bone_disp_index, sizeof(uint8_t));
+			bone_index = reader->Read<uint16_t>();
+			bone_disp_index = reader->Read<uint8_t>();
 		}
 	};
 
@@ -350,24 +353,22 @@ namespace pmd
 		/// Z@
 		RigidBodyType rigid_type;
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read(buffer, sizeof(char) * 20);
-			name = (std::string(buffer));
-			stream->read((char*) &related_bone_index, sizeof(uint16_t));
-			stream->read((char*) &group_index, sizeof(uint8_t));
-			stream->read((char*) &mask, sizeof(uint16_t));
-			stream->read((char*) &shape, sizeof(uint8_t));
-			stream->read((char*) size, sizeof(float) * 3);
-			stream->read((char*) position, sizeof(float) * 3);
-			stream->read((char*) orientation, sizeof(float) * 3);
-			stream->read((char*) &weight, sizeof(float));
-			stream->read((char*) &linear_damping, sizeof(float));
-			stream->read((char*) &anglar_damping, sizeof(float));
-			stream->read((char*) &restitution, sizeof(float));
-			stream->read((char*) &friction, sizeof(float));
-			stream->read((char*) &rigid_type, sizeof(char));
+			name = reader->ReadFixedString(20);
+			related_bone_index = reader->Read<uint16_t>();
+			group_index = reader->Read<uint8_t>();
+			mask = reader->Read<uint16_t>();
+			shape = reader->Read<RigidBodyShape>();
+			reader->Read(size, 3);
+			reader->Read(position, 3);
+			reader->Read(orientation, 3);
+			weight = reader->Read<float>();
+			linear_damping = reader->Read<float>();
+			anglar_damping = reader->Read<float>();
+			restitution = reader->Read<float>();
+			friction = reader->Read<float>();
+			rigid_type = reader->Read<RigidBodyType>();
 		}
 	};
 
@@ -398,21 +399,21 @@ namespace pmd
 		/// ]ɑ΂镜
 		float angular_stiffness[3];
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read(buffer, 20);
-			name = std::string(buffer);
-			stream->read((char *) &rigid_body_index_a, sizeof(uint32_t));
-			stream->read((char *) &rigid_body_index_b, sizeof(uint32_t));
-			stream->read((char *) position, sizeof(float) * 3);
-			stream->read((char *) orientation, sizeof(float) * 3);
-			stream->read((char *) linear_lower_limit, sizeof(float) * 3);
-			stream->read((char *) linear_upper_limit, sizeof(float) * 3);
-			stream->read((char *) angular_lower_limit, sizeof(float) * 3);
-			stream->read((char *) angular_upper_limit, sizeof(float) * 3);
-			stream->read((char *) linear_stiffness, sizeof(float) * 3);
-			stream->read((char *) angular_stiffness, sizeof(float) * 3);
+			name = reader->ReadFixedString(20);
+			rigid_body_index_a = reader->Read<uint32_t>();
+			rigid_body_index_b = reader->Read<uint32_t>();
+			// ʒu]΂˂܂ł24float͘AĂ
+			const char *record = reader->View(sizeof(float) * 24);
+			memcpy(position, record, sizeof(float) * 3);
+			memcpy(orientation, record + 12, sizeof(float) * 3);
+			memcpy(linear_lower_limit, record + 24, sizeof(float) * 3);
+			memcpy(linear_upper_limit, record + 36, sizeof(float) * 3);
+			memcpy(angular_lower_limit, record + 48, sizeof(float) * 3);
+			memcpy(angular_upper_limit, record + 60, sizeof(float) * 3);
+			memcpy(linear_stiffness, record + 72, sizeof(float) * 3);
+			memcpy(angular_stiffness, record + 84, sizeof(float) * 3);
 		}
 	};
 
@@ -437,26 +438,44 @@ namespace pmd
 
 		static std::unique_ptr<PmdModel> LoadFromFile(const char *filename)
 		{
-			std::ifstream stream(filename, std::ios::binary);
-			if (stream.fail())
+			oguna::MappedFile file;
+			if (!file.Open(filename))
 			{
 				std::cerr << "could not open \"" << filename << "\"" << std::endl;
 				return nullptr;
 			}
-			auto result = LoadFromStream(&stream);
-			stream.close();
-			return result;
+			oguna::BinaryReader reader(file.Data(), file.Size());
+			return LoadFromReader(&reader);
 		}
 
 		/// t@CPmdModel𐶐
 		static std::unique_ptr<PmdModel> LoadFromStream(std::ifstream *stream)
+		{
+			oguna::BinaryReader reader(stream);
+			return LoadFromReader(&reader);
+		}
+
+		/// J[\PmdModel𐶐
+		static std::unique_ptr<PmdModel> LoadFromReader(oguna::BinaryReader *reader)
+		{
+			try
+			{
+				return ReadModel(reader);
+			}
+			catch (const char *message)
+			{
+				std::cerr << message << std::endl;
+				return nullptr;
+			}
+		}
+
+	private:
+		static std::unique_ptr<PmdModel> ReadModel(oguna::BinaryReader *reader)
 		{
 			auto result = std::make_unique<PmdModel>();
-			char buffer[100];
 
 			// magic
-			char magic[3];
-			stream->read(magic, 3);
+			const char *magic = reader->View(3);
 			if (magic[0] != 'P' || magic[1] != 'm' || magic[2] != 'd')
 			{
 				std::cerr << "invalid file" << std::endl;
@@ -464,7 +483,7 @@ namespace pmd
 			}
 
 			// version
-			stream->read((char*) &(result->version), sizeof(float));
+			result->version = reader->Read<float>();
 			if (result ->version != 1.0f)
 			{
 				std::cerr << "invalid version" << std::endl;
@@ -472,98 +491,82 @@ namespace pmd
 			}
 
 			// header
-			result->header.Read(stream);
+			result->header.Read(reader);
 
 			// vertices
-			uint32_t vertex_num;
-			stream->read((char*) &vertex_num, sizeof(uint32_t));
+			uint32_t vertex_num = reader->Read<uint32_t>();
 			result->vertices.resize(vertex_num);
 			for (uint32_t i = 0; i < vertex_num; i++)
 			{
-				result->vertices[i].Read(stream);
+				result->vertices[i].Read(reader);
 			}
 
 			// indices
-			uint32_t index_num;
-			stream->read((char*) &index_num, sizeof(uint32_t));
+			uint32_t index_num = reader->Read<uint32_t>();
 			result->indices.resize(index_num);
-			for (uint32_t i = 0; i < index_num; i++)
-			{
-				stream->read((char*) &result->indices[i], sizeof(uint16_t));
-			}
+			reader->Read(result->indices.data(), index_num);
 
 			// materials
-			uint32_t material_num;
-			stream->read((char*) &material_num, sizeof(uint32_t));
+			uint32_t material_num = reader->Read<uint32_t>();
 			result->materials.resize(material_num);
 			for (uint32_t i = 0; i < material_num; i++)
 			{
-				result->materials[i].Read(stream);
+				result->materials[i].Read(reader);
 			}
 
 			// bones
-			uint16_t bone_num;
-			stream->read((char*) &bone_num, sizeof(uint16_t));
+			uint16_t bone_num = reader->Read<uint16_t>();
 			result->bones.resize(bone_num);
 			for (uint32_t i = 0; i < bone_num; i++)
 			{
-				result->bones[i].Read(stream);
+				result->bones[i].Read(reader);
 			}
 
 			// iks
-			uint16_t ik_num;
-			stream->read((char*) &ik_num, sizeof(uint16_t));
+			uint16_t ik_num = reader->Read<uint16_t>();
 			result->iks.resize(ik_num);
 			for (uint32_t i = 0; i < ik_num; i++)
 			{
-				result->iks[i].Read(stream);
+				result->iks[i].Read(reader);
 			}
 
 			// faces
-			uint16_t face_num;
-			stream->read((char*) &face_num, sizeof(uint16_t));
+			uint16_t face_num = reader->Read<uint16_t>();
 			result->faces.resize(face_num);
 			for (uint32_t i = 0; i < face_num; i++)
 			{
-				result->faces[i].Read(stream);
+				result->faces[i].Read(reader);
 			}
 
 			// face frames
-			uint8_t face_frame_num;
-			stream->read((char*) &face_frame_num, sizeof(uint8_t));
+			uint8_t face_frame_num = reader->Read<uint8_t>();
 			result->faces_indices.resize(face_frame_num);
-			for (uint32_t i = 0; i < face_frame_num; i++)
-			{
-				stream->read((char*) &result->faces_indices[i], sizeof(uint16_t));
-			}
+			reader->Read(result->faces_indices.data(), face_frame_num);
 
 			// bone names
-			uint8_t bone_disp_num;
-			stream->read((char*) &bone_disp_num, sizeof(uint8_t));
+			uint8_t bone_disp_num = reader->Read<uint8_t>();
 			result->bone_disp_name.resize(bone_disp_num);
 			for (uint32_t i = 0; i < bone_disp_num; i++)
 			{
-				result->bone_disp_name[i].Read(stream);
+				result->bone_disp_name[i].Read(reader);
 			}
 
 			// bone frame
-			uint32_t bone_frame_num;
-			stream->read((char*) &bone_frame_num, sizeof(uint32_t));
+			uint32_t bone_frame_num = reader->Read<uint32_t>();
 			result->bone_disp.resize(bone_frame_num);
 			for (uint32_t i = 0; i < bone_frame_num; i++)
 			{
-				result->bone_disp[i].Read(stream);
+				result->bone_disp[i].Read(reader);
 			}
 
 			// english name
-			bool english;
-			stream->read((char*) &english, sizeof(char));
+			bool english = reader->Read<uint8_t>() != 0;
 			if (english)
 			{
-				result->header.ReadExtension(stream);
+				result->header.ReadExtension(reader);
 				for (uint32_t i = 0; i < bone_num; i++)
 				{
-					result->bones[i].ReadExpantion(stream);
+					result->bones[i].ReadExpantion(reader);
 				}
 				for (uint32_t i = 0; i < face_num; i++)
 				{
@@ -571,16 +574,16 @@ namespace pmd
 					{
 						continue;
 					}
-					result->faces[i].ReadExpantion(stream);
+					result->faces[i].ReadExpantion(reader);
 				}
 				for (uint32_t i = 0; i < result->bone_disp_name.size(); i++)
 				{
-					result->bone_disp_name[i].ReadExpantion(stream);
+					result->bone_disp_name[i].ReadExpantion(reader);
 				}
 			}
 
 			// toon textures
-			if (stream->peek() == std::ios::traits_type::eof())
+			if (reader->Eof())
 			{
 				result->toon_filenames.clear();
 			}
@@ -588,35 +591,32 @@ namespace pmd
 				result->toon_filenames.resize(10);
 				for (uint32_t i = 0; i < 10; i++)
 				{
-					stream->read(buffer, 100);
-					result->toon_filenames[i] = std::string(buffer);
+					result->toon_filenames[i] = reader->ReadFixedString(100);
 				}
 			}
 
 			// physics
-			if (stream->peek() == std::ios::traits_type::eof())
+			if (reader->Eof())
 			{
 				result->rigid_bodies.clear();
 				result->constraints.clear();
 			}
 			else {
-				uint32_t rigid_body_num;
-				stream->read((char*) &rigid_body_num, sizeof(uint32_t));
+				uint32_t rigid_body_num = reader->Read<uint32_t>();
 				result->rigid_bodies.resize(rigid_body_num);
 				for (uint32_t i = 0; i < rigid_body_num; i++)
 				{
-					result->rigid_bodies[i].Read(stream);
+					result->rigid_bodies[i].Read(reader);
 				}
-				uint32_t constraint_num;
-				stream->read((char*) &constraint_num, sizeof(uint32_t));
+				uint32_t constraint_num = reader->Read<uint32_t>();
 				result->constraints.resize(constraint_num);
 				for (uint32_t i = 0; i < constraint_num; i++)
 				{
-					result->constraints[i].Read(stream);
+					result->constraints[i].Read(reader);
 				}
 			}
 
-			if (stream->peek() != std::ios::traits_type::eof())
+			if (!reader->Eof())
 			{
 				std::cerr << "there is unknown data" << std::endl;
 			}
@@ -1,16 +1,20 @@
 #include "Pmx.h"
+#include <algorithm>
 #include "EncodingHelper.h"
+#include "MappedFile.h"
+#include "SimdHelper.h"
+#include "ThreadPool.h"
 
 namespace pmx
 {
 	/// CfbNXlǂݍ
-	int ReadIndex(std::istream *stream, int size)
+	int ReadIndex(oguna::BinaryReader *reader, int size)
 	{
 		switch (size)
 		{
 		case 1:
 			uint8_t tmp8;
-			stream->read((char*) &tmp8, sizeof(uint8_t));
+			tmp8 = reader->Read<uint8_t>();
 			if (255 == tmp8)
 			{
 				return -1;
@@ -20,7 +24,7 @@ namespace pmx
 			}
 		case 2:
 			uint16_t tmp16;
-			stream->read((char*) &tmp16, sizeof(uint16_t));
+			tmp16 = reader->Read<uint16_t>();
 			if (65535 == tmp16)
 			{
 				return -1;
@@ -30,562 +34,2110 @@ namespace pmx
 			}
 		case 4:
 			int tmp32;
-			stream->read((char*) &tmp32, sizeof(int));
+			tmp32 = reader->Read<int>();
 			return tmp32;
 		default:
 			return -1;
 		}
 	}
 
+	/// CfbNXl̔z܂Ƃ߂int֍L(255/65535-1ɂ)
+	void ReadIndices(oguna::BinaryReader *reader, int size, int *out, int count)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+		if (size == 4)
+		{
+			reader->Read(out, count);
+			return;
+		}
+		if (size != 1 && size != 2)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				out[i] = -1;
+			}
+			return;
+		}
+		const uint8_t *src = (const uint8_t*) reader->View(size * count);
+		int i = 0;
+		if (size == 1)
+		{
+#if defined(OGUNA_AVX2)
+			const __m256i none = _mm256_set1_epi32(255);
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256i value = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (src + i)));
+				value = _mm256_or_si256(value, _mm256_cmpeq_epi32(value, none));
+				_mm256_storeu_si256((__m256i*) (out + i), value);
+			}
+#elif defined(OGUNA_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i none = _mm_set1_epi32(255);
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i bytes = _mm_loadu_si128((const __m128i*) (src + i));
+				__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+				__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+				__m128i v0 = _mm_unpacklo_epi16(lo, zero);
+				__m128i v1 = _mm_unpackhi_epi16(lo, zero);
+				__m128i v2 = _mm_unpacklo_epi16(hi, zero);
+				__m128i v3 = _mm_unpackhi_epi16(hi, zero);
+				_mm_storeu_si128((__m128i*) (out + i), _mm_or_si128(v0, _mm_cmpeq_epi32(v0, none)));
+				_mm_storeu_si128((__m128i*) (out + i + 4), _mm_or_si128(v1, _mm_cmpeq_epi32(v1, none)));
+				_mm_storeu_si128((__m128i*) (out + i + 8), _mm_or_si128(v2, _mm_cmpeq_epi32(v2, none)));
+				_mm_storeu_si128((__m128i*) (out + i + 12), _mm_or_si128(v3, _mm_cmpeq_epi32(v3, none)));
+			}
+#endif
+			for (; i < count; i++)
+			{
+				out[i] = src[i] == 255 ? -1 : (int) src[i];
+			}
+		}
+		else
+		{
+#if defined(OGUNA_AVX2)
+			const __m256i none = _mm256_set1_epi32(65535);
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256i value = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (src + i * 2)));
+				value = _mm256_or_si256(value, _mm256_cmpeq_epi32(value, none));
+				_mm256_storeu_si256((__m256i*) (out + i), value);
+			}
+#elif defined(OGUNA_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i none = _mm_set1_epi32(65535);
+			for (; i + 8 <= count; i += 8)
+			{
+				__m128i units = _mm_loadu_si128((const __m128i*) (src + i * 2));
+				__m128i v0 = _mm_unpacklo_epi16(units, zero);
+				__m128i v1 = _mm_unpackhi_epi16(units, zero);
+				_mm_storeu_si128((__m128i*) (out + i), _mm_or_si128(v0, _mm_cmpeq_epi32(v0, none)));
+				_mm_storeu_si128((__m128i*) (out + i + 4), _mm_or_si128(v1, _mm_cmpeq_epi32(v1, none)));
+			}
+#endif
+			for (; i < count; i++)
+			{
+				uint16_t value;
+				memcpy(&value, src + i * 2, sizeof(uint16_t));
+				out[i] = value == 65535 ? -1 : (int) value;
+			}
+		}
+	}
+
 	/// ǂݍ
-	std::wstring ReadString(std::istream *stream, uint8_t encoding)
+	std::wstring ReadString(oguna::BinaryReader *reader, uint8_t encoding)
 	{
-		oguna::EncodingConverter converter = oguna::EncodingConverter();
 		int size;
-		stream->read((char*) &size, sizeof(int));
-		std::vector<char> buffer;
+		size = reader->Read<int>();
+		std::wstring result;
 		if (size == 0)
 		{
-			return std::wstring(L"");
+			return result;
+		}
+		// obt@ɃRs[t@C̃oCg񂩂璼ڕϊ
+		const char *buffer = reader->View(size);
+		if (encoding == 0)
+		{
+			// UTF16
+			oguna::EncodingConverter::Utf16LeToUtf16(buffer, size, &result);
+		}
+		else
+		{
+			// UTF8
+			oguna::EncodingConverter::Utf8ToUtf16(buffer, size, &result);
+		}
+		return result;
+	}
+
+	/// vfcount̔zŵɕKvȍŏ̃CfbNXTCY
+	/// _CfbNX͕ȂAȊO-1(Ȃ)\悤ɕtƂĈ
+	uint8_t MinimalIndexSize(int count, bool is_vertex)
+	{
+		if (count <= (is_vertex ? 255 : 127))
+		{
+			return 1;
+		}
+		if (count <= (is_vertex ? 65535 : 32767))
+		{
+			return 2;
+		}
+		return 4;
+	}
+
+	/// CfbNXl(̒l255/65535/-1ɂ)
+	void WriteIndex(oguna::BinaryWriter *writer, int value, int size)
+	{
+		switch (size)
+		{
+		case 1:
+			writer->Write<uint8_t>(value < 0 ? 255 : (uint8_t) value);
+			break;
+		case 2:
+			writer->Write<uint16_t>(value < 0 ? 65535 : (uint16_t) value);
+			break;
+		case 4:
+			writer->Write<int>(value);
+			break;
+		default:
+			throw "invalid index size";
+		}
+	}
+
+	/// CfbNXl̔z܂Ƃ߂sizeoCg֋l߂ď
+	void WriteIndices(oguna::BinaryWriter *writer, int size, const int *values, int count)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+		if (size == 4)
+		{
+			writer->Write(values, count);
+			return;
 		}
-		buffer.resize(size);
-		stream->read((char*) buffer.data(), size);
+		char *out = writer->Append((size_t) size * count);
+		if (size == 1)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				out[i] = (char) (values[i] < 0 ? 255 : values[i]);
+			}
+		}
+		else if (size == 2)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				uint16_t value = (uint16_t) (values[i] < 0 ? 65535 : values[i]);
+				memcpy(out + i * 2, &value, sizeof(uint16_t));
+			}
+		}
+		else
+		{
+			throw "invalid index size";
+		}
+	}
+
+	/// 
+	void WriteString(oguna::BinaryWriter *writer, const std::wstring &value, uint8_t encoding)
+	{
+		if (value.empty())
+		{
+			writer->Write<int>(0);
+			return;
+		}
+		if (encoding == 0 && sizeof(wchar_t) == 2)
+		{
+			// UTF16͂̂܂܃Rs[
+			writer->Write<int>((int) (value.size() * sizeof(wchar_t)));
+			writer->Write(value.data(), value.size());
+			return;
+		}
+		// ϊp̗͎̈g
+		static thread_local std::string buffer;
 		if (encoding == 0)
 		{
-			// UTF16
-			return std::wstring((wchar_t*) buffer.data(), size / 2);
+			oguna::EncodingConverter::Utf16ToUtf16Le(value.data(), (int) value.size(), &buffer);
+		}
+		else
+		{
+			oguna::EncodingConverter::Utf16ToUtf8(value.data(), (int) value.size(), &buffer);
+		}
+		writer->Write<int>((int) buffer.size());
+		writer->Write(buffer.data(), buffer.size());
+	}
+
+	void PmxSetting::Read(oguna::BinaryReader *reader)
+	{
+		uint8_t count;
+		count = reader->Read<uint8_t>();
+		if (count < 8)
+		{
+			throw;
+		}
+		encoding = reader->Read<uint8_t>();
+		uv = reader->Read<uint8_t>();
+		vertex_index_size = reader->Read<uint8_t>();
+		texture_index_size = reader->Read<uint8_t>();
+		material_index_size = reader->Read<uint8_t>();
+		bone_index_size = reader->Read<uint8_t>();
+		morph_index_size = reader->Read<uint8_t>();
+		rigidbody_index_size = reader->Read<uint8_t>();
+		reader->Skip(count - 8);
+	}
+
+	void PmxSetting::Write(oguna::BinaryWriter *writer) const
+	{
+		writer->Write<uint8_t>(8);
+		writer->Write(encoding);
+		writer->Write(uv);
+		writer->Write(vertex_index_size);
+		writer->Write(texture_index_size);
+		writer->Write(material_index_size);
+		writer->Write(bone_index_size);
+		writer->Write(morph_index_size);
+		writer->Write(rigidbody_index_size);
+	}
+
+	void PmxVertexSkinningBDEF1::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->bone_index = ReadIndex(reader, setting->bone_index_size);
+	}
+
+	void PmxVertexSkinningBDEF1::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->bone_index, setting->bone_index_size);
+	}
+
+	void PmxVertexSkinningBDEF2::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->bone_index1 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index2 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_weight = reader->Read<float>();
+	}
+
+	void PmxVertexSkinningBDEF2::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->bone_index1, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index2, setting->bone_index_size);
+		writer->Write(this->bone_weight);
+	}
+
+	void PmxVertexSkinningBDEF4::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->bone_index1 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index2 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index3 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index4 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_weight1 = reader->Read<float>();
+		this->bone_weight2 = reader->Read<float>();
+		this->bone_weight3 = reader->Read<float>();
+		this->bone_weight4 = reader->Read<float>();
+	}
+
+	void PmxVertexSkinningBDEF4::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->bone_index1, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index2, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index3, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index4, setting->bone_index_size);
+		writer->Write(this->bone_weight1);
+		writer->Write(this->bone_weight2);
+		writer->Write(this->bone_weight3);
+		writer->Write(this->bone_weight4);
+	}
+
+	void PmxVertexSkinningSDEF::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->bone_index1 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index2 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_weight = reader->Read<float>();
+		reader->Read(this->sdef_c, 3);
+		reader->Read(this->sdef_r0, 3);
+		reader->Read(this->sdef_r1, 3);
+	}
+
+	void PmxVertexSkinningSDEF::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->bone_index1, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index2, setting->bone_index_size);
+		writer->Write(this->bone_weight);
+		writer->Write(this->sdef_c, 3);
+		writer->Write(this->sdef_r0, 3);
+		writer->Write(this->sdef_r1, 3);
+	}
+
+	void PmxVertexSkinningQDEF::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->bone_index1 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index2 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index3 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_index4 = ReadIndex(reader, setting->bone_index_size);
+		this->bone_weight1 = reader->Read<float>();
+		this->bone_weight2 = reader->Read<float>();
+		this->bone_weight3 = reader->Read<float>();
+		this->bone_weight4 = reader->Read<float>();
+	}
+
+	void PmxVertexSkinningQDEF::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->bone_index1, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index2, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index3, setting->bone_index_size);
+		WriteIndex(writer, this->bone_index4, setting->bone_index_size);
+		writer->Write(this->bone_weight1);
+		writer->Write(this->bone_weight2);
+		writer->Write(this->bone_weight3);
+		writer->Write(this->bone_weight4);
+	}
+
+	void PmxPackedSkinning::Resize(int vertex_count)
+	{
+		types.assign(vertex_count, PmxVertexSkinningType::BDEF1);
+		bone_indices.assign(vertex_count * 4, 0);
+		bone_weights.assign(vertex_count * 4, 0.0f);
+		sdef.clear();
+	}
+
+	void PmxPackedSkinning::Read(oguna::BinaryReader *reader, PmxSetting *setting, int vertex, PmxVertexSkinningType type, std::vector<PmxSdefParameter> *sdef_out)
+	{
+		int *index = &bone_indices[vertex * 4];
+		float *weight = &bone_weights[vertex * 4];
+		types[vertex] = type;
+		switch (type)
+		{
+		case PmxVertexSkinningType::BDEF1:
+			index[0] = ReadIndex(reader, setting->bone_index_size);
+			weight[0] = 1.0f;
+			break;
+		case PmxVertexSkinningType::BDEF2:
+			index[0] = ReadIndex(reader, setting->bone_index_size);
+			index[1] = ReadIndex(reader, setting->bone_index_size);
+			weight[0] = reader->Read<float>();
+			weight[1] = 1.0f - weight[0];
+			break;
+		case PmxVertexSkinningType::BDEF4:
+		case PmxVertexSkinningType::QDEF:
+			for (int i = 0; i < 4; i++)
+			{
+				index[i] = ReadIndex(reader, setting->bone_index_size);
+			}
+			reader->Read(weight, 4);
+			break;
+		case PmxVertexSkinningType::SDEF:
+		{
+			index[0] = ReadIndex(reader, setting->bone_index_size);
+			index[1] = ReadIndex(reader, setting->bone_index_size);
+			weight[0] = reader->Read<float>();
+			weight[1] = 1.0f - weight[0];
+			PmxSdefParameter parameter;
+			parameter.vertex_index = vertex;
+			reader->Read(parameter.sdef_c, 3);
+			reader->Read(parameter.sdef_r0, 3);
+			reader->Read(parameter.sdef_r1, 3);
+			(sdef_out ? sdef_out : &sdef)->push_back(parameter);
+			break;
+		}
+		default:
+			throw "invalid skinning type";
+		}
+	}
+
+	void PmxPackedSkinning::Pack(const PmxVertex *vertices, int vertex_count)
+	{
+		Resize(vertex_count);
+		for (int i = 0; i < vertex_count; i++)
+		{
+			int *index = &bone_indices[i * 4];
+			float *weight = &bone_weights[i * 4];
+			const PmxVertexSkinning *skinning = vertices[i].skinning.get();
+			types[i] = vertices[i].skinning_type;
+			switch (vertices[i].skinning_type)
+			{
+			case PmxVertexSkinningType::BDEF1:
+			{
+				auto bdef1 = static_cast<const PmxVertexSkinningBDEF1*>(skinning);
+				index[0] = bdef1->bone_index;
+				weight[0] = 1.0f;
+				break;
+			}
+			case PmxVertexSkinningType::BDEF2:
+			{
+				auto bdef2 = static_cast<const PmxVertexSkinningBDEF2*>(skinning);
+				index[0] = bdef2->bone_index1;
+				index[1] = bdef2->bone_index2;
+				weight[0] = bdef2->bone_weight;
+				weight[1] = 1.0f - bdef2->bone_weight;
+				break;
+			}
+			case PmxVertexSkinningType::BDEF4:
+			{
+				auto bdef4 = static_cast<const PmxVertexSkinningBDEF4*>(skinning);
+				index[0] = bdef4->bone_index1;
+				index[1] = bdef4->bone_index2;
+				index[2] = bdef4->bone_index3;
+				index[3] = bdef4->bone_index4;
+				weight[0] = bdef4->bone_weight1;
+				weight[1] = bdef4->bone_weight2;
+				weight[2] = bdef4->bone_weight3;
+				weight[3] = bdef4->bone_weight4;
+				break;
+			}
+			case PmxVertexSkinningType::SDEF:
+			{
+				auto sdef = static_cast<const PmxVertexSkinningSDEF*>(skinning);
+				index[0] = sdef->bone_index1;
+				index[1] = sdef->bone_index2;
+				weight[0] = sdef->bone_weight;
+				weight[1] = 1.0f - sdef->bone_weight;
+				PmxSdefParameter parameter;
+				parameter.vertex_index = i;
+				memcpy(parameter.sdef_c, sdef->sdef_c, sizeof(float) * 3);
+				memcpy(parameter.sdef_r0, sdef->sdef_r0, sizeof(float) * 3);
+				memcpy(parameter.sdef_r1, sdef->sdef_r1, sizeof(float) * 3);
+				this->sdef.push_back(parameter);
+				break;
+			}
+			case PmxVertexSkinningType::QDEF:
+			{
+				auto qdef = static_cast<const PmxVertexSkinningQDEF*>(skinning);
+				index[0] = qdef->bone_index1;
+				index[1] = qdef->bone_index2;
+				index[2] = qdef->bone_index3;
+				index[3] = qdef->bone_index4;
+				weight[0] = qdef->bone_weight1;
+				weight[1] = qdef->bone_weight2;
+				weight[2] = qdef->bone_weight3;
+				weight[3] = qdef->bone_weight4;
+				break;
+			}
+			}
+		}
+	}
+
+	void PmxPackedSkinning::Write(oguna::BinaryWriter *writer, const PmxSetting *setting, int vertex, size_t *sdef_cursor) const
+	{
+		const int *index = &bone_indices[vertex * 4];
+		const float *weight = &bone_weights[vertex * 4];
+		PmxVertexSkinningType type = types[vertex];
+		writer->Write(type);
+		switch (type)
+		{
+		case PmxVertexSkinningType::BDEF1:
+			WriteIndex(writer, index[0], setting->bone_index_size);
+			break;
+		case PmxVertexSkinningType::BDEF2:
+			WriteIndex(writer, index[0], setting->bone_index_size);
+			WriteIndex(writer, index[1], setting->bone_index_size);
+			writer->Write(weight[0]);
+			break;
+		case PmxVertexSkinningType::BDEF4:
+		case PmxVertexSkinningType::QDEF:
+			for (int i = 0; i < 4; i++)
+			{
+				WriteIndex(writer, index[i], setting->bone_index_size);
+			}
+			writer->Write(weight, 4);
+			break;
+		case PmxVertexSkinningType::SDEF:
+		{
+			WriteIndex(writer, index[0], setting->bone_index_size);
+			WriteIndex(writer, index[1], setting->bone_index_size);
+			writer->Write(weight[0]);
+			// sdef͒_ɕł̂őO珇ɒT
+			while (*sdef_cursor < sdef.size() && sdef[*sdef_cursor].vertex_index < vertex)
+			{
+				(*sdef_cursor)++;
+			}
+			PmxSdefParameter parameter;
+			if (*sdef_cursor < sdef.size() && sdef[*sdef_cursor].vertex_index == vertex)
+			{
+				parameter = sdef[*sdef_cursor];
+			}
+			writer->Write(parameter.sdef_c, 3);
+			writer->Write(parameter.sdef_r0, 3);
+			writer->Write(parameter.sdef_r1, 3);
+			break;
+		}
+		default:
+			throw "invalid skinning type";
+		}
+	}
+
+	void PmxVertex::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->Read(reader, setting, nullptr, 0);
+	}
+
+	void PmxVertex::Read(oguna::BinaryReader *reader, PmxSetting *setting, PmxPackedSkinning *packed, int index, std::vector<PmxSdefParameter> *sdef_out)
+	{
+		// ʒuE@EUV͌Œ蒷Ȃ̂ł܂Ƃ߂ăRs[
+		const char *fixed = reader->View(sizeof(float) * 8);
+		memcpy(this->positon, fixed, sizeof(float) * 3);
+		memcpy(this->normal, fixed + sizeof(float) * 3, sizeof(float) * 3);
+		memcpy(this->uv, fixed + sizeof(float) * 6, sizeof(float) * 2);
+		if (setting->uv > 0)
+		{
+			memcpy(this->uva, reader->View(sizeof(float) * 4 * setting->uv), sizeof(float) * 4 * setting->uv);
+		}
+		this->skinning_type = reader->Read<PmxVertexSkinningType>();
+		if (packed)
+		{
+			// _Ƃ̃q[vmۂAz֊i[
+			packed->Read(reader, setting, index, this->skinning_type, sdef_out);
+			this->edge = reader->Read<float>();
+			return;
+		}
+		switch (this->skinning_type)
+		{
+		case PmxVertexSkinningType::BDEF1:
+			this->skinning = std::make_unique<PmxVertexSkinningBDEF1>();
+			break;
+		case PmxVertexSkinningType::BDEF2:
+			this->skinning = std::make_unique<PmxVertexSkinningBDEF2>();
+			break;
+		case PmxVertexSkinningType::BDEF4:
+			this->skinning = std::make_unique<PmxVertexSkinningBDEF4>();
+			break;
+		case PmxVertexSkinningType::SDEF:
+			this->skinning = std::make_unique<PmxVertexSkinningSDEF>();
+			break;
+		case PmxVertexSkinningType::QDEF:
+			this->skinning = std::make_unique<PmxVertexSkinningQDEF>();
+			break;
+		default:
+			throw "invalid skinning type";
+		}
+		this->skinning->Read(reader, setting);
+		this->edge = reader->Read<float>();
+	}
+
+	void PmxVertex::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		this->Write(writer, setting, nullptr, 0, nullptr);
+	}
+
+	void PmxVertex::Write(oguna::BinaryWriter *writer, const PmxSetting *setting, const PmxPackedSkinning *packed, int index, size_t *sdef_cursor) const
+	{
+		char *fixed = writer->Append(sizeof(float) * (8 + 4 * setting->uv));
+		memcpy(fixed, this->positon, sizeof(float) * 3);
+		memcpy(fixed + sizeof(float) * 3, this->normal, sizeof(float) * 3);
+		memcpy(fixed + sizeof(float) * 6, this->uv, sizeof(float) * 2);
+		if (setting->uv > 0)
+		{
+			memcpy(fixed + sizeof(float) * 8, this->uva, sizeof(float) * 4 * setting->uv);
+		}
+		if (this->skinning)
+		{
+			writer->Write(this->skinning_type);
+			this->skinning->Write(writer, setting);
+		}
+		else if (packed)
+		{
+			packed->Write(writer, setting, index, sdef_cursor);
+		}
+		else
+		{
+			throw "vertex has no skinning";
+		}
+		writer->Write(this->edge);
+	}
+
+	void PmxVertexColumns::Resize(int vertex_count, int additional_uv_count)
+	{
+		this->vertex_count = vertex_count;
+		this->additional_uv_count = additional_uv_count;
+		positions.Resize(vertex_count * 3);
+		normals.Resize(vertex_count * 3);
+		uvs.Resize(vertex_count * 2);
+		edges.Resize(vertex_count);
+		for (int i = 0; i < 4; i++)
+		{
+			additional_uvs[i].Resize(i < additional_uv_count ? vertex_count * 4 : 0);
+		}
+	}
+
+	void PmxVertexColumns::Read(oguna::BinaryReader *reader, PmxSetting *setting, PmxPackedSkinning *packed, int index, std::vector<PmxSdefParameter> *sdef_out)
+	{
+		const char *fixed = reader->View(sizeof(float) * 8);
+		memcpy(&positions[index * 3], fixed, sizeof(float) * 3);
+		memcpy(&normals[index * 3], fixed + sizeof(float) * 3, sizeof(float) * 3);
+		memcpy(&uvs[index * 2], fixed + sizeof(float) * 6, sizeof(float) * 2);
+		if (setting->uv > 0)
+		{
+			const char *uva = reader->View(sizeof(float) * 4 * setting->uv);
+			for (int i = 0; i < setting->uv; i++)
+			{
+				memcpy(&additional_uvs[i][index * 4], uva + sizeof(float) * 4 * i, sizeof(float) * 4);
+			}
+		}
+		packed->Read(reader, setting, index, reader->Read<PmxVertexSkinningType>(), sdef_out);
+		edges[index] = reader->Read<float>();
+	}
+
+	void PmxVertexColumns::Write(oguna::BinaryWriter *writer, const PmxSetting *setting, const PmxPackedSkinning *packed, int index, size_t *sdef_cursor) const
+	{
+		char *fixed = writer->Append(sizeof(float) * (8 + 4 * setting->uv));
+		memcpy(fixed, &positions[index * 3], sizeof(float) * 3);
+		memcpy(fixed + sizeof(float) * 3, &normals[index * 3], sizeof(float) * 3);
+		memcpy(fixed + sizeof(float) * 6, &uvs[index * 2], sizeof(float) * 2);
+		for (int i = 0; i < setting->uv; i++)
+		{
+			// 񂪖ǉUV0Ƃ
+			if (i < additional_uv_count)
+			{
+				memcpy(fixed + sizeof(float) * (8 + 4 * i), &additional_uvs[i][index * 4], sizeof(float) * 4);
+			}
+			else
+			{
+				memset(fixed + sizeof(float) * (8 + 4 * i), 0, sizeof(float) * 4);
+			}
+		}
+		packed->Write(writer, setting, index, sdef_cursor);
+		writer->Write(edges[index]);
+	}
+
+	void PmxVertexColumns::Pack(const PmxVertex *vertices, int vertex_count, int additional_uv_count)
+	{
+		Resize(vertex_count, additional_uv_count);
+		for (int i = 0; i < vertex_count; i++)
+		{
+			memcpy(&positions[i * 3], vertices[i].positon, sizeof(float) * 3);
+			memcpy(&normals[i * 3], vertices[i].normal, sizeof(float) * 3);
+			memcpy(&uvs[i * 2], vertices[i].uv, sizeof(float) * 2);
+			for (int k = 0; k < additional_uv_count; k++)
+			{
+				memcpy(&additional_uvs[k][i * 4], vertices[i].uva[k], sizeof(float) * 4);
+			}
+			edges[i] = vertices[i].edge;
+		}
+	}
+
+	size_t PmxVertexColumns::MemorySize() const
+	{
+		size_t size = sizeof(float) * (positions.Size() + normals.Size() + uvs.Size() + edges.Size());
+		for (int i = 0; i < 4; i++)
+		{
+			size += sizeof(float) * additional_uvs[i].Size();
+		}
+		return size;
+	}
+
+	void PmxMaterial::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->material_name = ReadString(reader, setting->encoding);
+		this->material_english_name = ReadString(reader, setting->encoding);
+		reader->Read(this->diffuse, 4);
+		reader->Read(this->specular, 3);
+		this->specularlity = reader->Read<float>();
+		reader->Read(this->ambient, 3);
+		this->flag = reader->Read<uint8_t>();
+		reader->Read(this->edge_color, 4);
+		this->edge_size = reader->Read<float>();
+		this->diffuse_texture_index = ReadIndex(reader, setting->texture_index_size);
+		this->sphere_texture_index = ReadIndex(reader, setting->texture_index_size);
+		this->sphere_op_mode = reader->Read<uint8_t>();
+		this->common_toon_flag = reader->Read<uint8_t>();
+		if (this->common_toon_flag)
+		{
+			this->toon_texture_index = reader->Read<uint8_t>();
+		}
+		else {
+			this->toon_texture_index = ReadIndex(reader, setting->texture_index_size);
+		}
+		this->memo = ReadString(reader, setting->encoding);
+		this->index_count = reader->Read<int>();
+	}
+
+	void PmxMaterial::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteString(writer, this->material_name, setting->encoding);
+		WriteString(writer, this->material_english_name, setting->encoding);
+		writer->Write(this->diffuse, 4);
+		writer->Write(this->specular, 3);
+		writer->Write(this->specularlity);
+		writer->Write(this->ambient, 3);
+		writer->Write(this->flag);
+		writer->Write(this->edge_color, 4);
+		writer->Write(this->edge_size);
+		WriteIndex(writer, this->diffuse_texture_index, setting->texture_index_size);
+		WriteIndex(writer, this->sphere_texture_index, setting->texture_index_size);
+		writer->Write(this->sphere_op_mode);
+		writer->Write(this->common_toon_flag);
+		if (this->common_toon_flag)
+		{
+			writer->Write<uint8_t>((uint8_t) this->toon_texture_index);
+		}
+		else {
+			WriteIndex(writer, this->toon_texture_index, setting->texture_index_size);
+		}
+		WriteString(writer, this->memo, setting->encoding);
+		writer->Write(this->index_count);
+	}
+
+	void PmxIkLink::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->link_target = ReadIndex(reader, setting->bone_index_size);
+		this->angle_lock = reader->Read<uint8_t>();
+		if (angle_lock == 1)
+		{
+			reader->Read(this->max_radian, 3);
+			reader->Read(this->min_radian, 3);
+		}
+	}
+
+	void PmxIkLink::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->link_target, setting->bone_index_size);
+		writer->Write(this->angle_lock);
+		if (angle_lock == 1)
+		{
+			writer->Write(this->max_radian, 3);
+			writer->Write(this->min_radian, 3);
+		}
+	}
+
+	void PmxBone::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->bone_name = ReadString(reader, setting->encoding);
+		this->bone_english_name = ReadString(reader, setting->encoding);
+		reader->Read(this->position, 3);
+		this->parent_index = ReadIndex(reader, setting->bone_index_size);
+		this->level = reader->Read<int>();
+		this->bone_flag = reader->Read<uint16_t>();
+		if (this->bone_flag & 0x0001) {
+			this->target_index = ReadIndex(reader, setting->bone_index_size);
+		}
+		else {
+			reader->Read(this->offset, 3);
+		}
+		if (this->bone_flag & (0x0100 | 0x0200)) {
+			this->grant_parent_index = ReadIndex(reader, setting->bone_index_size);
+			this->grant_weight = reader->Read<float>();
+		}
+		if (this->bone_flag & 0x0400) {
+			reader->Read(this->lock_axis_orientation, 3);
+		}
+		if (this->bone_flag & 0x0800) {
+			reader->Read(this->local_axis_x_orientation, 3);
+			reader->Read(this->local_axis_y_orientation, 3);
+		}
+		if (this->bone_flag & 0x2000) {
+			this->key = reader->Read<int>();
+		}
+		if (this->bone_flag & 0x0020) {
+			this->ik_target_bone_index = ReadIndex(reader, setting->bone_index_size);
+			ik_loop = reader->Read<int>();
+			ik_loop_angle_limit = reader->Read<float>();
+			ik_link_count = reader->Read<int>();
+			this->ik_links = std::make_unique<PmxIkLink []>(ik_link_count);
+			for (int i = 0; i < ik_link_count; i++) {
+				ik_links[i].Read(reader, setting);
+			}
+		}
+	}
+
+	void PmxBone::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteString(writer, this->bone_name, setting->encoding);
+		WriteString(writer, this->bone_english_name, setting->encoding);
+		writer->Write(this->position, 3);
+		WriteIndex(writer, this->parent_index, setting->bone_index_size);
+		writer->Write(this->level);
+		writer->Write(this->bone_flag);
+		if (this->bone_flag & 0x0001) {
+			WriteIndex(writer, this->target_index, setting->bone_index_size);
+		}
+		else {
+			writer->Write(this->offset, 3);
+		}
+		if (this->bone_flag & (0x0100 | 0x0200)) {
+			WriteIndex(writer, this->grant_parent_index, setting->bone_index_size);
+			writer->Write(this->grant_weight);
+		}
+		if (this->bone_flag & 0x0400) {
+			writer->Write(this->lock_axis_orientation, 3);
+		}
+		if (this->bone_flag & 0x0800) {
+			writer->Write(this->local_axis_x_orientation, 3);
+			writer->Write(this->local_axis_y_orientation, 3);
+		}
+		if (this->bone_flag & 0x2000) {
+			writer->Write(this->key);
+		}
+		if (this->bone_flag & 0x0020) {
+			WriteIndex(writer, this->ik_target_bone_index, setting->bone_index_size);
+			writer->Write(ik_loop);
+			writer->Write(ik_loop_angle_limit);
+			writer->Write(ik_link_count);
+			for (int i = 0; i < ik_link_count; i++) {
+				ik_links[i].Write(writer, setting);
+			}
+		}
+	}
+
+	void PmxMorphVertexOffset::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->vertex_index = ReadIndex(reader, setting->vertex_index_size);
+		reader->Read(this->position_offset, 3);
+	}
+
+	void PmxMorphVertexOffset::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->vertex_index, setting->vertex_index_size);
+		writer->Write(this->position_offset, 3);
+	}
+
+	void PmxMorphUVOffset::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->vertex_index = ReadIndex(reader, setting->vertex_index_size);
+		reader->Read(this->uv_offset, 4);
+	}
+
+	void PmxMorphUVOffset::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->vertex_index, setting->vertex_index_size);
+		writer->Write(this->uv_offset, 4);
+	}
+
+	void PmxMorphBoneOffset::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->bone_index = ReadIndex(reader, setting->bone_index_size);
+		reader->Read(this->translation, 3);
+		reader->Read(this->rotation, 4);
+	}
+
+	void PmxMorphBoneOffset::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->bone_index, setting->bone_index_size);
+		writer->Write(this->translation, 3);
+		writer->Write(this->rotation, 4);
+	}
+
+	void PmxMorphMaterialOffset::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->material_index = ReadIndex(reader, setting->material_index_size);
+		this->offset_operation = reader->Read<uint8_t>();
+		reader->Read(this->diffuse, 4);
+		reader->Read(this->specular, 3);
+		this->specularity = reader->Read<float>();
+		reader->Read(this->ambient, 3);
+		reader->Read(this->edge_color, 4);
+		this->edge_size = reader->Read<float>();
+		reader->Read(this->texture_argb, 4);
+		reader->Read(this->sphere_texture_argb, 4);
+		reader->Read(this->toon_texture_argb, 4);
+	}
+
+	void PmxMorphMaterialOffset::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->material_index, setting->material_index_size);
+		writer->Write(this->offset_operation);
+		writer->Write(this->diffuse, 4);
+		writer->Write(this->specular, 3);
+		writer->Write(this->specularity);
+		writer->Write(this->ambient, 3);
+		writer->Write(this->edge_color, 4);
+		writer->Write(this->edge_size);
+		writer->Write(this->texture_argb, 4);
+		writer->Write(this->sphere_texture_argb, 4);
+		writer->Write(this->toon_texture_argb, 4);
+	}
+
+	void PmxMorphGroupOffset::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->morph_index = ReadIndex(reader, setting->morph_index_size);
+		this->morph_weight = reader->Read<float>();
+	}
+
+	void PmxMorphGroupOffset::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->morph_index, setting->morph_index_size);
+		writer->Write(this->morph_weight);
+	}
+
+	void PmxMorphFlipOffset::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->morph_index = ReadIndex(reader, setting->morph_index_size);
+		this->morph_value = reader->Read<float>();
+	}
+
+	void PmxMorphFlipOffset::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->morph_index, setting->morph_index_size);
+		writer->Write(this->morph_value);
+	}
+
+	void PmxMorphImplusOffset::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->rigid_body_index = ReadIndex(reader, setting->rigidbody_index_size);
+		this->is_local = reader->Read<uint8_t>();
+		reader->Read(this->velocity, 3);
+		reader->Read(this->angular_torque, 3);
+	}
+
+	void PmxMorphImplusOffset::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->rigid_body_index, setting->rigidbody_index_size);
+		writer->Write(this->is_local);
+		writer->Write(this->velocity, 3);
+		writer->Write(this->angular_torque, 3);
+	}
+
+	void PmxMorph::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->morph_name = ReadString(reader, setting->encoding);
+		this->morph_english_name = ReadString(reader, setting->encoding);
+		category = reader->Read<MorphCategory>();
+		morph_type = reader->Read<MorphType>();
+		this->offset_count = reader->Read<int>();
+		switch (this->morph_type)
+		{
+		case MorphType::Group:
+			group_offsets = std::make_unique<PmxMorphGroupOffset []>(this->offset_count);
+			for (int i = 0; i < offset_count; i++)
+			{
+				group_offsets[i].Read(reader, setting);
+			}
+			break;
+		case MorphType::Vertex:
+			vertex_offsets = std::make_unique<PmxMorphVertexOffset []>(this->offset_count);
+			for (int i = 0; i < offset_count; i++)
+			{
+				vertex_offsets[i].Read(reader, setting);
+			}
+			break;
+		case MorphType::Bone:
+			bone_offsets = std::make_unique<PmxMorphBoneOffset []>(this->offset_count);
+			for (int i = 0; i < offset_count; i++)
+			{
+				bone_offsets[i].Read(reader, setting);
+			}
+			break;
+		case MorphType::Matrial:
+			material_offsets = std::make_unique<PmxMorphMaterialOffset []>(this->offset_count);
+			for (int i = 0; i < offset_count; i++)
+			{
+				material_offsets[i].Read(reader, setting);
+			}
+			break;
+		case MorphType::UV:
+		case MorphType::AdditionalUV1:
+		case MorphType::AdditionalUV2:
+		case MorphType::AdditionalUV3:
+		case MorphType::AdditionalUV4:
+			uv_offsets = std::make_unique<PmxMorphUVOffset []>(this->offset_count);
+			for (int i = 0; i < offset_count; i++)
+			{
+				uv_offsets[i].Read(reader, setting);
+			}
+			break;
+		case MorphType::Flip:
+			flip_offsets = std::make_unique<PmxMorphFlipOffset []>(this->offset_count);
+			for (int i = 0; i < offset_count; i++)
+			{
+				flip_offsets[i].Read(reader, setting);
+			}
+			break;
+		case MorphType::Implus:
+			implus_offsets = std::make_unique<PmxMorphImplusOffset []>(this->offset_count);
+			for (int i = 0; i < offset_count; i++)
+			{
+				implus_offsets[i].Read(reader, setting);
+			}
+			break;
+		default:
+			throw "invalid morph type";
+		}
+	}
+
+	void PmxMorph::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteString(writer, this->morph_name, setting->encoding);
+		WriteString(writer, this->morph_english_name, setting->encoding);
+		writer->Write(category);
+		writer->Write(morph_type);
+		writer->Write(this->offset_count);
+		switch (this->morph_type)
+		{
+		case MorphType::Group:
+			for (int i = 0; i < offset_count; i++)
+			{
+				group_offsets[i].Write(writer, setting);
+			}
+			break;
+		case MorphType::Vertex:
+			for (int i = 0; i < offset_count; i++)
+			{
+				vertex_offsets[i].Write(writer, setting);
+			}
+			break;
+		case MorphType::Bone:
+			for (int i = 0; i < offset_count; i++)
+			{
+				bone_offsets[i].Write(writer, setting);
+			}
+			break;
+		case MorphType::Matrial:
+			for (int i = 0; i < offset_count; i++)
+			{
+				material_offsets[i].Write(writer, setting);
+			}
+			break;
+		case MorphType::UV:
+		case MorphType::AdditionalUV1:
+		case MorphType::AdditionalUV2:
+		case MorphType::AdditionalUV3:
+		case MorphType::AdditionalUV4:
+			for (int i = 0; i < offset_count; i++)
+			{
+				uv_offsets[i].Write(writer, setting);
+			}
+			break;
+		case MorphType::Flip:
+			for (int i = 0; i < offset_count; i++)
+			{
+				flip_offsets[i].Write(writer, setting);
+			}
+			break;
+		case MorphType::Implus:
+			for (int i = 0; i < offset_count; i++)
+			{
+				implus_offsets[i].Write(writer, setting);
+			}
+			break;
+		default:
+			throw "invalid morph type";
+		}
+	}
+
+	void PmxFrameElement::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->element_target = reader->Read<uint8_t>();
+		if (this->element_target == 0x00)
+		{
+			this->index = ReadIndex(reader, setting->bone_index_size);
+		}
+		else {
+			this->index = ReadIndex(reader, setting->morph_index_size);
+		}
+	}
+
+	void PmxFrameElement::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		writer->Write(this->element_target);
+		if (this->element_target == 0x00)
+		{
+			WriteIndex(writer, this->index, setting->bone_index_size);
+		}
+		else {
+			WriteIndex(writer, this->index, setting->morph_index_size);
+		}
+	}
+
+	void PmxFrame::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->frame_name = ReadString(reader, setting->encoding);
+		this->frame_english_name = ReadString(reader, setting->encoding);
+		this->frame_flag = reader->Read<uint8_t>();
+		this->element_count = reader->Read<int>();
+		this->elements = std::make_unique<PmxFrameElement []>(this->element_count);
+		for (int i = 0; i < this->element_count; i++)
+		{
+			this->elements[i].Read(reader, setting);
+		}
+	}
+
+	void PmxFrame::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteString(writer, this->frame_name, setting->encoding);
+		WriteString(writer, this->frame_english_name, setting->encoding);
+		writer->Write(this->frame_flag);
+		writer->Write(this->element_count);
+		for (int i = 0; i < this->element_count; i++)
+		{
+			this->elements[i].Write(writer, setting);
+		}
+	}
+
+	void PmxRigidBody::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->girid_body_name = ReadString(reader, setting->encoding);
+		this->girid_body_english_name = ReadString(reader, setting->encoding);
+		this->target_bone = ReadIndex(reader, setting->bone_index_size);
+		this->group = reader->Read<uint8_t>();
+		this->mask = reader->Read<uint16_t>();
+		this->shape = reader->Read<uint8_t>();
+		reader->Read(this->size, 3);
+		reader->Read(this->position, 3);
+		reader->Read(this->orientation, 3);
+		this->mass = reader->Read<float>();
+		this->move_attenuation = reader->Read<float>();
+		this->rotation_attenuation = reader->Read<float>();
+		this->repulsion = reader->Read<float>();
+		this->friction = reader->Read<float>();
+		this->physics_calc_type = reader->Read<uint8_t>();
+	}
+
+	void PmxRigidBody::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteString(writer, this->girid_body_name, setting->encoding);
+		WriteString(writer, this->girid_body_english_name, setting->encoding);
+		WriteIndex(writer, this->target_bone, setting->bone_index_size);
+		writer->Write(this->group);
+		writer->Write(this->mask);
+		writer->Write(this->shape);
+		writer->Write(this->size, 3);
+		writer->Write(this->position, 3);
+		writer->Write(this->orientation, 3);
+		writer->Write(this->mass);
+		writer->Write(this->move_attenuation);
+		writer->Write(this->rotation_attenuation);
+		writer->Write(this->repulsion);
+		writer->Write(this->friction);
+		writer->Write(this->physics_calc_type);
+	}
+
+	void PmxJointParam::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->rigid_body1 = ReadIndex(reader, setting->rigidbody_index_size);
+		this->rigid_body2 = ReadIndex(reader, setting->rigidbody_index_size);
+		reader->Read(this->position, 3);
+		reader->Read(this->orientaiton, 3);
+		reader->Read(this->move_limitation_min, 3);
+		reader->Read(this->move_limitation_max, 3);
+		reader->Read(this->rotation_limitation_min, 3);
+		reader->Read(this->rotation_limitation_max, 3);
+		reader->Read(this->spring_move_coefficient, 3);
+		reader->Read(this->spring_rotation_coefficient, 3);
+	}
+
+	void PmxJointParam::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteIndex(writer, this->rigid_body1, setting->rigidbody_index_size);
+		WriteIndex(writer, this->rigid_body2, setting->rigidbody_index_size);
+		writer->Write(this->position, 3);
+		writer->Write(this->orientaiton, 3);
+		writer->Write(this->move_limitation_min, 3);
+		writer->Write(this->move_limitation_max, 3);
+		writer->Write(this->rotation_limitation_min, 3);
+		writer->Write(this->rotation_limitation_max, 3);
+		writer->Write(this->spring_move_coefficient, 3);
+		writer->Write(this->spring_rotation_coefficient, 3);
+	}
+
+	void PmxJoint::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->joint_name = ReadString(reader, setting->encoding);
+		this->joint_english_name = ReadString(reader, setting->encoding);
+		this->joint_type = reader->Read<PmxJointType>();
+		this->param.Read(reader, setting);
+	}
+
+	void PmxJoint::Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const
+	{
+		WriteString(writer, this->joint_name, setting->encoding);
+		WriteString(writer, this->joint_english_name, setting->encoding);
+		writer->Write(this->joint_type);
+		this->param.Write(writer, setting);
+	}
+
+	void PmxAncherRigidBody::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		this->related_rigid_body = ReadIndex(reader, setting->rigidbody_index_size);
+		this->related_vertex = ReadIndex(reader, setting->vertex_index_size);
+		this->is_near = reader->Read<uint8_t>() != 0;
+	}
+
+	void PmxSoftBody::Read(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		// 
+		std::cerr << "Not Implemented Exception" << std::endl;
+		throw;
+	}
+
+	void PmxModel::Init()
+	{
+		this->version = 0.0f;
+		this->model_name.clear();
+		this->model_english_name.clear();
+		this->model_comment.clear();
+		this->model_english_commnet.clear();
+		this->vertex_count = 0;
+		this->vertices = nullptr;
+		this->packed_skinning.Resize(0);
+		this->vertex_columns.Resize(0, 0);
+		this->index_count = 0;
+		this->indices = nullptr;
+		this->texture_count = 0;
+		this->textures = nullptr;
+		this->material_count = 0;
+		this->materials = nullptr;
+		this->bone_count = 0;
+		this->bones = nullptr;
+		this->morph_count = 0;
+		this->morphs = nullptr;
+		this->frame_count = 0;
+		this->frames = nullptr;
+		this->rigid_body_count = 0;
+		this->rigid_bodies = nullptr;
+		this->joint_count = 0;
+		this->joints = nullptr;
+		this->soft_body_count = 0;
+		this->soft_bodies = nullptr;
+		this->sections = PmxSectionTable();
+		this->skipped_sections = 0;
+		this->read_flags = PmxReadDefault;
+		this->source_filename.clear();
+	}
+
+	/// ǂݔ΂
+	void SkipString(oguna::BinaryReader *reader)
+	{
+		int size = reader->Read<int>();
+		if (size < 0)
+		{
+			throw "invalid string size";
+		}
+		reader->Skip(size);
+	}
+
+	/// _ǂݔ΂
+	void SkipVertex(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		reader->Skip(sizeof(float) * (8 + 4 * setting->uv));
+		int bone = setting->bone_index_size;
+		switch (reader->Read<PmxVertexSkinningType>())
+		{
+		case PmxVertexSkinningType::BDEF1:
+			reader->Skip(bone);
+			break;
+		case PmxVertexSkinningType::BDEF2:
+			reader->Skip(bone * 2 + sizeof(float));
+			break;
+		case PmxVertexSkinningType::BDEF4:
+		case PmxVertexSkinningType::QDEF:
+			reader->Skip(bone * 4 + sizeof(float) * 4);
+			break;
+		case PmxVertexSkinningType::SDEF:
+			reader->Skip(bone * 2 + sizeof(float) * 10);
+			break;
+		default:
+			throw "invalid skinning type";
+		}
+		reader->Skip(sizeof(float));
+	}
+
+	/// }eAǂݔ΂
+	void SkipMaterial(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		SkipString(reader);
+		SkipString(reader);
+		reader->Skip(sizeof(float) * 11 + 1 + sizeof(float) * 5 + setting->texture_index_size * 2 + 1);
+		if (reader->Read<uint8_t>())
+		{
+			reader->Skip(1);
+		}
+		else {
+			reader->Skip(setting->texture_index_size);
+		}
+		SkipString(reader);
+		reader->Skip(sizeof(int));
+	}
+
+	/// {[ǂݔ΂
+	void SkipBone(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		int bone = setting->bone_index_size;
+		SkipString(reader);
+		SkipString(reader);
+		reader->Skip(sizeof(float) * 3 + bone + sizeof(int));
+		uint16_t flag = reader->Read<uint16_t>();
+		reader->Skip((flag & 0x0001) ? bone : sizeof(float) * 3);
+		if (flag & (0x0100 | 0x0200))
+		{
+			reader->Skip(bone + sizeof(float));
+		}
+		if (flag & 0x0400)
+		{
+			reader->Skip(sizeof(float) * 3);
+		}
+		if (flag & 0x0800)
+		{
+			reader->Skip(sizeof(float) * 6);
+		}
+		if (flag & 0x2000)
+		{
+			reader->Skip(sizeof(int));
+		}
+		if (flag & 0x0020)
+		{
+			reader->Skip(bone + sizeof(int) + sizeof(float));
+			int link_count = reader->Read<int>();
+			for (int i = 0; i < link_count; i++)
+			{
+				reader->Skip(bone);
+				if (reader->Read<uint8_t>() == 1)
+				{
+					reader->Skip(sizeof(float) * 6);
+				}
+			}
+		}
+	}
+
+	/// [tǂݔ΂
+	void SkipMorph(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		SkipString(reader);
+		SkipString(reader);
+		reader->Skip(sizeof(MorphCategory));
+		MorphType type = reader->Read<MorphType>();
+		int offset_count = reader->Read<int>();
+		size_t offset_size;
+		switch (type)
+		{
+		case MorphType::Group:
+		case MorphType::Flip:
+			offset_size = setting->morph_index_size + sizeof(float);
+			break;
+		case MorphType::Vertex:
+			offset_size = setting->vertex_index_size + sizeof(float) * 3;
+			break;
+		case MorphType::Bone:
+			offset_size = setting->bone_index_size + sizeof(float) * 7;
+			break;
+		case MorphType::Matrial:
+			offset_size = setting->material_index_size + 1 + sizeof(float) * 28;
+			break;
+		case MorphType::UV:
+		case MorphType::AdditionalUV1:
+		case MorphType::AdditionalUV2:
+		case MorphType::AdditionalUV3:
+		case MorphType::AdditionalUV4:
+			offset_size = setting->vertex_index_size + sizeof(float) * 4;
+			break;
+		case MorphType::Implus:
+			offset_size = setting->rigidbody_index_size + 1 + sizeof(float) * 6;
+			break;
+		default:
+			throw "invalid morph type";
+		}
+		if (offset_count < 0)
+		{
+			throw "invalid morph offset count";
+		}
+		reader->Skip(offset_size * offset_count);
+	}
+
+	/// \gǂݔ΂
+	void SkipFrame(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		SkipString(reader);
+		SkipString(reader);
+		reader->Skip(1);
+		int element_count = reader->Read<int>();
+		for (int i = 0; i < element_count; i++)
+		{
+			reader->Skip(reader->Read<uint8_t>() == 0x00 ? setting->bone_index_size : setting->morph_index_size);
+		}
+	}
+
+	/// ̂ǂݔ΂
+	void SkipRigidBody(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		SkipString(reader);
+		SkipString(reader);
+		reader->Skip(setting->bone_index_size + 1 + sizeof(uint16_t) + 1 + sizeof(float) * 14 + 1);
+	}
+
+	/// WCgǂݔ΂
+	void SkipJoint(oguna::BinaryReader *reader, PmxSetting *setting)
+	{
+		SkipString(reader);
+		SkipString(reader);
+		reader->Skip(1 + setting->rigidbody_index_size * 2 + sizeof(float) * 24);
+	}
+
+	/// vfǂ݁Avfcountǂݔ΂
+	template<typename F>
+	int SkipElements(oguna::BinaryReader *reader, PmxSetting *setting, F skip)
+	{
+		int count = reader->Read<int>();
+		for (int i = 0; i < count; i++)
+		{
+			skip(reader, setting);
+		}
+		return count;
+	}
+
+	/// ZNVǂݔ΂ėvfԂ
+	/// tablenullptrłȂΒ_ƃ[ẗʒuL^
+	int SkipSectionElements(oguna::BinaryReader *reader, PmxSetting *setting, PmxSection section, PmxSectionTable *table)
+	{
+		switch (section)
+		{
+		case PmxSection::Vertex:
+		{
+			int count = reader->Read<int>();
+			for (int i = 0; i < count; i++)
+			{
+				if (table && i % table->vertex_chunk_size == 0)
+				{
+					table->vertex_chunk_offsets.push_back(reader->Position());
+				}
+				SkipVertex(reader, setting);
+			}
+			return count;
+		}
+		case PmxSection::Index:
+		{
+			int count = reader->Read<int>();
+			if (count < 0)
+			{
+				throw "invalid index count";
+			}
+			reader->Skip((size_t) setting->vertex_index_size * count);
+			return count;
+		}
+		case PmxSection::Texture:
+			return SkipElements(reader, setting, [](oguna::BinaryReader *r, PmxSetting*) { SkipString(r); });
+		case PmxSection::Material:
+			return SkipElements(reader, setting, SkipMaterial);
+		case PmxSection::Bone:
+			return SkipElements(reader, setting, SkipBone);
+		case PmxSection::Morph:
+		{
+			int count = reader->Read<int>();
+			for (int i = 0; i < count; i++)
+			{
+				if (table)
+				{
+					table->morph_offsets.push_back(reader->Position());
+				}
+				SkipMorph(reader, setting);
+			}
+			return count;
+		}
+		case PmxSection::Frame:
+			return SkipElements(reader, setting, SkipFrame);
+		case PmxSection::RigidBody:
+			return SkipElements(reader, setting, SkipRigidBody);
+		case PmxSection::Joint:
+			return SkipElements(reader, setting, SkipJoint);
+		default:
+			throw "invalid section";
+		}
+	}
+
+	void PmxSectionTable::Scan(oguna::BinaryReader *reader, PmxSetting *setting, int vertex_chunk_size)
+	{
+		this->vertex_chunk_size = vertex_chunk_size;
+		this->vertex_chunk_offsets.clear();
+		this->morph_offsets.clear();
+		for (int i = 0; i < (int) PmxSection::Count; i++)
+		{
+			offsets[i] = reader->Position();
+			counts[i] = SkipSectionElements(reader, setting, (PmxSection) i, this);
+		}
+		end = reader->Position();
+	}
+
+	bool PmxModel::IsSectionLoaded(PmxSection section) const
+	{
+		return (this->skipped_sections & (1u << (int) section)) == 0;
+	}
+
+	void PmxModel::UnloadSection(PmxSection section)
+	{
+		switch (section)
+		{
+		case PmxSection::Vertex:
+			this->vertex_count = 0;
+			this->vertices = nullptr;
+			this->packed_skinning.Resize(0);
+			this->vertex_columns.Resize(0, 0);
+			break;
+		case PmxSection::Index:
+			this->index_count = 0;
+			this->indices = nullptr;
+			break;
+		case PmxSection::Texture:
+			this->texture_count = 0;
+			this->textures = nullptr;
+			break;
+		case PmxSection::Material:
+			this->material_count = 0;
+			this->materials = nullptr;
+			break;
+		case PmxSection::Bone:
+			this->bone_count = 0;
+			this->bones = nullptr;
+			break;
+		case PmxSection::Morph:
+			this->morph_count = 0;
+			this->morphs = nullptr;
+			break;
+		case PmxSection::Frame:
+			this->frame_count = 0;
+			this->frames = nullptr;
+			break;
+		case PmxSection::RigidBody:
+			this->rigid_body_count = 0;
+			this->rigid_bodies = nullptr;
+			break;
+		case PmxSection::Joint:
+			this->joint_count = 0;
+			this->joints = nullptr;
+			break;
+		default:
+			break;
+		}
+		this->skipped_sections |= 1u << (int) section;
+	}
+
+	int PmxModel::ReadSection(oguna::BinaryReader *reader, PmxSection section, uint32_t flags)
+	{
+		int count;
+		switch (section)
+		{
+		case PmxSection::Vertex:
+			AllocateVertices(reader->Read<int>(), flags);
+			ReadVertices(reader, flags, 0, vertex_count, nullptr);
+			count = vertex_count;
+			break;
+		case PmxSection::Index:
+			count = index_count = reader->Read<int>();
+			this->indices = std::make_unique<int []>(index_count);
+			ReadIndices(reader, setting.vertex_index_size, this->indices.get(), index_count);
+			break;
+		case PmxSection::Texture:
+			count = texture_count = reader->Read<int>();
+			this->textures = std::make_unique<std::wstring []>(texture_count);
+			for (int i = 0; i < texture_count; i++)
+			{
+				this->textures[i] = ReadString(reader, setting.encoding);
+			}
+			break;
+		case PmxSection::Material:
+			count = material_count = reader->Read<int>();
+			this->materials = std::make_unique<PmxMaterial []>(material_count);
+			for (int i = 0; i < material_count; i++)
+			{
+				this->materials[i].Read(reader, &setting);
+			}
+			break;
+		case PmxSection::Bone:
+			count = this->bone_count = reader->Read<int>();
+			this->bones = std::make_unique<PmxBone []>(this->bone_count);
+			for (int i = 0; i < this->bone_count; i++)
+			{
+				this->bones[i].Read(reader, &setting);
+			}
+			break;
+		case PmxSection::Morph:
+			count = this->morph_count = reader->Read<int>();
+			this->morphs = std::make_unique<PmxMorph []>(this->morph_count);
+			for (int i = 0; i < this->morph_count; i++)
+			{
+				this->morphs[i].Read(reader, &setting);
+			}
+			break;
+		case PmxSection::Frame:
+			count = this->frame_count = reader->Read<int>();
+			this->frames = std::make_unique<PmxFrame []>(this->frame_count);
+			for (int i = 0; i < this->frame_count; i++)
+			{
+				this->frames[i].Read(reader, &setting);
+			}
+			break;
+		case PmxSection::RigidBody:
+			count = this->rigid_body_count = reader->Read<int>();
+			this->rigid_bodies = std::make_unique<PmxRigidBody []>(this->rigid_body_count);
+			for (int i = 0; i < this->rigid_body_count; i++)
+			{
+				this->rigid_bodies[i].Read(reader, &setting);
+			}
+			break;
+		case PmxSection::Joint:
+			count = this->joint_count = reader->Read<int>();
+			this->joints = std::make_unique<PmxJoint []>(this->joint_count);
+			for (int i = 0; i < this->joint_count; i++)
+			{
+				this->joints[i].Read(reader, &setting);
+			}
+			break;
+		default:
+			throw "invalid section";
+		}
+		this->skipped_sections &= ~(1u << (int) section);
+		return count;
+	}
+
+	void PmxModel::LoadSection(PmxSection section, const char *data, size_t size)
+	{
+		if (IsSectionLoaded(section))
+		{
+			return;
 		}
-		else
+		if (size < this->sections.end)
 		{
-			// UTF8
-			std::wstring result;
-			converter.Utf8ToUtf16(buffer.data(), size, &result);
-			return result;
+			throw "source data does not match";
 		}
+		size_t offset = this->sections.offsets[(int) section];
+		oguna::BinaryReader reader(data + offset, size - offset);
+		this->ReadSection(&reader, section, this->read_flags);
 	}
 
-	void PmxSetting::Read(std::istream *stream)
+	bool PmxModel::LoadSection(PmxSection section)
 	{
-		uint8_t count;
-		stream->read((char*) &count, sizeof(uint8_t));
-		if (count < 8)
+		if (IsSectionLoaded(section))
 		{
-			throw;
+			return true;
 		}
-		stream->read((char*) &encoding, sizeof(uint8_t));
-		stream->read((char*) &uv, sizeof(uint8_t));
-		stream->read((char*) &vertex_index_size, sizeof(uint8_t));
-		stream->read((char*) &texture_index_size, sizeof(uint8_t));
-		stream->read((char*) &material_index_size, sizeof(uint8_t));
-		stream->read((char*) &bone_index_size, sizeof(uint8_t));
-		stream->read((char*) &morph_index_size, sizeof(uint8_t));
-		stream->read((char*) &rigidbody_index_size, sizeof(uint8_t));
-		uint8_t temp;
-		for (int i = 8; i < count; i++)
+		oguna::MappedFile file;
+		if (this->source_filename.empty() || !file.Open(this->source_filename.c_str()))
 		{
-			stream->read((char*)&temp, sizeof(uint8_t));
+			std::cerr << "could not open \"" << this->source_filename << "\"" << std::endl;
+			return false;
 		}
+		this->LoadSection(section, file.Data(), file.Size());
+		return true;
 	}
 
-	void PmxVertexSkinningBDEF1::Read(std::istream *stream, PmxSetting *setting)
+	void PmxModel::Read(std::istream *stream, uint32_t flags)
 	{
-		this->bone_index = ReadIndex(stream, setting->bone_index_size);
+		oguna::BinaryReader reader(stream);
+		this->Read(&reader, flags);
 	}
 
-	void PmxVertexSkinningBDEF2::Read(std::istream *stream, PmxSetting *setting)
+	void PmxModel::Read(const char *data, size_t size, uint32_t flags)
 	{
-		this->bone_index1 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index2 = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*) &this->bone_weight, sizeof(float));
+		if (flags & PmxReadParallel)
+		{
+			this->ReadParallel(data, size, flags);
+		}
+		else
+		{
+			oguna::BinaryReader reader(data, size);
+			this->Read(&reader, flags);
+		}
 	}
 
-	void PmxVertexSkinningBDEF4::Read(std::istream *stream, PmxSetting *setting)
+	void PmxModel::ReadHeader(oguna::BinaryReader *reader)
 	{
-		this->bone_index1 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index2 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index3 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index4 = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*) &this->bone_weight1, sizeof(float));
-		stream->read((char*) &this->bone_weight2, sizeof(float));
-		stream->read((char*) &this->bone_weight3, sizeof(float));
-		stream->read((char*) &this->bone_weight4, sizeof(float));
-	}
+		// }WbN
+		const char *magic = reader->View(sizeof(char) * 4);
+		if (magic[0] != 0x50 || magic[1] != 0x4d || magic[2] != 0x58 || magic[3] != 0x20)
+		{
+			std::cerr << "invalid magic number." << std::endl;
+			throw;
+		}
+		// o[W
+		version = reader->Read<float>();
+		if (version != 2.0f && version != 2.1f)
+		{
+			std::cerr << "this is not ver2.0 or ver2.1 but " << version << "." << std::endl;
+			throw;
+		}
+		// t@Cݒ
+		this->setting.Read(reader);
 
-	void PmxVertexSkinningSDEF::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->bone_index1 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index2 = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*) &this->bone_weight, sizeof(float));
-		stream->read((char*) this->sdef_c, sizeof(float) * 3);
-		stream->read((char*) this->sdef_r0, sizeof(float) * 3);
-		stream->read((char*) this->sdef_r1, sizeof(float) * 3);
+		// f
+		this->model_name = ReadString(reader, setting.encoding);
+		this->model_english_name = ReadString(reader, setting.encoding);
+		this->model_comment = ReadString(reader, setting.encoding);
+		this->model_english_commnet = ReadString(reader, setting.encoding);
 	}
 
-	void PmxVertexSkinningQDEF::Read(std::istream *stream, PmxSetting *setting)
+	void PmxModel::AllocateVertices(int count, uint32_t flags)
 	{
-		this->bone_index1 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index2 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index3 = ReadIndex(stream, setting->bone_index_size);
-		this->bone_index4 = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*) &this->bone_weight1, sizeof(float));
-		stream->read((char*) &this->bone_weight2, sizeof(float));
-		stream->read((char*) &this->bone_weight3, sizeof(float));
-		stream->read((char*) &this->bone_weight4, sizeof(float));
+		this->vertex_count = count;
+		if (flags & PmxReadVertexColumns)
+		{
+			// _͗񂲂ƂɊi[APmxVertex̔z͍Ȃ
+			this->vertices = nullptr;
+			this->packed_skinning.Resize(count);
+			this->vertex_columns.Resize(count, setting.uv);
+		}
+		else
+		{
+			this->vertices = std::make_unique<PmxVertex []>(count);
+			this->packed_skinning.Resize((flags & PmxReadPackedSkinning) ? count : 0);
+			this->vertex_columns.Resize(0, 0);
+		}
 	}
 
-	void PmxVertex::Read(std::istream *stream, PmxSetting *setting)
+	void PmxModel::ReadVertices(oguna::BinaryReader *reader, uint32_t flags, int begin, int end, std::vector<PmxSdefParameter> *sdef_out)
 	{
-		stream->read((char*) this->positon, sizeof(float) * 3);
-		stream->read((char*) this->normal, sizeof(float) * 3);
-		stream->read((char*) this->uv, sizeof(float) * 2);
-		for (int i = 0; i < setting->uv; ++i)
+		if (flags & PmxReadVertexColumns)
 		{
-			stream->read((char*) this->uva[i], sizeof(float) * 4);
+			for (int i = begin; i < end; i++)
+			{
+				this->vertex_columns.Read(reader, &setting, &this->packed_skinning, i, sdef_out);
+			}
 		}
-		stream->read((char*) &this->skinning_type, sizeof(PmxVertexSkinningType));
-		switch (this->skinning_type)
+		else if (flags & PmxReadPackedSkinning)
 		{
-		case PmxVertexSkinningType::BDEF1:
-			this->skinning = std::make_unique<PmxVertexSkinningBDEF1>();
-			break;
-		case PmxVertexSkinningType::BDEF2:
-			this->skinning = std::make_unique<PmxVertexSkinningBDEF2>();
-			break;
-		case PmxVertexSkinningType::BDEF4:
-			this->skinning = std::make_unique<PmxVertexSkinningBDEF4>();
-			break;
-		case PmxVertexSkinningType::SDEF:
-			this->skinning = std::make_unique<PmxVertexSkinningSDEF>();
-			break;
-		case PmxVertexSkinningType::QDEF:
-			this->skinning = std::make_unique<PmxVertexSkinningQDEF>();
-			break;
-		default:
-			throw "invalid skinning type";
+			for (int i = begin; i < end; i++)
+			{
+				vertices[i].Read(reader, &setting, &this->packed_skinning, i, sdef_out);
+			}
 		}
-		this->skinning->Read(stream, setting);
-		stream->read((char*) &this->edge, sizeof(float));
-	}
-
-	void PmxMaterial::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->material_name.swap(ReadString(stream, setting->encoding));
-		this->material_english_name.swap(ReadString(stream, setting->encoding));
-		stream->read((char*) this->diffuse, sizeof(float) * 4);
-		stream->read((char*) this->specular, sizeof(float) * 3);
-		stream->read((char*) &this->specularlity, sizeof(float));
-		stream->read((char*) this->ambient, sizeof(float) * 3);
-		stream->read((char*) &this->flag, sizeof(uint8_t));
-		stream->read((char*) this->edge_color, sizeof(float) * 4);
-		stream->read((char*) &this->edge_size, sizeof(float));
-		this->diffuse_texture_index = ReadIndex(stream, setting->texture_index_size);
-		this->sphere_texture_index = ReadIndex(stream, setting->texture_index_size);
-		stream->read((char*) &this->sphere_op_mode, sizeof(uint8_t));
-		stream->read((char*) &this->common_toon_flag, sizeof(uint8_t));
-		if (this->common_toon_flag)
+		else
 		{
-			stream->read((char*) &this->toon_texture_index, sizeof(uint8_t));
-		}
-		else {
-			this->toon_texture_index = ReadIndex(stream, setting->texture_index_size);
+			for (int i = begin; i < end; i++)
+			{
+				vertices[i].Read(reader, &setting);
+			}
 		}
-		this->memo.swap(ReadString(stream, setting->encoding));
-		stream->read((char*) &this->index_count, sizeof(int));
 	}
 
-	void PmxIkLink::Read(std::istream *stream, PmxSetting *setting)
+	void PmxModel::ReadParallel(const char *data, size_t size, uint32_t flags)
 	{
-		this->link_target = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*) &this->angle_lock, sizeof(uint8_t));
-		if (angle_lock == 1)
+		oguna::BinaryReader reader(data, size);
+		this->ReadHeader(&reader);
+		this->sections.Scan(&reader, &setting);
+		this->read_flags = flags;
+		this->skipped_sections = 0;
+		const PmxSectionTable &table = this->sections;
+		auto wanted = [&](PmxSection section) { return (flags & (PmxReadSkipVertex << (int) section)) == 0; };
+
+		// ̈͐ɊmۂAe^XN݂͌ɏdȂȂvf
+		// ǂݔ΂ZNV͋̂܂܂ɂ
+		for (int i = 0; i < (int) PmxSection::Count; i++)
 		{
-			stream->read((char*) this->max_radian, sizeof(float) * 3);
-			stream->read((char*) this->min_radian, sizeof(float) * 3);
+			UnloadSection((PmxSection) i);
 		}
-	}
-
-	void PmxBone::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->bone_name.swap(ReadString(stream, setting->encoding));
-		this->bone_english_name.swap(ReadString(stream, setting->encoding));
-		stream->read((char*) this->position, sizeof(float) * 3);
-		this->parent_index = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*) &this->level, sizeof(int));
-		stream->read((char*) &this->bone_flag, sizeof(uint16_t));
-		if (this->bone_flag & 0x0001) {
-			this->target_index = ReadIndex(stream, setting->bone_index_size);
+		if (wanted(PmxSection::Vertex))
+		{
+			AllocateVertices(table.counts[(int) PmxSection::Vertex], flags);
 		}
-		else {
-			stream->read((char*)this->offset, sizeof(float) * 3);
+		if (wanted(PmxSection::Index))
+		{
+			this->index_count = table.counts[(int) PmxSection::Index];
+			this->indices = std::make_unique<int []>(index_count);
 		}
-		if (this->bone_flag & (0x0100 | 0x0200)) {
-			this->grant_parent_index = ReadIndex(stream, setting->bone_index_size);
-			stream->read((char*) &this->grant_weight, sizeof(float));
+		if (wanted(PmxSection::Texture))
+		{
+			this->texture_count = table.counts[(int) PmxSection::Texture];
+			this->textures = std::make_unique<std::wstring []>(texture_count);
 		}
-		if (this->bone_flag & 0x0400) {
-			stream->read((char*)this->lock_axis_orientation, sizeof(float) * 3);
+		if (wanted(PmxSection::Material))
+		{
+			this->material_count = table.counts[(int) PmxSection::Material];
+			this->materials = std::make_unique<PmxMaterial []>(material_count);
 		}
-		if (this->bone_flag & 0x0800) {
-			stream->read((char*)this->local_axis_x_orientation, sizeof(float) * 3);
-			stream->read((char*)this->local_axis_y_orientation, sizeof(float) * 3);
+		if (wanted(PmxSection::Bone))
+		{
+			this->bone_count = table.counts[(int) PmxSection::Bone];
+			this->bones = std::make_unique<PmxBone []>(bone_count);
 		}
-		if (this->bone_flag & 0x2000) {
-			stream->read((char*)this->key, sizeof(int));
+		if (wanted(PmxSection::Morph))
+		{
+			this->morph_count = table.counts[(int) PmxSection::Morph];
+			this->morphs = std::make_unique<PmxMorph []>(morph_count);
 		}
-		if (this->bone_flag & 0x0020) {
-			this->ik_target_bone_index = ReadIndex(stream, setting->bone_index_size);
-			stream->read((char*) &ik_loop, sizeof(int));
-			stream->read((char*) &ik_loop_angle_limit, sizeof(float));
-			stream->read((char*) &ik_link_count, sizeof(int));
-			this->ik_links = std::make_unique<PmxIkLink []>(ik_link_count);
-			for (int i = 0; i < ik_link_count; i++) {
-				ik_links[i].Read(stream, setting);
-			}
+		if (wanted(PmxSection::Frame))
+		{
+			this->frame_count = table.counts[(int) PmxSection::Frame];
+			this->frames = std::make_unique<PmxFrame []>(frame_count);
+		}
+		if (wanted(PmxSection::RigidBody))
+		{
+			this->rigid_body_count = table.counts[(int) PmxSection::RigidBody];
+			this->rigid_bodies = std::make_unique<PmxRigidBody []>(rigid_body_count);
+		}
+		if (wanted(PmxSection::Joint))
+		{
+			this->joint_count = table.counts[(int) PmxSection::Joint];
+			this->joints = std::make_unique<PmxJoint []>(joint_count);
 		}
-	}
-
-	void PmxMorphVertexOffset::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->vertex_index = ReadIndex(stream, setting->vertex_index_size);
-		stream->read((char*)this->position_offset, sizeof(float) * 3);
-	}
-
-	void PmxMorphUVOffset::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->vertex_index = ReadIndex(stream, setting->vertex_index_size);
-		stream->read((char*)this->uv_offset, sizeof(float) * 4);
-	}
-
-	void PmxMorphBoneOffset::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->bone_index = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*)this->translation, sizeof(float) * 3);
-		stream->read((char*)this->rotation, sizeof(float) * 4);
-	}
-
-	void PmxMorphMaterialOffset::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->material_index = ReadIndex(stream, setting->material_index_size);
-		stream->read((char*) &this->offset_operation, sizeof(uint8_t));
-		stream->read((char*)this->diffuse, sizeof(float) * 4);
-		stream->read((char*)this->specular, sizeof(float) * 3);
-		stream->read((char*) &this->specularity, sizeof(float));
-		stream->read((char*)this->ambient, sizeof(float) * 3);
-		stream->read((char*)this->edge_color, sizeof(float) * 4);
-		stream->read((char*) &this->edge_size, sizeof(float));
-		stream->read((char*)this->texture_argb, sizeof(float) * 4);
-		stream->read((char*)this->sphere_texture_argb, sizeof(float) * 4);
-		stream->read((char*)this->toon_texture_argb, sizeof(float) * 4);
-	}
-
-	void PmxMorphGroupOffset::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->morph_index = ReadIndex(stream, setting->morph_index_size);
-		stream->read((char*) &this->morph_weight, sizeof(float));
-	}
 
-	void PmxMorphFlipOffset::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->morph_index = ReadIndex(stream, setting->morph_index_size);
-		stream->read((char*) &this->morph_value, sizeof(float));
-	}
+		std::vector<std::function<void()>> tasks;
 
-	void PmxMorphImplusOffset::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->rigid_body_index = ReadIndex(stream, setting->rigidbody_index_size);
-		stream->read((char*) &this->is_local, sizeof(uint8_t));
-		stream->read((char*)this->velocity, sizeof(float) * 3);
-		stream->read((char*)this->angular_torque, sizeof(float) * 3);
-	}
+		// _͑ɋL^ʒuŋ؂ēǂ
+		int vertex_chunk_count = wanted(PmxSection::Vertex) ? (int) table.vertex_chunk_offsets.size() : 0;
+		std::vector<std::vector<PmxSdefParameter>> sdef_chunks(vertex_chunk_count);
+		for (int c = 0; c < vertex_chunk_count; c++)
+		{
+			tasks.push_back([&, c]() {
+				oguna::BinaryReader chunk(data + table.vertex_chunk_offsets[c], size - table.vertex_chunk_offsets[c]);
+				int begin = c * table.vertex_chunk_size;
+				int end = std::min(begin + table.vertex_chunk_size, vertex_count);
+				this->ReadVertices(&chunk, flags, begin, end, &sdef_chunks[c]);
+			});
+		}
 
-	void PmxMorph::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->morph_name = ReadString(stream, setting->encoding);
-		this->morph_english_name = ReadString(stream, setting->encoding);
-		stream->read((char*) &category, sizeof(MorphCategory));
-		stream->read((char*) &morph_type, sizeof(MorphType));
-		stream->read((char*) &this->offset_count, sizeof(int));
-		switch (this->morph_type)
+		if (wanted(PmxSection::Index))
 		{
-		case MorphType::Group:
-			group_offsets = std::make_unique<PmxMorphGroupOffset []>(this->offset_count);
-			for (int i = 0; i < offset_count; i++)
+			tasks.push_back([&]() {
+				size_t offset = table.offsets[(int) PmxSection::Index] + sizeof(int);
+				oguna::BinaryReader section(data + offset, size - offset);
+				ReadIndices(&section, setting.vertex_index_size, this->indices.get(), index_count);
+			});
+		}
+
+		// eNX``{[A\g`WCg͂ꂼ̃^XNœǂ
+		auto section_task = [&](PmxSection kind, std::function<void(oguna::BinaryReader*)> read) {
+			if (!wanted(kind))
 			{
-				group_offsets[i].Read(stream, setting);
+				return;
 			}
-			break;
-		case MorphType::Vertex:
-			vertex_offsets = std::make_unique<PmxMorphVertexOffset []>(this->offset_count);
-			for (int i = 0; i < offset_count; i++)
+			tasks.push_back([&, kind, read]() {
+				size_t offset = table.offsets[(int) kind] + sizeof(int);
+				oguna::BinaryReader section(data + offset, size - offset);
+				read(&section);
+			});
+		};
+		section_task(PmxSection::Texture, [&](oguna::BinaryReader *r) {
+			for (int i = 0; i < texture_count; i++)
 			{
-				vertex_offsets[i].Read(stream, setting);
+				this->textures[i] = ReadString(r, setting.encoding);
 			}
-			break;
-		case MorphType::Bone:
-			bone_offsets = std::make_unique<PmxMorphBoneOffset []>(this->offset_count);
-			for (int i = 0; i < offset_count; i++)
+		});
+		section_task(PmxSection::Material, [&](oguna::BinaryReader *r) {
+			for (int i = 0; i < material_count; i++)
 			{
-				bone_offsets[i].Read(stream, setting);
+				this->materials[i].Read(r, &setting);
 			}
-			break;
-		case MorphType::Matrial:
-			material_offsets = std::make_unique<PmxMorphMaterialOffset []>(this->offset_count);
-			for (int i = 0; i < offset_count; i++)
+		});
+		section_task(PmxSection::Bone, [&](oguna::BinaryReader *r) {
+			for (int i = 0; i < bone_count; i++)
 			{
-				material_offsets[i].Read(stream, setting);
+				this->bones[i].Read(r, &setting);
 			}
-			break;
-		case MorphType::UV:
-		case MorphType::AdditionalUV1:
-		case MorphType::AdditionalUV2:
-		case MorphType::AdditionalUV3:
-		case MorphType::AdditionalUV4:
-			uv_offsets = std::make_unique<PmxMorphUVOffset []>(this->offset_count);
-			for (int i = 0; i < offset_count; i++)
+		});
+		section_task(PmxSection::Frame, [&](oguna::BinaryReader *r) {
+			for (int i = 0; i < frame_count; i++)
 			{
-				uv_offsets[i].Read(stream, setting);
+				this->frames[i].Read(r, &setting);
 			}
-			break;
-		default:
-			throw;
+		});
+		section_task(PmxSection::RigidBody, [&](oguna::BinaryReader *r) {
+			for (int i = 0; i < rigid_body_count; i++)
+			{
+				this->rigid_bodies[i].Read(r, &setting);
+			}
+		});
+		section_task(PmxSection::Joint, [&](oguna::BinaryReader *r) {
+			for (int i = 0; i < joint_count; i++)
+			{
+				this->joints[i].Read(r, &setting);
+			}
+		});
+
+		// [t̓oCgقڋϓɂȂ悤ɋ؂
+		oguna::ThreadPool &pool = oguna::ThreadPool::Shared();
+		size_t morph_begin = table.offsets[(int) PmxSection::Morph];
+		size_t morph_bytes = table.offsets[(int) PmxSection::Frame] - morph_begin;
+		size_t morph_chunk_bytes = std::max<size_t>(morph_bytes / (pool.ThreadCount() * 2), 1 << 16);
+		for (int first = 0; first < morph_count;)
+		{
+			int last = first + 1;
+			while (last < morph_count && table.morph_offsets[last] - table.morph_offsets[first] < morph_chunk_bytes)
+			{
+				last++;
+			}
+			tasks.push_back([&, first, last]() {
+				oguna::BinaryReader chunk(data + table.morph_offsets[first], size - table.morph_offsets[first]);
+				for (int i = first; i < last; i++)
+				{
+					this->morphs[i].Read(&chunk, &setting);
+				}
+			});
+			first = last;
 		}
-	}
 
-	void PmxFrameElement::Read(std::istream *stream, PmxSetting *setting)
-	{
-		stream->read((char*) &this->element_target, sizeof(uint8_t));
-		if (this->element_target == 0x00)
+		pool.Run((int) tasks.size(), [&](int i) { tasks[i](); });
+
+		// SDEF̒ǉp[^𒸓_ɘA
+		if (flags & (PmxReadPackedSkinning | PmxReadVertexColumns))
 		{
-			this->index = ReadIndex(stream, setting->bone_index_size);
+			for (auto &chunk : sdef_chunks)
+			{
+				this->packed_skinning.sdef.insert(this->packed_skinning.sdef.end(), chunk.begin(), chunk.end());
+			}
 		}
-		else {
-			this->index = ReadIndex(stream, setting->morph_index_size);
+		for (int i = 0; i < (int) PmxSection::Count; i++)
+		{
+			if (wanted((PmxSection) i))
+			{
+				this->skipped_sections &= ~(1u << i);
+			}
 		}
 	}
 
-	void PmxFrame::Read(std::istream *stream, PmxSetting *setting)
+	void PmxModel::Read(oguna::BinaryReader *reader, uint32_t flags)
 	{
-		this->frame_name = ReadString(stream, setting->encoding);
-		this->frame_english_name = ReadString(stream, setting->encoding);
-		stream->read((char*) &this->frame_flag, sizeof(uint8_t));
-		stream->read((char*) &this->element_count, sizeof(int));
-		this->elements = std::make_unique<PmxFrameElement []>(this->element_count);
-		for (int i = 0; i < this->element_count; i++)
+		this->ReadHeader(reader);
+		this->sections = PmxSectionTable();
+		this->read_flags = flags;
+		this->skipped_sections = 0;
+
+		// w肳ꂽZNV͈ʒuƗvfL^ēǂݔ΂
+		for (int i = 0; i < (int) PmxSection::Count; i++)
 		{
-			this->elements[i].Read(stream, setting);
+			PmxSection section = (PmxSection) i;
+			this->sections.offsets[i] = reader->Position();
+			if (flags & (PmxReadSkipVertex << i))
+			{
+				UnloadSection(section);
+				this->sections.counts[i] = SkipSectionElements(reader, &setting, section, nullptr);
+			}
+			else
+			{
+				this->sections.counts[i] = this->ReadSection(reader, section, flags);
+			}
 		}
-	}
-
-	void PmxRigidBody::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->girid_body_name = ReadString(stream, setting->encoding);
-		this->girid_body_english_name = ReadString(stream, setting->encoding);
-		this->target_bone = ReadIndex(stream, setting->bone_index_size);
-		stream->read((char*) &this->group, sizeof(uint8_t));
-		stream->read((char*) &this->mask, sizeof(uint16_t));
-		stream->read((char*) &this->shape, sizeof(uint8_t));
-		stream->read((char*) this->size, sizeof(float) * 3);
-		stream->read((char*) this->position, sizeof(float) * 3);
-		stream->read((char*) this->orientation, sizeof(float) * 3);
-		stream->read((char*) &this->mass, sizeof(float));
-		stream->read((char*) &this->move_attenuation, sizeof(float));
-		stream->read((char*) &this->rotation_attenuation, sizeof(float));
-		stream->read((char*) &this->repulsion, sizeof(float));
-		stream->read((char*) &this->friction, sizeof(float));
-		stream->read((char*) &this->physics_calc_type, sizeof(uint8_t));
-	}
+		this->sections.end = reader->Position();
 
-	void PmxJointParam::Read(std::istream *stream, PmxSetting *setting)
-	{
-		this->rigid_body1 = ReadIndex(stream, setting->rigidbody_index_size);
-		this->rigid_body2 = ReadIndex(stream, setting->rigidbody_index_size);
-		stream->read((char*) this->position, sizeof(float) * 3);
-		stream->read((char*) this->orientaiton, sizeof(float) * 3);
-		stream->read((char*) this->move_limitation_min, sizeof(float) * 3);
-		stream->read((char*) this->move_limitation_max, sizeof(float) * 3);
-		stream->read((char*) this->rotation_limitation_min, sizeof(float) * 3);
-		stream->read((char*) this->rotation_limitation_max, sizeof(float) * 3);
-		stream->read((char*) this->spring_move_coefficient, sizeof(float) * 3);
-		stream->read((char*) this->spring_rotation_coefficient, sizeof(float) * 3);
+		//// \tg{fB
+		//if (this->version == 2.1f)
+		//{
+		//	this->soft_body_count = reader->Read<int>();
+		//	this->soft_bodies = std::make_unique<PmxSoftBody []>(this->soft_body_count);
+		//	for (int i = 0; i < this->soft_body_count; i++)
+		//	{
+		//		this->soft_bodies[i].Read(reader, &setting);
+		//	}
+		//}
 	}
 
-	void PmxJoint::Read(std::istream *stream, PmxSetting *setting)
+	std::unique_ptr<PmxModel> PmxModel::ReadFromFile(const char *filename, uint32_t flags)
 	{
-		this->joint_name = ReadString(stream, setting->encoding);
-		this->joint_english_name = ReadString(stream, setting->encoding);
-		stream->read((char*) &this->joint_type, sizeof(uint8_t));
-		this->param.Read(stream, setting);
+		oguna::MappedFile file;
+		if (!file.Open(filename))
+		{
+			std::cerr << "could not open \"" << filename << "\"" << std::endl;
+			return nullptr;
+		}
+		auto pmx = std::make_unique<PmxModel>();
+		pmx->Read(file.Data(), file.Size(), flags);
+		pmx->source_filename = filename;
+		return pmx;
 	}
 
-	void PmxAncherRigidBody::Read(std::istream *stream, PmxSetting *setting)
+	std::unique_ptr<PmxModel> PmxModel::ReadFromStream(std::istream *stream, uint32_t flags)
 	{
-		this->related_rigid_body = ReadIndex(stream, setting->rigidbody_index_size);
-		this->related_vertex = ReadIndex(stream, setting->vertex_index_size);
-		stream->read((char*) &this->is_near, sizeof(uint8_t));
+		auto pmx = std::make_unique<PmxModel>();
+		pmx->Read(stream, flags);
+		return pmx;
 	}
 
-	void PmxSoftBody::Read(std::istream *stream, PmxSetting *setting)
+	PmxSetting PmxModel::MinimalSetting() const
 	{
-		// 
-		std::cerr << "Not Implemented Exception" << std::endl;
-		throw;
+		PmxSetting result;
+		result.encoding = this->setting.encoding;
+		result.uv = this->setting.uv;
+		result.vertex_index_size = MinimalIndexSize(this->vertex_count, true);
+		result.texture_index_size = MinimalIndexSize(this->texture_count, false);
+		result.material_index_size = MinimalIndexSize(this->material_count, false);
+		result.bone_index_size = MinimalIndexSize(this->bone_count, false);
+		result.morph_index_size = MinimalIndexSize(this->morph_count, false);
+		result.rigidbody_index_size = MinimalIndexSize(this->rigid_body_count, false);
+		return result;
 	}
 
-	void PmxModel::Init()
+	size_t PmxModel::EstimateWriteSize(const PmxSetting *setting) const
 	{
-		this->version = 0.0f;
-		this->model_name.clear();
-		this->model_english_name.clear();
-		this->model_comment.clear();
-		this->model_english_commnet.clear();
-		this->vertex_count = 0;
-		this->vertices = nullptr;
-		this->index_count = 0;
-		this->indices = nullptr;
-		this->texture_count = 0;
-		this->textures = nullptr;
-		this->material_count = 0;
-		this->materials = nullptr;
-		this->bone_count = 0;
-		this->bones = nullptr;
-		this->morph_count = 0;
-		this->morphs = nullptr;
-		this->frame_count = 0;
-		this->frames = nullptr;
-		this->rigid_body_count = 0;
-		this->rigid_bodies = nullptr;
-		this->joint_count = 0;
-		this->joints = nullptr;
-		this->soft_body_count = 0;
-		this->soft_bodies = nullptr;
+		// _̓XLjOł傫ȂꍇŌς
+		size_t vertex_size = sizeof(float) * (8 + 4 * setting->uv) + 1 + setting->bone_index_size * 4 + sizeof(float) * 10 + sizeof(float);
+		return vertex_size * this->vertex_count + (size_t) setting->vertex_index_size * this->index_count + (1 << 16);
 	}
 
-	void PmxModel::Read(std::istream *stream)
+	void PmxModel::WriteVertices(oguna::BinaryWriter *writer, const PmxSetting *setting) const
 	{
-		// }WbN
-		char magic[4];
-		stream->read((char*) magic, sizeof(char) * 4);
-		if (magic[0] != 0x50 || magic[1] != 0x4d || magic[2] != 0x58 || magic[3] != 0x20)
+		writer->Write(this->vertex_count);
+		const PmxPackedSkinning *packed = this->packed_skinning.types.size() == (size_t) this->vertex_count ? &this->packed_skinning : nullptr;
+		size_t sdef_cursor = 0;
+		if (!this->vertices)
 		{
-			std::cerr << "invalid magic number." << std::endl;
-			throw;
+			if (this->vertex_count > 0 && (packed == nullptr || this->vertex_columns.vertex_count != this->vertex_count))
+			{
+				throw "vertices are not loaded";
+			}
+			for (int i = 0; i < this->vertex_count; i++)
+			{
+				this->vertex_columns.Write(writer, setting, packed, i, &sdef_cursor);
+			}
 		}
-		// o[W
-		stream->read((char*) &version, sizeof(float));
-		if (version != 2.0f && version != 2.1f)
+		else
 		{
-			std::cerr << "this is not ver2.0 or ver2.1 but " << version << "." << std::endl;
-			throw;
+			for (int i = 0; i < this->vertex_count; i++)
+			{
+				this->vertices[i].Write(writer, setting, packed, i, &sdef_cursor);
+			}
 		}
-		// t@Cݒ
-		this->setting.Read(stream);
+	}
 
-		// f
-		this->model_name.swap(ReadString(stream, setting.encoding));
-		this->model_english_name.swap(ReadString(stream, setting.encoding));
-		this->model_comment.swap(ReadString(stream, setting.encoding));
-		this->model_english_commnet.swap(ReadString(stream, setting.encoding));
-
-		// _
-		stream->read((char*) &vertex_count, sizeof(int));
-		this->vertices = std::make_unique<PmxVertex []>(vertex_count);
-		for (int i = 0; i < vertex_count; i++)
+	void PmxModel::Write(oguna::BinaryWriter *writer) const
+	{
+		// ǂݔ΂ZNVcĂƗvf̂ŏ܂Ȃ
+		for (int i = 0; i < (int) PmxSection::Count; i++)
 		{
-			vertices[i].Read(stream, &setting);
+			if (!IsSectionLoaded((PmxSection) i) && this->sections.counts[i] > 0)
+			{
+				throw "section is not loaded";
+			}
 		}
-
-		// 
-		stream->read((char*) &index_count, sizeof(int));
-		this->indices = std::make_unique<int []>(index_count);
-		for (int i = 0; i < index_count; i++)
+		if (this->soft_body_count > 0)
 		{
-			this->indices[i] = ReadIndex(stream, setting.vertex_index_size);
+			throw "soft body is not supported";
 		}
+		PmxSetting setting = MinimalSetting();
+		writer->Reserve(EstimateWriteSize(&setting));
+
+		// wb_ƃf
+		writer->Write("PMX ", 4);
+		writer->Write(this->version == 2.1f ? 2.1f : 2.0f);
+		setting.Write(writer);
+		WriteString(writer, this->model_name, setting.encoding);
+		WriteString(writer, this->model_english_name, setting.encoding);
+		WriteString(writer, this->model_comment, setting.encoding);
+		WriteString(writer, this->model_english_commnet, setting.encoding);
 
-		// eNX`
-		stream->read((char*) &texture_count, sizeof(int));
-		this->textures = std::make_unique<std::wstring []>(texture_count);
-		for (int i = 0; i < texture_count; i++)
+		WriteVertices(writer, &setting);
+		writer->Write(this->index_count);
+		WriteIndices(writer, setting.vertex_index_size, this->indices.get(), this->index_count);
+		writer->Write(this->texture_count);
+		for (int i = 0; i < this->texture_count; i++)
 		{
-			this->textures[i] = ReadString(stream, setting.encoding);
+			WriteString(writer, this->textures[i], setting.encoding);
 		}
-
-		// }eA
-		stream->read((char*) &material_count, sizeof(int));
-		this->materials = std::make_unique<PmxMaterial []>(material_count);
-		for (int i = 0; i < material_count; i++)
+		writer->Write(this->material_count);
+		for (int i = 0; i < this->material_count; i++)
 		{
-			this->materials[i].Read(stream, &setting);
+			this->materials[i].Write(writer, &setting);
 		}
-
-		// {[
-		stream->read((char*) &this->bone_count, sizeof(int));
-		this->bones = std::make_unique<PmxBone []>(this->bone_count);
+		writer->Write(this->bone_count);
 		for (int i = 0; i < this->bone_count; i++)
 		{
-			this->bones[i].Read(stream, &setting);
+			this->bones[i].Write(writer, &setting);
 		}
-
-		// [t
-		stream->read((char*) &this->morph_count, sizeof(int));
-		this->morphs = std::make_unique<PmxMorph []>(this->morph_count);
+		writer->Write(this->morph_count);
 		for (int i = 0; i < this->morph_count; i++)
 		{
-			this->morphs[i].Read(stream, &setting);
+			this->morphs[i].Write(writer, &setting);
 		}
-
-		// \g
-		stream->read((char*) &this->frame_count, sizeof(int));
-		this->frames = std::make_unique<PmxFrame []>(this->frame_count);
+		writer->Write(this->frame_count);
 		for (int i = 0; i < this->frame_count; i++)
 		{
-			this->frames[i].Read(stream, &setting);
+			this->frames[i].Write(writer, &setting);
 		}
-
-		// 
-		stream->read((char*) &this->rigid_body_count, sizeof(int));
-		this->rigid_bodies = std::make_unique<PmxRigidBody []>(this->rigid_body_count);
+		writer->Write(this->rigid_body_count);
 		for (int i = 0; i < this->rigid_body_count; i++)
 		{
-			this->rigid_bodies[i].Read(stream, &setting);
+			this->rigid_bodies[i].Write(writer, &setting);
 		}
-
-		// WCg
-		stream->read((char*) &this->joint_count, sizeof(int));
-		this->joints = std::make_unique<PmxJoint []>(this->joint_count);
+		writer->Write(this->joint_count);
 		for (int i = 0; i < this->joint_count; i++)
 		{
-			this->joints[i].Read(stream, &setting);
+			this->joints[i].Write(writer, &setting);
 		}
+		// \tg{fB͓ǂݍ݂ɑΉĂȂ̂ŁA2.1ł͋̃ZNVƂ
+		if (this->version == 2.1f)
+		{
+			writer->Write<int>(0);
+		}
+	}
 
-		//// \tg{fB
-		//if (this->version == 2.1f)
-		//{
-		//	stream->read((char*) &this->soft_body_count, sizeof(int));
-		//	this->soft_bodies = std::make_unique<PmxSoftBody []>(this->soft_body_count);
-		//	for (int i = 0; i < this->soft_body_count; i++)
-		//	{
-		//		this->soft_bodies[i].Read(stream, &setting);
-		//	}
-		//}
+	bool PmxModel::Write(std::ostream *stream) const
+	{
+		oguna::BinaryWriter writer;
+		this->Write(&writer);
+		return (bool) stream->write(writer.Data(), writer.Size());
 	}
 
-	//std::unique_ptr<PmxModel> ReadFromFile(const char *filename)
-	//{
-	//	auto stream = std::ifstream(filename, std::ios_base::binary);
-	//	auto pmx = PmxModel::ReadFromStream(&stream);
-	//	if (!stream.eof())
-	//	{
-	//		std::cerr << "don't reach the end of file." << std::endl;
-	//	}
-	//	stream.close();
-	//	return pmx;
-	//}
-
-	//std::unique_ptr<PmxModel> ReadFromStream(std::istream *stream)
-	//{
-	//	auto pmx = std::make_unique<PmxModel>();
-	//	pmx->Read(stream);
-	//	return pmx;
-	//}
+	bool PmxModel::WriteToFile(const char *filename) const
+	{
+		std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			std::cerr << "could not open \"" << filename << "\"" << std::endl;
+			return false;
+		}
+		return this->Write(&stream);
+	}
 }
\ No newline at end of file
@@ -1,11 +1,40 @@
+#pragma once
 #include <vector>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include "BinaryReader.h"
+#include "BinaryWriter.h"
+#include "AlignedArray.h"
 
 namespace pmx
 {
+	/// ǂݍ݃IvV(rbg̑gݍ킹Ŏw肷)
+	enum PmxReadFlag : uint32_t
+	{
+		/// ̓ǂݍ
+		PmxReadDefault = 0x0000,
+		/// XLjO𒸓_ƂɊmۂPmxModel::packed_skinning֋l߂Ċi[
+		PmxReadPackedSkinning = 0x0001,
+		/// _PmxVertex̔zł͂ȂPmxModel::vertex_columns֗񂲂ƂɊi[(XLjOpacked_skinning֊i[)
+		PmxReadVertexColumns = 0x0002,
+		/// ̃oCg񂩂ǂޏꍇAZNV̈ʒuɑĂɓǂݍ
+		PmxReadParallel = 0x0004,
+		/// ȉ̃ZNVǂݔ΂(ʒuƗvf͋L^AォPmxModel::LoadSectionœǂݍ߂)
+		PmxReadSkipVertex = 0x0100,
+		PmxReadSkipIndex = 0x0200,
+		PmxReadSkipTexture = 0x0400,
+		PmxReadSkipMaterial = 0x0800,
+		PmxReadSkipBone = 0x1000,
+		PmxReadSkipMorph = 0x2000,
+		PmxReadSkipFrame = 0x4000,
+		PmxReadSkipRigidBody = 0x8000,
+		PmxReadSkipJoint = 0x10000,
+		/// wb_ƃf񂾂ǂݍ
+		PmxReadHeaderOnly = 0x1ff00,
+	};
+
 	/// CfbNXݒ
 	class PmxSetting
 	{
@@ -37,7 +66,8 @@ namespace pmx
 		uint8_t morph_index_size;
 		/// ̃CfbNXTCY
 		uint8_t rigidbody_index_size;
-		void Read(std::istream *stream);
+		void Read(oguna::BinaryReader *reader);
+		void Write(oguna::BinaryWriter *writer) const;
 	};
 
 	/// _XLjO^Cv
@@ -54,7 +84,8 @@ namespace pmx
 	class PmxVertexSkinning
 	{
 	public:
-		virtual void Read(std::istream *stream, PmxSetting *setting) = 0;
+		virtual void Read(oguna::BinaryReader *reader, PmxSetting *setting) = 0;
+		virtual void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const = 0;
 	};
 
 	class PmxVertexSkinningBDEF1 : public PmxVertexSkinning
@@ -65,7 +96,8 @@ namespace pmx
 		{}
 
 		int bone_index;
-		void Read(std::istream *stresam, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	class PmxVertexSkinningBDEF2 : public PmxVertexSkinning
@@ -80,7 +112,8 @@ namespace pmx
 		int bone_index1;
 		int bone_index2;
 		float bone_weight;
-		void Read(std::istream *stresam, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	class PmxVertexSkinningBDEF4 : public PmxVertexSkinning
@@ -105,7 +138,8 @@ namespace pmx
 		float bone_weight2;
 		float bone_weight3;
 		float bone_weight4;
-		void Read(std::istream *stresam, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	class PmxVertexSkinningSDEF : public PmxVertexSkinning
@@ -129,7 +163,8 @@ namespace pmx
 		float sdef_c[3];
 		float sdef_r0[3];
 		float sdef_r1[3];
-		void Read(std::istream *stresam, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	class PmxVertexSkinningQDEF : public PmxVertexSkinning
@@ -154,7 +189,58 @@ namespace pmx
 		float bone_weight2;
 		float bone_weight3;
 		float bone_weight4;
-		void Read(std::istream *stresam, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
+	};
+
+	class PmxVertex;
+
+	/// SDEF̒ǉp[^
+	class PmxSdefParameter
+	{
+	public:
+		PmxSdefParameter()
+			: vertex_index(0)
+		{
+			for (int i = 0; i < 3; ++i) {
+				sdef_c[i] = 0.0f;
+				sdef_r0[i] = 0.0f;
+				sdef_r1[i] = 0.0f;
+			}
+		}
+
+		/// _CfbNX
+		int vertex_index;
+		float sdef_c[3];
+		float sdef_r0[3];
+		float sdef_r1[3];
+	};
+
+	/// S_̃XLjOAzɋl߂
+	/// _ƂɃ{[4{̃CfbNXƃEFCgAgȂg̓CfbNX0EEFCg0Ƃ
+	/// BDEF2/SDEF̃EFCg(w, 1-w)ɓWJĊi[
+	class PmxPackedSkinning
+	{
+	public:
+		/// XLjO^Cv(_)
+		std::vector<PmxVertexSkinningType> types;
+		/// {[CfbNX(_*4)
+		std::vector<int> bone_indices;
+		/// {[EFCg(_*4)
+		std::vector<float> bone_weights;
+		/// SDEF̒ǉp[^(_CfbNX)
+		std::vector<PmxSdefParameter> sdef;
+
+		/// _̗̈mۂ
+		void Resize(int vertex_count);
+		/// _vertex̃XLjOǂݍ
+		/// SDEF̒ǉp[^sdef_outnullptrȂsdefցAłȂsdef_out֒ǉ
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting, int vertex, PmxVertexSkinningType type, std::vector<PmxSdefParameter> *sdef_out = nullptr);
+		/// _Ƃ̃XLjOlߒ
+		void Pack(const PmxVertex *vertices, int vertex_count);
+		/// _vertex̃XLjO^CvƃXLjO
+		/// sdef_cursorsdef𒸓_ɒHʒuŁA0n߂Ē_ɌĂяo
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting, int vertex, size_t *sdef_cursor) const;
 	};
 
 	/// _
@@ -190,7 +276,49 @@ namespace pmx
 		std::unique_ptr<PmxVertexSkinning> skinning;
 		/// GbW{
 		float edge;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		/// packednullptrłȂ΃XLjOpackedindexԖڂ֊i[
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting, PmxPackedSkinning *packed, int index, std::vector<PmxSdefParameter> *sdef_out = nullptr);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
+		/// XLjOȂ_(PmxReadPackedSkinningœǂݍ񂾂)packedindexԖڂ珑
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting, const PmxPackedSkinning *packed, int index, size_t *sdef_cursor) const;
+	};
+
+	/// _vfƂ̗ɕĊi[
+	/// e32oCgEɂ낦ĊmۂAǉUVsetting.uv̐mۂ
+	class PmxVertexColumns
+	{
+	public:
+		PmxVertexColumns()
+			: vertex_count(0)
+			, additional_uv_count(0)
+		{}
+
+		/// _
+		int vertex_count;
+		/// ǉUV
+		int additional_uv_count;
+		/// ʒu(_*3)
+		oguna::AlignedArray<float> positions;
+		/// @(_*3)
+		oguna::AlignedArray<float> normals;
+		/// eNX`W(_*2)
+		oguna::AlignedArray<float> uvs;
+		/// ǉeNX`W(ǉUVAꂼ꒸_*4)
+		oguna::AlignedArray<float> additional_uvs[4];
+		/// GbW{(_)
+		oguna::AlignedArray<float> edges;
+
+		/// _̗̈mۂ
+		void Resize(int vertex_count, int additional_uv_count);
+		/// indexԖڂ̒_ǂݍ
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting, PmxPackedSkinning *packed, int index, std::vector<PmxSdefParameter> *sdef_out = nullptr);
+		/// indexԖڂ̒_
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting, const PmxPackedSkinning *packed, int index, size_t *sdef_cursor) const;
+		/// PmxVertex̔z񂩂ɕĊi[
+		void Pack(const PmxVertex *vertices, int vertex_count, int additional_uv_count);
+		/// gpĂoCg
+		size_t MemorySize() const;
 	};
 
 	/// }eA
@@ -250,7 +378,8 @@ namespace pmx
 		std::wstring memo;
 		/// _CfbNX
 		int index_count;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	/// N
@@ -275,7 +404,8 @@ namespace pmx
 		float max_radian[3];
 		/// ŏpx
 		float min_radian[3];
-		void Read(std::istream *stream, PmxSetting *settingn);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	/// {[
@@ -342,7 +472,8 @@ namespace pmx
 		int ik_link_count;
 		/// IKN
 		std::unique_ptr<PmxIkLink []> ik_links;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	enum class MorphType : uint8_t
@@ -372,7 +503,8 @@ namespace pmx
 	class PmxMorphOffset
 	{
 	public:
-		void virtual Read(std::istream *stream, PmxSetting *setting) = 0;
+		void virtual Read(oguna::BinaryReader *reader, PmxSetting *setting) = 0;
+		void virtual Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const = 0;
 	};
 
 	class PmxMorphVertexOffset : public PmxMorphOffset
@@ -387,7 +519,8 @@ namespace pmx
 		}
 		int vertex_index;
 		float position_offset[3];
-		void Read(std::istream *stream, PmxSetting *setting) override;
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting) override;
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const override;
 	};
 
 	class PmxMorphUVOffset : public PmxMorphOffset
@@ -402,7 +535,8 @@ namespace pmx
 		}
 		int vertex_index;
 		float uv_offset[4];
-		void Read(std::istream *stream, PmxSetting *setting) override;
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting) override;
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const override;
 	};
 
 	class PmxMorphBoneOffset : public PmxMorphOffset
@@ -421,7 +555,8 @@ namespace pmx
 		int bone_index;
 		float translation[3];
 		float rotation[4];
-		void Read(std::istream *stream, PmxSetting *setting) override;
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting) override;
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const override;
 	};
 
 	class PmxMorphMaterialOffset : public PmxMorphOffset
@@ -454,7 +589,8 @@ namespace pmx
 		float texture_argb[4];
 		float sphere_texture_argb[4];
 		float toon_texture_argb[4];
-		void Read(std::istream *stream, PmxSetting *setting) override;
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting) override;
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const override;
 	};
 
 	class PmxMorphGroupOffset : public PmxMorphOffset
@@ -466,7 +602,8 @@ namespace pmx
 		{}
 		int morph_index;
 		float morph_weight;
-		void Read(std::istream *stream, PmxSetting *setting) override;
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting) override;
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const override;
 	};
 
 	class PmxMorphFlipOffset : public PmxMorphOffset
@@ -478,7 +615,8 @@ namespace pmx
 		{}
 		int morph_index;
 		float morph_value;
-		void Read(std::istream *stream, PmxSetting *setting) override;
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting) override;
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const override;
 	};
 
 	class PmxMorphImplusOffset : public PmxMorphOffset
@@ -497,7 +635,8 @@ namespace pmx
 		uint8_t is_local;
 		float velocity[3];
 		float angular_torque[3];
-		void Read(std::istream *stream, PmxSetting *setting) override;
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting) override;
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const override;
 	};
 
 	/// [t
@@ -532,7 +671,8 @@ namespace pmx
 		std::unique_ptr<PmxMorphFlipOffset []> flip_offsets;
 		/// CpX[tz
 		std::unique_ptr<PmxMorphImplusOffset []> implus_offsets;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	/// gvf
@@ -548,7 +688,8 @@ namespace pmx
 		uint8_t element_target;
 		/// vfΏۃCfbNX
 		int index;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	/// \g
@@ -570,7 +711,8 @@ namespace pmx
 		int element_count;
 		/// gvfz
 		std::unique_ptr<PmxFrameElement []> elements;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	class PmxRigidBody
@@ -615,7 +757,8 @@ namespace pmx
 		float repulsion;
 		float friction;
 		uint8_t physics_calc_type;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	enum class PmxJointType : uint8_t
@@ -656,7 +799,8 @@ namespace pmx
 		float rotation_limitation_max[3];
 		float spring_move_coefficient[3];
 		float spring_rotation_coefficient[3];
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	class PmxJoint
@@ -666,7 +810,8 @@ namespace pmx
 		std::wstring joint_english_name;
 		PmxJointType joint_type;
 		PmxJointParam param;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+		void Write(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
 	};
 
 	enum PmxSoftBodyFlag : uint8_t
@@ -687,7 +832,7 @@ namespace pmx
 		int related_rigid_body;
 		int related_vertex;
 		bool is_near;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
 	};
 
 	class PmxSoftBody
@@ -772,7 +917,54 @@ namespace pmx
 		std::unique_ptr<PmxAncherRigidBody []> anchers;
 		int pin_vertex_count;
 		std::unique_ptr<int []> pin_vertices;
-		void Read(std::istream *stream, PmxSetting *setting);
+		void Read(oguna::BinaryReader *reader, PmxSetting *setting);
+	};
+
+	/// ZNV̎
+	enum class PmxSection : int
+	{
+		Vertex = 0,
+		Index,
+		Texture,
+		Material,
+		Bone,
+		Morph,
+		Frame,
+		RigidBody,
+		Joint,
+		Count,
+	};
+
+	/// vfǂ܂ɑċ߂eZNV̈ʒu
+	class PmxSectionTable
+	{
+	public:
+		PmxSectionTable()
+			: end(0)
+			, vertex_chunk_size(0)
+		{
+			for (int i = 0; i < (int) PmxSection::Count; i++)
+			{
+				offsets[i] = 0;
+				counts[i] = 0;
+			}
+		}
+
+		/// eZNV̗vf̈ʒu(f[^擪̃oCg)
+		size_t offsets[(int) PmxSection::Count];
+		/// eZNV̗vf
+		int counts[(int) PmxSection::Count];
+		/// WCgZNV̏I[
+		size_t end;
+		/// vertex_chunk_offsets̊Ԋu(_)
+		int vertex_chunk_size;
+		/// vertex_chunk_size_Ƃ̒_̈ʒu
+		std::vector<size_t> vertex_chunk_offsets;
+		/// e[ẗʒu
+		std::vector<size_t> morph_offsets;
+
+		/// _ZNV̐擪瑖
+		void Scan(oguna::BinaryReader *reader, PmxSetting *setting, int vertex_chunk_size = 4096);
 	};
 
 	/// PMXf
@@ -791,6 +983,8 @@ namespace pmx
 			, rigid_body_count(0)
 			, joint_count(0)
 			, soft_body_count(0)
+			, skipped_sections(0)
+			, read_flags(PmxReadDefault)
 		{}
 
 		/// o[W
@@ -809,6 +1003,10 @@ namespace pmx
 		int vertex_count;
 		/// _z
 		std::unique_ptr<PmxVertex []> vertices;
+		/// l߂XLjO(PmxReadPackedSkinningw莞)
+		PmxPackedSkinning packed_skinning;
+		/// 񂲂Ƃ̒_(PmxReadVertexColumnsw莞AverticesnullptrɂȂ)
+		PmxVertexColumns vertex_columns;
 		/// CfbNX
 		int index_count;
 		/// CfbNXz
@@ -845,13 +1043,57 @@ namespace pmx
 		int soft_body_count;
 		/// \tg{fBz
 		std::unique_ptr<PmxSoftBody []> soft_bodies;
+		/// eZNV̈ʒuƗvf(ǂݔ΂ZNV܂)
+		PmxSectionTable sections;
+		/// ǂݔ΂A܂͉ZNV(1 << PmxSectioñrbg)
+		/// őgݗĂfׂ͂ẴZNVǂݍݍς݂ƂĈ
+		uint32_t skipped_sections;
+		/// ǂݍݎɎw肵IvV
+		uint32_t read_flags;
+		/// ReadFromFileœǂݍ񂾃t@C
+		std::string source_filename;
 		/// f
 		void Init();
+		/// ZNVǂݍݍς݂ǂ
+		bool IsSectionLoaded(PmxSection section) const;
+		/// ǂݔ΂ZNVǂݍ(datasizeɂ͍ŏɓǂݍ񂾂̂ƓoCgn)
+		void LoadSection(PmxSection section, const char *data, size_t size);
+		/// ǂݔ΂ZNVReadFromFileœǂݍ񂾃t@Cǂݍ
+		bool LoadSection(PmxSection section);
+		/// ZNVĖǂݍ݂̏Ԃɖ߂
+		void UnloadSection(PmxSection section);
 		/// fǂݍ
-		void Read(std::istream *stream);
-		///// t@C烂f̓ǂݍ
-		//static std::unique_ptr<PmxModel> ReadFromFile(const char *filename);
-		///// ̓Xg[烂f̓ǂݍ
-		//static std::unique_ptr<PmxModel> ReadFromStream(std::istream *stream);
+		void Read(std::istream *stream, uint32_t flags = PmxReadDefault);
+		/// ĂяoLoCg񂩂烂fǂݍ
+		void Read(const char *data, size_t size, uint32_t flags = PmxReadDefault);
+		/// J[\烂fǂݍ
+		void Read(oguna::BinaryReader *reader, uint32_t flags = PmxReadDefault);
+		/// t@CɃ}bvăf̓ǂݍ
+		static std::unique_ptr<PmxModel> ReadFromFile(const char *filename, uint32_t flags = PmxReadDefault);
+		/// ̓Xg[烂f̓ǂݍ
+		static std::unique_ptr<PmxModel> ReadFromStream(std::istream *stream, uint32_t flags = PmxReadDefault);
+		/// vf狁߂ŏ̃CfbNXTCYݒ(GR[hƒǉUVsettinĝ܂)
+		PmxSetting MinimalSetting() const;
+		/// MinimalSetting̃CfbNXTCYŃf(setting͕ύXȂ)
+		void Write(oguna::BinaryWriter *writer) const;
+		/// fŜɑgݗĂĂxɏo̓Xg[֏o
+		bool Write(std::ostream *stream) const;
+		/// t@Cփfo
+		bool WriteToFile(const char *filename) const;
+	private:
+		/// wb_ƃfǂݍ
+		void ReadHeader(oguna::BinaryReader *reader);
+		/// _i[̈mۂ
+		void AllocateVertices(int count, uint32_t flags);
+		/// begin`end-1Ԗڂ̒_ǂݍ
+		void ReadVertices(oguna::BinaryReader *reader, uint32_t flags, int begin, int end, std::vector<PmxSdefParameter> *sdef_out);
+		/// ZNVǂݍŗvfԂ
+		int ReadSection(oguna::BinaryReader *reader, PmxSection section, uint32_t flags);
+		/// ZNV̈ʒu𑖍ĂeZNVɓǂݍ
+		void ReadParallel(const char *data, size_t size, uint32_t flags);
+		/// _i[Ă`ɍ킹ď
+		void WriteVertices(oguna::BinaryWriter *writer, const PmxSetting *setting) const;
+		/// ރoCǧς(_ƃCfbNX̕)
+		size_t EstimateWriteSize(const PmxSetting *setting) const;
 	};
 }
\ No newline at end of file
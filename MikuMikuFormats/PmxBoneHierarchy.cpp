@@ -0,0 +1,496 @@
+#include "PmxBoneHierarchy.h"
+#include <algorithm>
+#include "MathHelper.h"
+#include "SimdHelper.h"
+#include "ThreadPool.h"
+
+namespace pmx
+{
+	typedef oguna::FloatLanes Lanes;
+
+	void PmxBoneHierarchy::Setup(const PmxModel &model)
+	{
+		if (!model.IsSectionLoaded(PmxSection::Bone))
+		{
+			throw "bone section is not loaded";
+		}
+		Allocate(model.bone_count);
+		std::vector<int> levels(bone_count);
+		for (int i = 0; i < bone_count; i++)
+		{
+			const PmxBone &bone = model.bones[i];
+			int parent = bone.parent_index;
+			parents[i] = (parent >= 0 && parent < bone_count && parent != i) ? parent : -1;
+			flags[i] = bone.bone_flag;
+			int grant = bone.grant_parent_index;
+			grant_parents[i] = ((bone.bone_flag & (0x0100 | 0x0200)) && grant >= 0 && grant < bone_count && grant != i) ? grant : -1;
+			grant_weights[i] = bone.grant_weight;
+			levels[i] = bone.level;
+			for (int c = 0; c < 3; c++)
+			{
+				positions[i * 3 + c] = bone.position[c];
+			}
+		}
+		ik.Setup(model);
+		Build(levels);
+	}
+
+	void PmxBoneHierarchy::Setup(const mmd::RuntimeModel &model)
+	{
+		Allocate(model.BoneCount());
+		std::vector<int> levels(bone_count);
+		for (int i = 0; i < bone_count; i++)
+		{
+			const mmd::RuntimeBone &bone = model.bones[i];
+			int parent = bone.parent;
+			parents[i] = (parent >= 0 && parent < bone_count && parent != i) ? parent : -1;
+			flags[i] = bone.flag;
+			int grant = bone.grant_parent;
+			grant_parents[i] = ((bone.flag & (0x0100 | 0x0200)) && grant >= 0 && grant < bone_count && grant != i) ? grant : -1;
+			grant_weights[i] = bone.grant_weight;
+			levels[i] = bone.level;
+			for (int c = 0; c < 3; c++)
+			{
+				positions[i * 3 + c] = bone.position[c];
+			}
+		}
+		ik.Setup(model);
+		Build(levels);
+	}
+
+	void PmxBoneHierarchy::Allocate(int count)
+	{
+		bone_count = count;
+		positions.resize(bone_count * 3);
+		offsets.resize(bone_count * 3);
+		parents.resize(bone_count);
+		flags.resize(bone_count);
+		grant_parents.resize(bone_count);
+		grant_weights.resize(bone_count);
+	}
+
+	void PmxBoneHierarchy::Build(const std::vector<int> &levels)
+	{
+		const int width = Lanes::Width;
+		for (int i = 0; i < bone_count; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				offsets[i * 3 + c] = positions[i * 3 + c] - (parents[i] >= 0 ? positions[parents[i] * 3 + c] : 0.0f);
+			}
+		}
+
+		// ό`(0x1000)Aό`KwACfbNX̏ɕׂ
+		std::vector<int> order(bone_count);
+		for (int i = 0; i < bone_count; i++)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [this, &levels](int a, int b)
+		{
+			bool after_a = (flags[a] & 0x1000) != 0;
+			bool after_b = (flags[b] & 0x1000) != 0;
+			if (after_a != after_b)
+			{
+				return !after_a;
+			}
+			return levels[a] < levels[b];
+		});
+		int after_physics_begin = bone_count;
+		std::vector<int> positions_in_order(bone_count);
+		for (int k = bone_count - 1; k >= 0; k--)
+		{
+			positions_in_order[order[k]] = k;
+			if (flags[order[k]] & 0x1000)
+			{
+				after_physics_begin = k;
+			}
+		}
+
+		// Oƕ̂ꂼAIK{[̌ŋ؂(؂育ƂIK)
+		ik_enabled.reset(new bool[ik.ChainCount()]);
+		std::fill(ik_enabled.get(), ik_enabled.get() + ik.ChainCount(), true);
+		segments.clear();
+		std::vector<int> segment_ends;
+		phase_segments[0] = 0;
+		for (int k = 0; k < bone_count; k++)
+		{
+			int bone = order[k];
+			Segment segment;
+			segment.chain = (flags[bone] & 0x0020) ? ik.FindChain(bone) : -1;
+			if (segment.chain >= 0 || k + 1 == after_physics_begin || k + 1 == bone_count)
+			{
+				segments.push_back(segment);
+				segment_ends.push_back(k + 1);
+			}
+			if (k + 1 == after_physics_begin)
+			{
+				phase_segments[1] = (int) segments.size();
+			}
+		}
+		if (after_physics_begin == bone_count)
+		{
+			phase_segments[1] = (int) segments.size();
+		}
+		phase_segments[2] = (int) segments.size();
+		std::vector<int> segment_of(bone_count);
+		for (size_t s = 0, k = 0; s < segments.size(); s++)
+		{
+			for (; k < (size_t) segment_ends[s]; k++)
+			{
+				segment_of[order[k]] = (int) s;
+			}
+		}
+
+		// i͕яőO̐eɁAeƂĎQƂяőO̎q(vZO̒lǂ)ɂ
+		std::vector<std::vector<int>> children(bone_count);
+		for (int i = 0; i < bone_count; i++)
+		{
+			if (parents[i] >= 0)
+			{
+				children[parents[i]].push_back(i);
+			}
+		}
+		std::vector<int> depths(bone_count, 0);
+		for (int k = 0; k < bone_count; k++)
+		{
+			int bone = order[k];
+			int depth = 0;
+			int parent = parents[bone];
+			if (parent >= 0 && segment_of[parent] == segment_of[bone] && positions_in_order[parent] < k)
+			{
+				depth = std::max(depth, depths[parent] + 1);
+			}
+			for (int child : children[bone])
+			{
+				if (segment_of[child] == segment_of[bone] && positions_in_order[child] < k)
+				{
+					depth = std::max(depth, depths[child] + 1);
+				}
+			}
+			depths[bone] = depth;
+		}
+
+		std::vector<int> bones;
+		stage_offsets.assign(1, 0);
+		granted_bones.clear();
+		grants_previous.clear();
+		refresh_bones.clear();
+		for (size_t s = 0; s < segments.size(); s++)
+		{
+			Segment &segment = segments[s];
+			int begin = s == 0 ? 0 : segment_ends[s - 1];
+			int end = segment_ends[s];
+			segment.stage_begin = (int) stage_offsets.size() - 1;
+			segment.granted_begin = (int) granted_bones.size();
+			for (int k = begin; k < end; k++)
+			{
+				int grant = grant_parents[order[k]];
+				if (grant >= 0)
+				{
+					granted_bones.push_back(order[k]);
+					grants_previous.push_back(positions_in_order[grant] > k ? 1 : 0);
+				}
+			}
+			segment.granted_end = (int) granted_bones.size();
+			int stage_count = 0;
+			for (int k = begin; k < end; k++)
+			{
+				stage_count = std::max(stage_count, depths[order[k]] + 1);
+			}
+			std::vector<std::vector<int>> stages(stage_count);
+			for (int k = begin; k < end; k++)
+			{
+				stages[depths[order[k]]].push_back(order[k]);
+			}
+			for (auto &stage : stages)
+			{
+				size_t padded = (stage.size() + width - 1) / width * width;
+				for (size_t i = 0; i < padded; i++)
+				{
+					bones.push_back(i < stage.size() ? stage[i] : -1);
+				}
+				stage_offsets.push_back((int) bones.size());
+			}
+			segment.stage_end = (int) stage_offsets.size() - 1;
+
+			// IK̃N̎qŁAOĚvZς݂̃{[IǨŌvZ
+			segment.refresh_begin = segment.refresh_end = (int) refresh_bones.size();
+			if (segment.chain < 0)
+			{
+				continue;
+			}
+			std::vector<bool> is_link(bone_count, false);
+			for (int i = 0; i < ik.LinkCount(segment.chain); i++)
+			{
+				int link = ik.LinkBone(segment.chain, i);
+				if (link >= 0 && link < bone_count)
+				{
+					is_link[link] = true;
+				}
+			}
+			int phase_begin = begin < after_physics_begin ? 0 : after_physics_begin;
+			std::vector<std::pair<int, int>> refresh;
+			for (int k = phase_begin; k < end; k++)
+			{
+				int bone = order[k];
+				int generation = 0;
+				bool descendant = false;
+				for (int ancestor = bone; ancestor >= 0 && generation <= bone_count; ancestor = parents[ancestor], generation++)
+				{
+					descendant = descendant || is_link[ancestor];
+				}
+				if (descendant)
+				{
+					refresh.push_back(std::make_pair(generation, bone));
+				}
+			}
+			// eɂȂ悤ɍ̐㏇ɕׂ
+			std::stable_sort(refresh.begin(), refresh.end(), [](const std::pair<int, int> &a, const std::pair<int, int> &b)
+			{
+				return a.first < b.first;
+			});
+			for (auto &entry : refresh)
+			{
+				refresh_bones.push_back(entry.second);
+			}
+			segment.refresh_end = (int) refresh_bones.size();
+		}
+
+		previous_grants.resize(granted_bones.size() * 7);
+
+		// ]͒PʍseɂČvZA܂Ȃ
+		stage_bones.Resize(bones.size());
+		parent_offsets.Resize(bones.size());
+		slots.resize(bone_count);
+		for (int c = 0; c < 7; c++)
+		{
+			stage_locals[c].Resize(bones.size());
+		}
+		for (size_t i = 0; i < bones.size(); i++)
+		{
+			int bone = bones[i];
+			stage_bones[i] = bone;
+			parent_offsets[i] = (bone >= 0 && parents[bone] >= 0 ? parents[bone] : bone_count) * 16;
+			if (bone >= 0)
+			{
+				slots[bone] = (int) i;
+			}
+		}
+
+		// vZO̒lǂރ{[̂߂ɏpɂĂ
+		local_rotations.assign(bone_count * 4, 0.0f);
+		local_translations.assign(bone_count * 3, 0.0f);
+		globals.Resize((bone_count + 1) * 16);
+		for (int i = 0; i <= bone_count; i++)
+		{
+			float *m = &globals[i * 16];
+			m[0] = m[5] = m[10] = m[15] = 1.0f;
+			if (i < bone_count)
+			{
+				local_rotations[i * 4 + 3] = 1.0f;
+				for (int c = 0; c < 3; c++)
+				{
+					m[12 + c] = positions[i * 3 + c];
+				}
+			}
+		}
+	}
+
+	void PmxBoneHierarchy::Evaluate(const float *translations, const float *rotations, bool after_physics)
+	{
+		int phase = after_physics ? 1 : 0;
+		for (int s = phase_segments[phase]; s < phase_segments[phase + 1]; s++)
+		{
+			const Segment &segment = segments[s];
+			PrepareLocals(segment, translations, rotations);
+			for (int stage = segment.stage_begin; stage < segment.stage_end; stage++)
+			{
+				EvaluateStage(stage);
+			}
+			if (segment.chain >= 0 && ik_enabled[segment.chain])
+			{
+				ik.Solve(segment.chain, local_translations.data(), local_rotations.data(), globals.Data());
+				ik.UpdateGlobals(refresh_bones.data() + segment.refresh_begin, segment.refresh_end - segment.refresh_begin, local_translations.data(), local_rotations.data(), globals.Data());
+			}
+		}
+	}
+
+	void PmxBoneHierarchy::EvaluateBatch(PmxBoneHierarchy *const *hierarchies, const float *const *translations, const float *const *rotations, int count)
+	{
+		oguna::ThreadPool::Shared().Run(count, [hierarchies, translations, rotations](int i)
+		{
+			hierarchies[i]->Evaluate(translations[i], rotations[i]);
+		});
+	}
+
+	void PmxBoneHierarchy::PrepareLocals(const Segment &segment, const float *translations, const float *rotations)
+	{
+		static const float identity[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+		// яŌɂt^éÃt[̒lޑOɌvZO̒lĂ
+		for (int k = segment.granted_begin; k < segment.granted_end; k++)
+		{
+			if (!grants_previous[k])
+			{
+				continue;
+			}
+			int grant = grant_parents[granted_bones[k]];
+			float *previous = &previous_grants[k * 7];
+			for (int c = 0; c < 4; c++)
+			{
+				previous[c] = local_rotations[grant * 4 + c];
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				previous[4 + c] = local_translations[grant * 3 + c];
+			}
+		}
+
+		// t^̂Ȃ{[͒i̕т̂܂܃[J̉]ƈړʂ
+		for (int i = stage_offsets[segment.stage_begin]; i < stage_offsets[segment.stage_end]; i++)
+		{
+			int bone = stage_bones[i];
+			if (bone < 0 || grant_parents[bone] >= 0)
+			{
+				continue;
+			}
+			for (int c = 0; c < 4; c++)
+			{
+				float value = rotations[bone * 4 + c];
+				local_rotations[bone * 4 + c] = value;
+				stage_locals[c][i] = value;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				float value = translations ? translations[bone * 3 + c] : 0.0f;
+				local_translations[bone * 3 + c] = value;
+				stage_locals[4 + c][i] = value + offsets[bone * 3 + c];
+			}
+		}
+
+		// t^̂{[͕яɁAt^e̕t^ς݂̉]ƈړɕt^|ĉ
+		// t^eяőOȂ炱̃t[̒lAȂĂvZO̒lg
+		for (int k = segment.granted_begin; k < segment.granted_end; k++)
+		{
+			int bone = granted_bones[k];
+			int grant = grant_parents[bone];
+			float weight = grant_weights[bone];
+			const float *grant_rotation = grants_previous[k] ? &previous_grants[k * 7] : &local_rotations[grant * 4];
+			const float *grant_translation = grants_previous[k] ? &previous_grants[k * 7 + 4] : &local_translations[grant * 3];
+			float *rotation = &local_rotations[bone * 4];
+			float *translation = &local_translations[bone * 3];
+			for (int c = 0; c < 4; c++)
+			{
+				rotation[c] = rotations[bone * 4 + c];
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				translation[c] = translations ? translations[bone * 3 + c] : 0.0f;
+			}
+			if (flags[bone] & 0x0100)
+			{
+				float granted[4];
+				oguna::QuaternionSlerp(identity, grant_rotation, weight, granted);
+				oguna::QuaternionMultiply(rotation, granted, rotation);
+			}
+			if (flags[bone] & 0x0200)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					translation[c] += grant_translation[c] * weight;
+				}
+			}
+			int slot = slots[bone];
+			for (int c = 0; c < 4; c++)
+			{
+				stage_locals[c][slot] = rotation[c];
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				stage_locals[4 + c][slot] = translation[c] + offsets[bone * 3 + c];
+			}
+		}
+	}
+
+	/// ĩ{[̃[Js]ƈړAẽO[os|
+	/// l]sւ̕ϊ̓[ƂɁAe̍sƂ̐ς͍sƂSIMDŌvZ
+	/// ĩ{[݂͌ɈˑȂ̂ŁAe̍s݂̏҂ɑČvZł
+	void PmxBoneHierarchy::EvaluateStage(int stage)
+	{
+		typedef oguna::Float4 Row;
+		float *global_data = globals.Data();
+		Lanes one = Lanes::Set(1.0f);
+		Lanes two = Lanes::Set(2.0f);
+		for (int i = stage_offsets[stage]; i < stage_offsets[stage + 1]; i += Lanes::Width)
+		{
+			Lanes q[4];
+			for (int c = 0; c < 4; c++)
+			{
+				q[c] = Lanes::Load(&stage_locals[c][i]);
+			}
+			Lanes xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+			Lanes xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+			Lanes wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+			Lanes r[9] = {
+				one - two * (yy + zz), two * (xy + wz), two * (xz - wy),
+				two * (xy - wz), one - two * (xx + zz), two * (yz + wx),
+				two * (xz + wy), two * (yz - wx), one - two * (xx + yy),
+			};
+			float local[12][Lanes::Width];
+			for (int j = 0; j < 9; j++)
+			{
+				r[j].Store(local[j]);
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				Lanes::Load(&stage_locals[4 + c][i]).Store(local[9 + c]);
+			}
+
+			// e̍s4ڂ(0, 0, 0, 1)Ȃ̂ŁA4܂Ƃ߂Ċ|4ڂ(0, 0, 0, 1)ɂȂ
+			for (int lane = 0; lane < Lanes::Width; lane++)
+			{
+				int bone = stage_bones[i + lane];
+				if (bone < 0)
+				{
+					continue;
+				}
+				const float *parent = global_data + parent_offsets[i + lane];
+				Row p0 = Row::Load(parent);
+				Row p1 = Row::Load(parent + 4);
+				Row p2 = Row::Load(parent + 8);
+				Row p3 = Row::Load(parent + 12);
+				float *m = global_data + bone * 16;
+				for (int row = 0; row < 4; row++)
+				{
+					Row result = Row::Set(local[row * 3][lane]) * p0 + Row::Set(local[row * 3 + 1][lane]) * p1 + Row::Set(local[row * 3 + 2][lane]) * p2;
+					if (row == 3)
+					{
+						result = result + p3;
+					}
+					result.Store(m + row * 4);
+				}
+			}
+		}
+	}
+
+	void PmxBoneHierarchy::ComputeSkinningMatrices(float *out) const
+	{
+		// ʒu_֖߂ĂO[osœ
+		for (int i = 0; i < bone_count; i++)
+		{
+			const float *m = &globals[i * 16];
+			const float *position = &positions[i * 3];
+			float *skinning = out + i * 16;
+			for (int j = 0; j < 12; j++)
+			{
+				skinning[j] = m[j];
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				skinning[12 + c] = m[12 + c] - (position[0] * m[c] + position[1] * m[4 + c] + position[2] * m[8 + c]);
+			}
+			skinning[15] = 1.0f;
+		}
+	}
+}
\ No newline at end of file
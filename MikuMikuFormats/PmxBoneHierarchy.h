@@ -0,0 +1,169 @@
+#pragma once
+#include <vector>
+#include "Pmx.h"
+#include "AlignedArray.h"
+#include "IkSolver.h"
+#include "RuntimeModel.h"
+
+namespace pmx
+{
+	/// {[̐eq֌WǂăO[os߂
+	///
+	/// SetupŃ{[(ό`, ό`Kw, CfbNX)̏ɕׁȀɌvZƂƓʂɂȂ͈͂ŁA
+	/// ݂ɈˑȂ{[iɂ܂Ƃ߂Ă
+	/// Evaluateł͂܂яɉ]t^(0x0100)ƈړt^(0x0200)Kp[J̉]ƈړ߁A
+	/// ɒiƂSIMD̃[փ{[l߂āA[JsƐẽO[os̐ς߂
+	/// яŌɂȂet^eQƂ{[́AMMDƓvZO(O)̒lg
+	/// s͍sxNgɉE|4x4s(DirectX`Asړ12`14)ŁAl(x, y, z, w)Ƃ
+	/// [Jt^(0x0080)ƊOeό`(0x2000)͈Ȃ
+	class PmxBoneHierarchy
+	{
+	public:
+		PmxBoneHierarchy()
+			: bone_count(0)
+		{
+			phase_segments[0] = phase_segments[1] = phase_segments[2] = 0;
+		}
+
+		/// f̃{[
+		void Setup(const PmxModel &model);
+
+		/// RuntimeModel̃{[(PMD͕̂ό`Kwׂ0Ȃ̂ŁACfbNXɌvZ)
+		void Setup(const mmd::RuntimeModel &model);
+
+		/// {[Ƃ̈ړtranslations({[*3AnullptrȂړȂ)Ɖ]rotations({[*4)AׂẴ{[̃O[os߂
+		/// ړƉ]͏p̐e̍Wnł̕ω(VMD̃{[t[Ɠ)Ƃ
+		void Evaluate(const float *translations, const float *rotations)
+		{
+			Evaluate(translations, rotations, false);
+			Evaluate(translations, rotations, true);
+		}
+
+		/// O(after_physicsfalse)̃{[vZ
+		/// Žʂ́A̌Ăяo̊ԂGlobalMatrices()֏
+		void Evaluate(const float *translations, const float *rotations, bool after_physics);
+
+		/// ̃f̃{[oguna::ThreadPool::Shared()ŕɌvZ
+		/// translations[i]rotations[i]hierarchies[i]->Evaluateɓn
+		static void EvaluateBatch(PmxBoneHierarchy *const *hierarchies, const float *const *translations, const float *const *rotations, int count);
+
+		/// p̕ό`\XLjOp̍s({[*16)outɏ
+		void ComputeSkinningMatrices(float *out) const;
+
+		/// {[Ƃ̃O[os({[*16)
+		const float* GlobalMatrices() const
+		{
+			return globals.Data();
+		}
+
+		float* GlobalMatrices()
+		{
+			return globals.Data();
+		}
+
+		/// IK̃`F[
+		const mmd::IkSolver& Ik() const
+		{
+			return ik;
+		}
+
+		/// `F[ƂIK̗LE(`F[Alׂ͂ėL)
+		/// VMDIKt[Ik().ApplyIkFrameŔf
+		bool* IkEnabled()
+		{
+			return ik_enabled.get();
+		}
+
+		/// t^IKKp[J̉]({[*4)
+		const float* LocalRotations() const
+		{
+			return local_rotations.data();
+		}
+
+		/// t^Kp[J̈ړ({[*3)
+		const float* LocalTranslations() const
+		{
+			return local_translations.data();
+		}
+
+		int BoneCount() const
+		{
+			return bone_count;
+		}
+
+		/// O̒i̐
+		int StageCount(bool after_physics) const
+		{
+			int count = 0;
+			for (int s = phase_segments[after_physics ? 1 : 0]; s < phase_segments[after_physics ? 2 : 1]; s++)
+			{
+				count += segments[s].stage_end - segments[s].stage_begin;
+			}
+			return count;
+		}
+
+	private:
+		/// IK{[ŋ؂т̈ꕔ
+		struct Segment
+		{
+			/// i͈̔(stage_offsets̈ʒu)
+			int stage_begin;
+			int stage_end;
+			/// granted_bones͈̔
+			int granted_begin;
+			int granted_end;
+			/// ŌɉIK̃`F[(Ȃ-1)
+			int chain;
+			/// IǨŌvZ{[(refresh_bones͈̔)
+			int refresh_begin;
+			int refresh_end;
+		};
+
+		int bone_count;
+		/// {[̏ʒu({[*3)
+		std::vector<float> positions;
+		/// ȅʒu̍({[*3)
+		std::vector<float> offsets;
+		/// e{[(Ȃ-1)
+		std::vector<int> parents;
+		std::vector<uint16_t> flags;
+		std::vector<int> grant_parents;
+		std::vector<float> grant_weights;
+
+		/// iƂ̃{[(i̒SIMD̔̕{ŁA]-1)
+		oguna::AlignedArray<int> stage_bones;
+		/// stage_bonesƓт̐ẽO[os̃ItZbg(e*16)
+		oguna::AlignedArray<int> parent_offsets;
+		/// stage_bonesƓт̃[J̉](x, y, z, w)ƁAȅʒu̍𑫂ړ(x, y, z)
+		oguna::AlignedArray<float> stage_locals[7];
+		/// {[Ƃstage_bones̈ʒu
+		std::vector<int> slots;
+		/// iƂstage_bones͈̔(i+1)
+		std::vector<int> stage_offsets;
+		/// t^̂{[(؂育Ƃɕя)
+		std::vector<int> granted_bones;
+		/// granted_bonesƓтŁAt^eяŌɂvZO̒lǂނȂ1
+		std::vector<uint8_t> grants_previous;
+		/// grants_previous1̃{[̕t^ěvZỎ](x, y, z, w)ƈړ(x, y, z)(granted_bonesƓ*7)
+		std::vector<float> previous_grants;
+		std::vector<Segment> segments;
+		/// Oƕ̋؂͈̔(segments̈ʒu)
+		int phase_segments[3];
+		/// IǨŌvZ{[(؂育Ƃɐe)
+		std::vector<int> refresh_bones;
+		mmd::IkSolver ik;
+		std::unique_ptr<bool []> ik_enabled;
+
+		std::vector<float> local_rotations;
+		std::vector<float> local_translations;
+		/// {[+1(Ō͐êȂ{[p̒Pʍs)̃O[os
+		oguna::AlignedArray<float> globals;
+
+		/// {[Ƃ̔zmۂ
+		void Allocate(int count);
+		/// positions, parents, flags, grant_parents, grant_weightsikݒ肵ŁAяƒi߂
+		void Build(const std::vector<int> &levels);
+		void PrepareLocals(const Segment &segment, const float *translations, const float *rotations);
+		void EvaluateStage(int stage);
+	};
+}
\ No newline at end of file
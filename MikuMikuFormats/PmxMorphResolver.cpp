@@ -0,0 +1,274 @@
+#include "PmxMorphResolver.h"
+#include <algorithm>
+#include <string.h>
+
+namespace pmx
+{
+	namespace
+	{
+		typedef std::vector<std::pair<int, float>> TermList;
+
+		/// [tWJ(WJς݂̌ʂ͎g)
+		class MorphFlattener
+		{
+		public:
+			MorphFlattener(const PmxModel &model)
+				: model(model)
+				, states(model.morph_count, Unvisited)
+				, terms(model.morph_count)
+			{}
+
+			/// [tmorphWJ(q[ĂX^bNg؂Ȃ悤AċAɋA肪łǂ)
+			const TermList& Flatten(int morph)
+			{
+				if (states[morph] == Visited)
+				{
+					return terms[morph];
+				}
+				states[morph] = Visiting;
+				stack.push_back(std::make_pair(morph, 0));
+				while (!stack.empty())
+				{
+					int current = stack.back().first;
+					int next = stack.back().second;
+					const PmxMorph &source = model.morphs[current];
+					if (next < ChildCount(source))
+					{
+						// qς݁AWJIĂeɖ߂
+						stack.back().second++;
+						int child = Child(source, next);
+						if (!IsValid(child) || states[child] == Visited)
+						{
+							continue;
+						}
+						if (states[child] == Visiting)
+						{
+							stack.clear();
+							throw "cyclic morph reference";
+						}
+						states[child] = Visiting;
+						stack.push_back(std::make_pair(child, 0));
+						continue;
+					}
+					TermList result;
+					if (source.morph_type == MorphType::Group)
+					{
+						for (int i = 0; i < source.offset_count; i++)
+						{
+							const PmxMorphGroupOffset &offset = source.group_offsets[i];
+							if (!IsValid(offset.morph_index))
+							{
+								continue;
+							}
+							for (auto &term : terms[offset.morph_index])
+							{
+								result.push_back(std::make_pair(term.first, term.second * offset.morph_weight));
+							}
+						}
+						Merge(&result);
+					}
+					else
+					{
+						// tbv[t̓Kp͎sɌ܂̂ŁAz̊mFƓWJĖ[Ɠc
+						result.push_back(std::make_pair(current, 1.0f));
+					}
+					states[current] = Visited;
+					terms[current].swap(result);
+					stack.pop_back();
+				}
+				return terms[morph];
+			}
+
+			bool IsValid(int morph) const
+			{
+				return morph >= 0 && morph < model.morph_count;
+			}
+
+		private:
+			enum State
+			{
+				Unvisited,
+				Visiting,
+				Visited,
+			};
+
+			const PmxModel &model;
+			std::vector<State> states;
+			std::vector<TermList> terms;
+			/// WJ([t, ɒׂItZbg)
+			std::vector<std::pair<int, int>> stack;
+
+			/// WJɂǂq[t̐(O[v[tƃtbv[t̃ItZbg)
+			static int ChildCount(const PmxMorph &morph)
+			{
+				return (morph.morph_type == MorphType::Group || morph.morph_type == MorphType::Flip) ? morph.offset_count : 0;
+			}
+
+			static int Child(const PmxMorph &morph, int index)
+			{
+				return morph.morph_type == MorphType::Group ? morph.group_offsets[index].morph_index : morph.flip_offsets[index].morph_index;
+			}
+
+			/// Ώۂ̍܂Ƃ߂
+			static void Merge(TermList *list)
+			{
+				std::sort(list->begin(), list->end(), [](const std::pair<int, float> &a, const std::pair<int, float> &b)
+				{
+					return a.first < b.first;
+				});
+				size_t count = 0;
+				for (size_t i = 0; i < list->size(); i++)
+				{
+					if (count > 0 && (*list)[count - 1].first == (*list)[i].first)
+					{
+						(*list)[count - 1].second += (*list)[i].second;
+					}
+					else
+					{
+						(*list)[count++] = (*list)[i];
+					}
+				}
+				list->resize(count);
+			}
+		};
+	}
+
+	void PmxMorphResolver::Setup(const PmxModel &model)
+	{
+		MorphFlattener flattener(model);
+		term_offsets.assign(1, 0);
+		term_targets.clear();
+		term_multipliers.clear();
+		for (int i = 0; i < model.morph_count; i++)
+		{
+			for (auto &term : flattener.Flatten(i))
+			{
+				term_targets.push_back(term.first);
+				term_multipliers.push_back(term.second);
+			}
+			term_offsets.push_back((int) term_targets.size());
+		}
+
+		// tbv[t̓KpɊ܂܂tbv[tɂȂ悤ɕׂ
+		// KpWJɌtbv[tqƂAqׂĕ׏IĂeׂA肪tɂ
+		std::vector<std::vector<int>> children(model.morph_count);
+		for (int i = 0; i < model.morph_count; i++)
+		{
+			const PmxMorph &morph = model.morphs[i];
+			if (morph.morph_type != MorphType::Flip)
+			{
+				continue;
+			}
+			for (int offset = 0; offset < morph.offset_count; offset++)
+			{
+				int target = morph.flip_offsets[offset].morph_index;
+				if (!flattener.IsValid(target))
+				{
+					continue;
+				}
+				for (int k = term_offsets[target]; k < term_offsets[target + 1]; k++)
+				{
+					if (model.morphs[term_targets[k]].morph_type == MorphType::Flip)
+					{
+						children[i].push_back(term_targets[k]);
+					}
+				}
+			}
+		}
+		flips.clear();
+		enum { White, Gray, Black };
+		std::vector<char> colors(model.morph_count, White);
+		std::vector<std::pair<int, int>> stack;
+		for (int i = 0; i < model.morph_count; i++)
+		{
+			if (model.morphs[i].morph_type != MorphType::Flip || colors[i] != White)
+			{
+				continue;
+			}
+			// (tbv[t, ɒׂq)ς݁Aq͈ς
+			colors[i] = Gray;
+			stack.push_back(std::make_pair(i, 0));
+			while (!stack.empty())
+			{
+				int flip = stack.back().first;
+				int next = stack.back().second;
+				if (next >= (int) children[flip].size())
+				{
+					colors[flip] = Black;
+					flips.push_back(flip);
+					stack.pop_back();
+					continue;
+				}
+				stack.back().second++;
+				int child = children[flip][next];
+				if (colors[child] == Gray)
+				{
+					throw "cyclic morph reference";
+				}
+				if (colors[child] == White)
+				{
+					colors[child] = Gray;
+					stack.push_back(std::make_pair(child, 0));
+				}
+			}
+		}
+		std::reverse(flips.begin(), flips.end());
+
+		flip_offsets.assign(1, 0);
+		flip_targets.clear();
+		flip_values.clear();
+		for (int flip : flips)
+		{
+			const PmxMorph &morph = model.morphs[flip];
+			for (int i = 0; i < morph.offset_count; i++)
+			{
+				flip_targets.push_back(flattener.IsValid(morph.flip_offsets[i].morph_index) ? morph.flip_offsets[i].morph_index : -1);
+				flip_values.push_back(morph.flip_offsets[i].morph_value);
+			}
+			flip_offsets.push_back((int) flip_targets.size());
+		}
+	}
+
+	void PmxMorphResolver::Resolve(const float *weights, float *leaf_weights) const
+	{
+		int morph_count = MorphCount();
+		memset(leaf_weights, 0, sizeof(float) * morph_count);
+		for (int i = 0; i < morph_count; i++)
+		{
+			float weight = weights[i];
+			if (weight == 0.0f)
+			{
+				continue;
+			}
+			for (int k = term_offsets[i]; k < term_offsets[i + 1]; k++)
+			{
+				leaf_weights[term_targets[k]] += weight * term_multipliers[k];
+			}
+		}
+
+		// tbv[tɏW܂d݂œKpI(Kp̃tbv[t͂̌ɏ)
+		for (size_t f = 0; f < flips.size(); f++)
+		{
+			int flip = flips[f];
+			float weight = leaf_weights[flip];
+			leaf_weights[flip] = 0.0f;
+			int begin = flip_offsets[f];
+			int count = flip_offsets[f + 1] - begin;
+			if (weight <= 0.0f || count == 0)
+			{
+				continue;
+			}
+			int selected = std::min((int) (weight * count), count - 1);
+			int target = flip_targets[begin + selected];
+			if (target < 0)
+			{
+				continue;
+			}
+			float value = flip_values[begin + selected];
+			for (int k = term_offsets[target]; k < term_offsets[target + 1]; k++)
+			{
+				leaf_weights[term_targets[k]] += value * term_multipliers[k];
+			}
+		}
+	}
+}
\ No newline at end of file
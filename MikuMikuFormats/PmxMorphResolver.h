@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include "Pmx.h"
+
+namespace pmx
+{
+	/// O[v[tƃtbv[tWJāA[̃[t(_E{[EUVEގECpX)̏d݂߂
+	///
+	/// Setupœq̃O[v[tǂA[tƂ([̃[t, {)̈ꗗ֕ɂĂ
+	/// tbv[t͏d݂ɂēKp悪ς̂Ŗ[ƓꗗɎcAResolveŃtbvm̈ˑɈx
+	/// tbv[t͏d݂0傫ƂAd * ItZbg̈ʒuɂ̃ItZbgÃItZbg̒lœKp
+	/// t[̌vZ͈ꗗȂ߂邾ŁAċAmۂȂ
+	class PmxMorphResolver
+	{
+	public:
+		/// [t̎QƂWJ(zQƂΗO𓊂)
+		void Setup(const PmxModel &model);
+
+		/// [tCfbNX̏dweightsA[̃[t̏d݂leaf_weights([t)ɋ߂
+		/// O[v[tƃtbv[tleaf_weights0ɂȂ
+		void Resolve(const float *weights, float *leaf_weights) const;
+
+		/// [t
+		int MorphCount() const
+		{
+			return (int) term_offsets.size() - 1;
+		}
+
+		/// [tmorphWJ̐
+		int TermCount(int morph) const
+		{
+			return term_offsets[morph + 1] - term_offsets[morph];
+		}
+
+		/// [tmorphWJ̑Ώ([̃[ttbv[t)
+		const int* TermTargets(int morph) const
+		{
+			return &term_targets[term_offsets[morph]];
+		}
+
+		/// [tmorphWJ̔{
+		const float* TermMultipliers(int morph) const
+		{
+			return &term_multipliers[term_offsets[morph]];
+		}
+
+	private:
+		/// [tƂ͈̍̔([t+1)
+		std::vector<int> term_offsets;
+		std::vector<int> term_targets;
+		std::vector<float> term_multipliers;
+
+		/// e珇ɕׂtbv[t
+		std::vector<int> flips;
+		/// tbv[tƂ̃ItZbg͈̔(flipsƓAtbv+1)
+		std::vector<int> flip_offsets;
+		std::vector<int> flip_targets;
+		std::vector<float> flip_values;
+	};
+}
\ No newline at end of file
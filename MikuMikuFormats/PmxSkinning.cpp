@@ -0,0 +1,448 @@
+#include "PmxSkinning.h"
+#include <algorithm>
+#include "MathHelper.h"
+#include "SimdHelper.h"
+#include "ThreadPool.h"
+
+namespace pmx
+{
+	typedef oguna::FloatLanes Lanes;
+
+	/// XLjO^CvƂɎg{[̐
+	static int WeightCount(PmxVertexSkinningType type)
+	{
+		switch (type)
+		{
+		case PmxVertexSkinningType::BDEF1:
+			return 1;
+		case PmxVertexSkinningType::BDEF2:
+		case PmxVertexSkinningType::SDEF:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	/// [̒l̒_̈ʒu֏(]̃[͏܂Ȃ)
+	static void StoreVertices(const int *vertices, Lanes x, Lanes y, Lanes z, float *out)
+	{
+		float lanes[3][Lanes::Width];
+		x.Store(lanes[0]);
+		y.Store(lanes[1]);
+		z.Store(lanes[2]);
+		for (int lane = 0; lane < Lanes::Width; lane++)
+		{
+			int vertex = vertices[lane];
+			if (vertex >= 0)
+			{
+				float *p = out + vertex * 3;
+				p[0] = lanes[0][lane];
+				p[1] = lanes[1][lane];
+				p[2] = lanes[2][lane];
+			}
+		}
+	}
+
+	static void Normalize(Lanes *x, Lanes *y, Lanes *z)
+	{
+		Lanes length = Sqrt(Max(*x * *x + *y * *y + *z * *z, Lanes::Set(1e-20f)));
+		Lanes inv = Lanes::Set(1.0f) / length;
+		*x = *x * inv;
+		*y = *y * inv;
+		*z = *z * inv;
+	}
+
+	/// oPbgiԖڂ̒_̏ʒuɍ𑫂ēǂݍ
+	static void LoadPositions(const oguna::AlignedArray<float> *positions, const int *vertex_offsets, int i, const float *position_offsets, Lanes *out)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			out[c] = Lanes::Load(positions[c].Data() + i);
+			if (position_offsets)
+			{
+				out[c] = out[c] + Lanes::Gather(position_offsets + c, vertex_offsets + i);
+			}
+		}
+	}
+
+	/// lq(x, y, z, w)ŃxNg]
+	static void Rotate(const Lanes *q, Lanes x, Lanes y, Lanes z, Lanes *out)
+	{
+		// t = 2(u ~ v), v' = v + w t + u ~ t
+		Lanes two = Lanes::Set(2.0f);
+		Lanes tx = two * (q[1] * z - q[2] * y);
+		Lanes ty = two * (q[2] * x - q[0] * z);
+		Lanes tz = two * (q[0] * y - q[1] * x);
+		out[0] = x + q[3] * tx + (q[1] * tz - q[2] * ty);
+		out[1] = y + q[3] * ty + (q[2] * tx - q[0] * tz);
+		out[2] = z + q[3] * tz + (q[0] * ty - q[1] * tx);
+	}
+
+	void PmxSkinning::Setup(const PmxModel &model)
+	{
+		if (!model.IsSectionLoaded(PmxSection::Vertex))
+		{
+			throw "vertex section is not loaded";
+		}
+		vertex_count = model.vertex_count;
+		bone_count = model.bone_count;
+
+		// XLjO͋l߂`ň
+		PmxPackedSkinning packed_copy;
+		const PmxPackedSkinning *packed = &model.packed_skinning;
+		if ((int) packed->types.size() != vertex_count)
+		{
+			packed_copy.Pack(model.vertices.get(), vertex_count);
+			packed = &packed_copy;
+		}
+		if (model.vertices)
+		{
+			Build(*packed, [&model](int i) { return model.vertices[i].positon; }, [&model](int i) { return model.vertices[i].normal; });
+		}
+		else
+		{
+			Build(*packed, [&model](int i) { return &model.vertex_columns.positions[i * 3]; }, [&model](int i) { return &model.vertex_columns.normals[i * 3]; });
+		}
+	}
+
+	void PmxSkinning::Setup(const mmd::RuntimeModel &model)
+	{
+		vertex_count = model.vertex_count;
+		bone_count = model.BoneCount();
+		Build(model.skinning, [&model](int i) { return &model.positions[i * 3]; }, [&model](int i) { return &model.normals[i * 3]; });
+	}
+
+	template<typename Position, typename Normal>
+	void PmxSkinning::Build(const PmxPackedSkinning &packed_skinning, Position position_of, Normal normal_of)
+	{
+		const int width = Lanes::Width;
+		const PmxPackedSkinning *packed = &packed_skinning;
+
+		// Ō̃{[͔͈͊ÕCfbNXp̒Pʍs
+		bones.Resize((bone_count + 1) * BoneStride);
+		float *identity = &bones[bone_count * BoneStride];
+		identity[0] = identity[4] = identity[8] = 1.0f;
+		identity[RotationOffset + 3] = 1.0f;
+
+		std::vector<int> sdef_index(vertex_count, -1);
+		for (size_t i = 0; i < packed->sdef.size(); i++)
+		{
+			sdef_index[packed->sdef[i].vertex_index] = (int) i;
+		}
+
+		int counts[5] = { 0, 0, 0, 0, 0 };
+		for (int i = 0; i < vertex_count; i++)
+		{
+			counts[(int) packed->types[i]]++;
+		}
+		for (int type = 0; type < 5; type++)
+		{
+			Bucket &bucket = buckets[type];
+			bucket.count = counts[type];
+			bucket.padded_count = (counts[type] + width - 1) / width * width;
+			int size = bucket.padded_count;
+			bucket.vertices.Resize(size);
+			bucket.vertex_offsets.Resize(size);
+			for (int k = 0; k < 4; k++)
+			{
+				bucket.bones[k].Resize(k < WeightCount((PmxVertexSkinningType) type) ? size : 0);
+				bucket.weights[k].Resize(k < WeightCount((PmxVertexSkinningType) type) ? size : 0);
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				bucket.positions[c].Resize(size);
+				bucket.normals[c].Resize(size);
+			}
+			for (int c = 0; c < 9; c++)
+			{
+				bucket.sdef[c].Resize(type == (int) PmxVertexSkinningType::SDEF ? size : 0);
+			}
+			// ]͒Pʍs̃{[ŕό`ď܂Ȃ
+			for (int i = bucket.count; i < size; i++)
+			{
+				bucket.vertices[i] = -1;
+				for (int k = 0; k < WeightCount((PmxVertexSkinningType) type); k++)
+				{
+					bucket.bones[k][i] = bone_count * BoneStride;
+					bucket.weights[k][i] = k == 0 ? 1.0f : 0.0f;
+				}
+			}
+			counts[type] = 0;
+		}
+
+		for (int i = 0; i < vertex_count; i++)
+		{
+			int type = (int) packed->types[i];
+			Bucket &bucket = buckets[type];
+			int slot = counts[type]++;
+			bucket.vertices[slot] = i;
+			bucket.vertex_offsets[slot] = i * 3;
+			const float *position = position_of(i);
+			const float *normal = normal_of(i);
+			for (int c = 0; c < 3; c++)
+			{
+				bucket.positions[c][slot] = position[c];
+				bucket.normals[c][slot] = normal[c];
+			}
+			const int *index = &packed->bone_indices[i * 4];
+			const float *weight = &packed->bone_weights[i * 4];
+			for (int k = 0; k < WeightCount((PmxVertexSkinningType) type); k++)
+			{
+				int bone = (index[k] >= 0 && index[k] < bone_count) ? index[k] : bone_count;
+				bucket.bones[k][slot] = bone * BoneStride;
+				bucket.weights[k][slot] = weight[k];
+			}
+			if (type == (int) PmxVertexSkinningType::SDEF && sdef_index[i] >= 0)
+			{
+				// R0, R1EFCgŕ␳ACR0', R1'̒_߂Ă
+				const PmxSdefParameter &parameter = packed->sdef[sdef_index[i]];
+				for (int c = 0; c < 3; c++)
+				{
+					float rw = parameter.sdef_r0[c] * weight[0] + parameter.sdef_r1[c] * weight[1];
+					float r0 = parameter.sdef_c[c] + parameter.sdef_r0[c] - rw;
+					float r1 = parameter.sdef_c[c] + parameter.sdef_r1[c] - rw;
+					bucket.sdef[c][slot] = parameter.sdef_c[c];
+					bucket.sdef[3 + c][slot] = (parameter.sdef_c[c] + r0) * 0.5f;
+					bucket.sdef[6 + c][slot] = (parameter.sdef_c[c] + r1) * 0.5f;
+				}
+			}
+		}
+
+		tasks.clear();
+		for (int type = 0; type < 5; type++)
+		{
+			for (int begin = 0; begin < buckets[type].padded_count; begin += BlockSize)
+			{
+				Task task;
+				task.type = type;
+				task.begin = begin;
+				task.end = std::min(begin + BlockSize, buckets[type].padded_count);
+				tasks.push_back(task);
+			}
+		}
+	}
+
+	void PmxSkinning::PrepareBones(const float *bone_matrices)
+	{
+		for (int i = 0; i < bone_count; i++)
+		{
+			const float *m = bone_matrices + i * 16;
+			float *bone = &bones[i * BoneStride];
+			for (int row = 0; row < 4; row++)
+			{
+				bone[row * 3] = m[row * 4];
+				bone[row * 3 + 1] = m[row * 4 + 1];
+				bone[row * 3 + 2] = m[row * 4 + 2];
+			}
+			float *q = bone + RotationOffset;
+			oguna::QuaternionFromMatrix(m, q);
+			oguna::QuaternionNormalize(q);
+			// oΕ(sړ, 0) * q / 2
+			float tx = m[12], ty = m[13], tz = m[14];
+			float *dual = bone + DualOffset;
+			dual[0] = 0.5f * (tx * q[3] + ty * q[2] - tz * q[1]);
+			dual[1] = 0.5f * (-tx * q[2] + ty * q[3] + tz * q[0]);
+			dual[2] = 0.5f * (tx * q[1] - ty * q[0] + tz * q[3]);
+			dual[3] = -0.5f * (tx * q[0] + ty * q[1] + tz * q[2]);
+		}
+	}
+
+	void PmxSkinning::Skin(const float *bone_matrices, const float *position_offsets, float *positions, float *normals, bool parallel)
+	{
+		PrepareBones(bone_matrices);
+		auto run = [this, position_offsets, positions, normals](int index)
+		{
+			const Task &task = tasks[index];
+			const Bucket &bucket = buckets[task.type];
+			switch ((PmxVertexSkinningType) task.type)
+			{
+			case PmxVertexSkinningType::BDEF1:
+				SkinLinear<1>(bucket, task.begin, task.end, position_offsets, positions, normals);
+				break;
+			case PmxVertexSkinningType::BDEF2:
+				SkinLinear<2>(bucket, task.begin, task.end, position_offsets, positions, normals);
+				break;
+			case PmxVertexSkinningType::BDEF4:
+				SkinLinear<4>(bucket, task.begin, task.end, position_offsets, positions, normals);
+				break;
+			case PmxVertexSkinningType::SDEF:
+				SkinSdef(bucket, task.begin, task.end, position_offsets, positions, normals);
+				break;
+			case PmxVertexSkinningType::QDEF:
+				SkinQdef(bucket, task.begin, task.end, position_offsets, positions, normals);
+				break;
+			}
+		};
+		if (parallel && tasks.size() > 1)
+		{
+			oguna::ThreadPool::Shared().Run((int) tasks.size(), run);
+		}
+		else
+		{
+			for (int i = 0; i < (int) tasks.size(); i++)
+			{
+				run(i);
+			}
+		}
+	}
+
+	/// EFCgōsŕό`(BDEF1, BDEF2, BDEF4)
+	template<int Count>
+	void PmxSkinning::SkinLinear(const Bucket &bucket, int begin, int end, const float *position_offsets, float *positions, float *normals) const
+	{
+		const float *bone_data = bones.Data();
+		for (int i = begin; i < end; i += Lanes::Width)
+		{
+			Lanes m[12];
+			for (int k = 0; k < Count; k++)
+			{
+				const int *offsets = &bucket.bones[k][i];
+				Lanes weight = Lanes::Load(&bucket.weights[k][i]);
+				for (int j = 0; j < 12; j++)
+				{
+					Lanes element = Lanes::Gather(bone_data + j, offsets);
+					m[j] = k == 0 ? element * weight : m[j] + element * weight;
+				}
+			}
+			Lanes p[3];
+			LoadPositions(bucket.positions, bucket.vertex_offsets.Data(), i, position_offsets, p);
+			StoreVertices(&bucket.vertices[i],
+				p[0] * m[0] + p[1] * m[3] + p[2] * m[6] + m[9],
+				p[0] * m[1] + p[1] * m[4] + p[2] * m[7] + m[10],
+				p[0] * m[2] + p[1] * m[5] + p[2] * m[8] + m[11],
+				positions);
+			if (normals)
+			{
+				Lanes x = Lanes::Load(&bucket.normals[0][i]);
+				Lanes y = Lanes::Load(&bucket.normals[1][i]);
+				Lanes z = Lanes::Load(&bucket.normals[2][i]);
+				Lanes nx = x * m[0] + y * m[3] + z * m[6];
+				Lanes ny = x * m[1] + y * m[4] + z * m[7];
+				Lanes nz = x * m[2] + y * m[5] + z * m[8];
+				Normalize(&nx, &ny, &nz);
+				StoreVertices(&bucket.vertices[i], nx, ny, nz, normals);
+			}
+		}
+	}
+
+	/// {̃{[̉]ʐ`Ԃ]C̎񂵁A_ꂼ̃{[œ
+	void PmxSkinning::SkinSdef(const Bucket &bucket, int begin, int end, const float *position_offsets, float *positions, float *normals) const
+	{
+		const float *bone_data = bones.Data();
+		for (int i = begin; i < end; i += Lanes::Width)
+		{
+			const int *offsets0 = &bucket.bones[0][i];
+			const int *offsets1 = &bucket.bones[1][i];
+			Lanes w0 = Lanes::Load(&bucket.weights[0][i]);
+			Lanes w1 = Lanes::Load(&bucket.weights[1][i]);
+			Lanes q0[4], q1[4], q[4];
+			for (int c = 0; c < 4; c++)
+			{
+				q0[c] = Lanes::Gather(bone_data + RotationOffset + c, offsets0);
+				q1[c] = Lanes::Gather(bone_data + RotationOffset + c, offsets1);
+			}
+			Lanes weight_a, weight_b;
+			oguna::SlerpWeights(q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3], w1, &weight_a, &weight_b);
+			for (int c = 0; c < 4; c++)
+			{
+				q[c] = q0[c] * weight_a + q1[c] * weight_b;
+			}
+
+			Lanes c[3], cr0[3], cr1[3];
+			for (int k = 0; k < 3; k++)
+			{
+				c[k] = Lanes::Load(&bucket.sdef[k][i]);
+				cr0[k] = Lanes::Load(&bucket.sdef[3 + k][i]);
+				cr1[k] = Lanes::Load(&bucket.sdef[6 + k][i]);
+			}
+			Lanes position[3], rotated[3];
+			LoadPositions(bucket.positions, bucket.vertex_offsets.Data(), i, position_offsets, position);
+			Rotate(q, position[0] - c[0], position[1] - c[1], position[2] - c[2], rotated);
+			Lanes m0[12], m1[12];
+			for (int j = 0; j < 12; j++)
+			{
+				m0[j] = Lanes::Gather(bone_data + j, offsets0);
+				m1[j] = Lanes::Gather(bone_data + j, offsets1);
+			}
+			Lanes p[3];
+			for (int k = 0; k < 3; k++)
+			{
+				Lanes t0 = cr0[0] * m0[k] + cr0[1] * m0[3 + k] + cr0[2] * m0[6 + k] + m0[9 + k];
+				Lanes t1 = cr1[0] * m1[k] + cr1[1] * m1[3 + k] + cr1[2] * m1[6 + k] + m1[9 + k];
+				p[k] = rotated[k] + t0 * w0 + t1 * w1;
+			}
+			StoreVertices(&bucket.vertices[i], p[0], p[1], p[2], positions);
+			if (normals)
+			{
+				Lanes n[3];
+				Rotate(q, Lanes::Load(&bucket.normals[0][i]), Lanes::Load(&bucket.normals[1][i]), Lanes::Load(&bucket.normals[2][i]), n);
+				Normalize(&n[0], &n[1], &n[2]);
+				StoreVertices(&bucket.vertices[i], n[0], n[1], n[2], normals);
+			}
+		}
+	}
+
+	/// {[̑oΎlEFCgōĕό`
+	void PmxSkinning::SkinQdef(const Bucket &bucket, int begin, int end, const float *position_offsets, float *positions, float *normals) const
+	{
+		const float *bone_data = bones.Data();
+		for (int i = begin; i < end; i += Lanes::Width)
+		{
+			Lanes real[4], dual[4], first[4];
+			for (int k = 0; k < 4; k++)
+			{
+				const int *offsets = &bucket.bones[k][i];
+				Lanes weight = Lanes::Load(&bucket.weights[k][i]);
+				Lanes r[4], d[4];
+				for (int c = 0; c < 4; c++)
+				{
+					r[c] = Lanes::Gather(bone_data + RotationOffset + c, offsets);
+					d[c] = Lanes::Gather(bone_data + DualOffset + c, offsets);
+				}
+				if (k == 0)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						first[c] = r[c];
+						real[c] = r[c] * weight;
+						dual[c] = d[c] * weight;
+					}
+				}
+				else
+				{
+					// ŏ̃{[Ɠ̔ɂ낦č
+					weight = MultiplySign(weight, first[0] * r[0] + first[1] * r[1] + first[2] * r[2] + first[3] * r[3]);
+					for (int c = 0; c < 4; c++)
+					{
+						real[c] = real[c] + r[c] * weight;
+						dual[c] = dual[c] + d[c] * weight;
+					}
+				}
+			}
+			Lanes length = Sqrt(Max(real[0] * real[0] + real[1] * real[1] + real[2] * real[2] + real[3] * real[3], Lanes::Set(1e-20f)));
+			Lanes inv = Lanes::Set(1.0f) / length;
+			for (int c = 0; c < 4; c++)
+			{
+				real[c] = real[c] * inv;
+				dual[c] = dual[c] * inv;
+			}
+
+			Lanes position[3], rotated[3];
+			LoadPositions(bucket.positions, bucket.vertex_offsets.Data(), i, position_offsets, position);
+			Rotate(real, position[0], position[1], position[2], rotated);
+			// sړ 2(w_r v_d - w_d v_r + v_r ~ v_d)
+			Lanes two = Lanes::Set(2.0f);
+			Lanes px = rotated[0] + two * (real[3] * dual[0] - dual[3] * real[0] + real[1] * dual[2] - real[2] * dual[1]);
+			Lanes py = rotated[1] + two * (real[3] * dual[1] - dual[3] * real[1] + real[2] * dual[0] - real[0] * dual[2]);
+			Lanes pz = rotated[2] + two * (real[3] * dual[2] - dual[3] * real[2] + real[0] * dual[1] - real[1] * dual[0]);
+			StoreVertices(&bucket.vertices[i], px, py, pz, positions);
+			if (normals)
+			{
+				Lanes n[3];
+				Rotate(real, Lanes::Load(&bucket.normals[0][i]), Lanes::Load(&bucket.normals[1][i]), Lanes::Load(&bucket.normals[2][i]), n);
+				Normalize(&n[0], &n[1], &n[2]);
+				StoreVertices(&bucket.vertices[i], n[0], n[1], n[2], normals);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include "Pmx.h"
+#include "AlignedArray.h"
+#include "RuntimeModel.h"
+
+namespace pmx
+{
+	/// CPUŒ_XLjO
+	///
+	/// SetupŒ_XLjO^CvƂɕA^CvƂɈʒuE@E{[EEFCgɕגĂ
+	/// Skinł̓^CvƂɕ̂ȂSIMD̃J[lł܂Ƃ߂ĕό`A_̂܂Ƃ܂育ƂɕXbhŏ
+	/// {[s͍sxNgɉE|4x4s(DirectX`Asړ12`14)ŁAp̕ό`\̂Ƃ
+	/// SDEFQDEF̓{[s̉]lƂĎĝŁAs͊gk܂܂Ȃ̂Ƃ
+	/// ͈͊O(-1Ȃ)̃{[CfbNX͕ό`Ȃ{[ƂĈ
+	class PmxSkinning
+	{
+	public:
+		PmxSkinning()
+			: vertex_count(0)
+			, bone_count(0)
+		{}
+
+		/// f̒_(PmxModel::verticesvertex_columnŝǂœǂݍ񂾃fł悢)
+		void Setup(const PmxModel &model);
+
+		/// RuntimeModel̒_
+		void Setup(const mmd::RuntimeModel &model);
+
+		/// bone_matrices({[*16)ŕό`ʒuƖ@Apositionsnormals(_*3)ɏ
+		/// normalsnullptrȂ@͋߂Ȃ
+		/// parallelȂoguna::ThreadPool::Shared()Œ_̂܂Ƃ܂ɏ
+		void Skin(const float *bone_matrices, float *positions, float *normals, bool parallel = true)
+		{
+			Skin(bone_matrices, nullptr, positions, normals, parallel);
+		}
+
+		/// ʒuposition_offsets(_*3A_[t̍Ȃ)𑫂Ăό`
+		void Skin(const float *bone_matrices, const float *position_offsets, float *positions, float *normals, bool parallel = true);
+
+		/// _
+		int VertexCount() const
+		{
+			return vertex_count;
+		}
+
+		/// XLjO^CvƂ̒_
+		int VertexCount(PmxVertexSkinningType type) const
+		{
+			return buckets[(int) type].count;
+		}
+
+	private:
+		/// xɏ钸_
+		static const int BlockSize = 2048;
+		/// {[{float(3x4sA]̎lAoΎl̑oΕ)
+		static const int BoneStride = 20;
+		static const int RotationOffset = 12;
+		static const int DualOffset = 16;
+
+		/// XLjO^Cv̒_ɕׂ(_SIMD̔̕{ɐ؂グ)
+		struct Bucket
+		{
+			Bucket()
+				: count(0)
+				, padded_count(0)
+			{}
+
+			int count;
+			int padded_count;
+			/// ̒_CfbNX(]-1)
+			oguna::AlignedArray<int> vertices;
+			/// ʒu̍W߂邽߂̃ItZbg(_CfbNX*3A]0)
+			oguna::AlignedArray<int> vertex_offsets;
+			/// {[(bones̐擪floatPʂ̃ItZbg)
+			oguna::AlignedArray<int> bones[4];
+			oguna::AlignedArray<float> weights[4];
+			oguna::AlignedArray<float> positions[3];
+			oguna::AlignedArray<float> normals[3];
+			/// SDEFCA(C + R0') / 2A(C + R1') / 2
+			oguna::AlignedArray<float> sdef[9];
+		};
+
+		/// ɏ͈
+		struct Task
+		{
+			int type;
+			int begin;
+			int end;
+		};
+
+		int vertex_count;
+		int bone_count;
+		Bucket buckets[5];
+		std::vector<Task> tasks;
+		/// {[+1{(Ō͒Pʍs)̃{[̃f[^
+		oguna::AlignedArray<float> bones;
+
+		/// position_of(i)normal_of(i)Œ_ȉʒuƖ@A^CvƂ̗ɕׂ
+		template<typename Position, typename Normal>
+		void Build(const PmxPackedSkinning &packed, Position position_of, Normal normal_of);
+		void PrepareBones(const float *bone_matrices);
+		template<int Count>
+		void SkinLinear(const Bucket &bucket, int begin, int end, const float *position_offsets, float *positions, float *normals) const;
+		void SkinSdef(const Bucket &bucket, int begin, int end, const float *position_offsets, float *positions, float *normals) const;
+		void SkinQdef(const Bucket &bucket, int begin, int end, const float *position_offsets, float *positions, float *normals) const;
+	};
+}
\ No newline at end of file
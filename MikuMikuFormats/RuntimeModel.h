@@ -0,0 +1,1172 @@
+#pragma once
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Pmx.h"
+#include "Pmd.h"
+#include "AlignedArray.h"
+#include "EncodingHelper.h"
+#include "BakedCache.h"
+#include "StringPool.h"
+
+namespace mmd
+{
+	/// O̕R[h
+	enum class NameEncoding : uint8_t
+	{
+		Utf8 = 0,
+		Cp932 = 1,
+	};
+
+	/// O̕ɋl߂Ċi[
+	/// InternŖOoguna::StringPoolɓo^ƁA\̔ԍŖOׂ
+	class NameTable
+	{
+	public:
+		NameTable()
+		{
+			offsets.push_back(0);
+		}
+
+		void Clear()
+		{
+			chars.clear();
+			offsets.assign(1, 0);
+			ids.Clear();
+		}
+
+		void Reserve(int count, size_t char_count)
+		{
+			offsets.reserve(count + 1);
+			chars.reserve(char_count);
+		}
+
+		void Add(const char *name, size_t length)
+		{
+			chars.append(name, length);
+			offsets.push_back((uint32_t) chars.size());
+		}
+
+		void Add(const std::string &name)
+		{
+			Add(name.data(), name.size());
+		}
+
+		int Count() const
+		{
+			return (int) offsets.size() - 1;
+		}
+
+		/// indexԖڂ̖O̐擪(I['\0'͂Ȃ)
+		const char* Data(int index) const
+		{
+			return chars.data() + offsets[index];
+		}
+
+		int Length(int index) const
+		{
+			return (int) (offsets[index + 1] - offsets[index]);
+		}
+
+		std::string Get(int index) const
+		{
+			return std::string(Data(index), Length(index));
+		}
+
+		/// Ovŏ̗vf(Ȃ-1)
+		int Find(const char *name, size_t length) const
+		{
+			for (int i = 0; i < Count(); i++)
+			{
+				if ((size_t) Length(i) == length && memcmp(Data(i), name, length) == 0)
+				{
+					return i;
+				}
+			}
+			return -1;
+		}
+
+		int Find(const std::string &name) const
+		{
+			return Find(name.data(), name.size());
+		}
+
+		/// ׂĂ̖Opoolɓo^Ĕԍo(ォ疼Oǉo^)
+		void Intern(oguna::StringPool *pool)
+		{
+			ids.Clear();
+			ids.Reserve(Count());
+			for (int i = 0; i < Count(); i++)
+			{
+				ids.Push(pool->Intern(Data(i), Length(i)));
+			}
+		}
+
+		/// Internœo^indexԖڂ̖O̔ԍ
+		uint32_t Id(int index) const
+		{
+			return ids.Id(index);
+		}
+
+		/// Internœo^ԍid̍ŏ̗vf(Ȃ-1)
+		int FindId(uint32_t id) const
+		{
+			return ids.Find(id);
+		}
+
+		/// LbVɐidid+1Ƃď
+		void Bake(oguna::BakedWriter *writer, uint32_t id) const
+		{
+			writer->Add(id, chars);
+			writer->Add(id + 1, offsets);
+		}
+
+		/// OƂ̐擪0n܂Č炸A̒ŏIȂfalse
+		bool LoadBaked(const oguna::BakedFile &file, uint32_t id)
+		{
+			ids.Clear();
+			if (!file.Read(id, &chars) || !file.Read(id + 1, &offsets) || offsets.empty() || offsets.front() != 0
+				|| offsets.back() != chars.size() || !std::is_sorted(offsets.begin(), offsets.end()))
+			{
+				Clear();
+				return false;
+			}
+			return true;
+		}
+
+	private:
+		std::string chars;
+		/// OƂ̐擪(O̐+1)
+		std::vector<uint32_t> offsets;
+		/// Internœo^ԍ(O̐)
+		oguna::StringIdList ids;
+	};
+
+	/// ȉ̗vf̓LbVɂ̂܂܏ނ̂ŁAlߕȂ悤ɗ\̍ڂŖ߂
+
+	/// ގ
+	struct RuntimeMaterial
+	{
+		float diffuse[4];
+		float specular[3];
+		float specularity;
+		float ambient[3];
+		float edge_color[4];
+		float edge_size;
+		/// `tO(PMXƓrbg)
+		uint8_t flag;
+		/// XtBẢZ(0: 1:Z 2:Z 3:TueNX`)
+		uint8_t sphere_mode;
+		/// toon_textureLgD[(toon01.bmp`toon10.bmp0`9)ǂ
+		uint8_t shared_toon;
+		uint8_t reserved;
+		/// eNX`(textures̃CfbNXAȂ-1)
+		int texture;
+		int sphere_texture;
+		int toon_texture;
+		/// indices͈̔
+		int index_begin;
+		int index_count;
+	};
+
+	/// {[
+	struct RuntimeBone
+	{
+		float position[3];
+		/// e{[(Ȃ-1)
+		int parent;
+		/// ό`Kw
+		int level;
+		/// {[tO(PMXƓrbg)
+		uint16_t flag;
+		uint16_t reserved;
+		/// ڑ{[(0x0001̂ƂAȂ-1)
+		int tail;
+		/// ڑ̈ʒũItZbg(0x0001łȂƂ)
+		float tail_offset[3];
+		/// t^e(0x01000x0200̂ƂAȂ-1)
+		int grant_parent;
+		float grant_weight;
+		/// Œ莲̕(0x0400̂Ƃ)
+		float fixed_axis[3];
+	};
+
+	/// IK̃`F[
+	struct RuntimeIk
+	{
+		int bone;
+		int target;
+		int loop;
+		/// ̌vZŉ񂷊px̏(WA)
+		float unit_angle;
+		/// ik_links͈̔
+		int link_begin;
+		int link_end;
+	};
+
+	/// IK̃N
+	struct RuntimeIkLink
+	{
+		int bone;
+		float min_radian[3];
+		float max_radian[3];
+		uint8_t limited;
+		uint8_t reserved[3];
+	};
+
+	/// [t
+	struct RuntimeMorph
+	{
+		pmx::MorphCategory category;
+		pmx::MorphType type;
+		uint8_t reserved[2];
+		/// typeɉItZbg̔zł͈̔
+		/// _morph_verticesAUVƒǉUVmorph_uv_verticesA{[morph_bonesAO[vƃtbvmorph_targets
+		/// ގƃCpX̃ItZbg͊i[Ȃ̂ŋɂ
+		int offset_begin;
+		int offset_end;
+	};
+
+	/// PMDPMX̂ǂ炩A^Cp̃f
+	///
+	/// vfƂ̃IuWFNg炸A_ItZbg͎ނƂ̔zɁAONameTableɂ܂Ƃ߂Ċi[
+	/// CfbNXPMXƓӖint(Ȃ-1)AtOPMXƓrbgɂ낦
+	/// O̕R[h͌̂܂(PMXUTF8ɕϊAPMDCP932)ŁAname_encodingŋʂ
+	/// ́AWCgA\gA\tg{fB͊܂߂Ȃ
+	class RuntimeModel
+	{
+	public:
+		RuntimeModel()
+			: name_encoding(NameEncoding::Utf8)
+			, vertex_count(0)
+			, additional_uv_count(0)
+		{}
+
+		NameEncoding name_encoding;
+		std::string name;
+		std::string comment;
+
+		/// _
+		int vertex_count;
+		/// ǉUV
+		int additional_uv_count;
+		/// ʒu(_*3)
+		oguna::AlignedArray<float> positions;
+		/// @(_*3)
+		oguna::AlignedArray<float> normals;
+		/// eNX`W(_*2)
+		oguna::AlignedArray<float> uvs;
+		/// ǉeNX`W(ǉUVAꂼ꒸_*4)
+		oguna::AlignedArray<float> additional_uvs[4];
+		/// GbW{(_)
+		oguna::AlignedArray<float> edges;
+		/// XLjO
+		pmx::PmxPackedSkinning skinning;
+
+		/// _CfbNX(Op`Ƃ3)
+		std::vector<uint32_t> indices;
+
+		/// eNX`̃t@C
+		NameTable textures;
+		std::vector<RuntimeMaterial> materials;
+		NameTable material_names;
+
+		std::vector<RuntimeBone> bones;
+		NameTable bone_names;
+		std::vector<RuntimeIk> iks;
+		std::vector<RuntimeIkLink> ik_links;
+
+		std::vector<RuntimeMorph> morphs;
+		NameTable morph_names;
+		/// _[t̃ItZbg(_Ƃ̈ʒu̍(*3))
+		std::vector<int> morph_vertices;
+		std::vector<float> morph_positions;
+		/// UV[t̃ItZbg(_ƂUV̍(*4))
+		std::vector<int> morph_uv_vertices;
+		std::vector<float> morph_uvs;
+		/// {[[t̃ItZbg({[Ƃ̈ړ(*3)Ɖ](*4))
+		std::vector<int> morph_bones;
+		std::vector<float> morph_translations;
+		std::vector<float> morph_rotations;
+		/// O[v[tƃtbv[t̃ItZbg([tƂ̏d)
+		std::vector<int> morph_targets;
+		std::vector<float> morph_weights;
+
+		int BoneCount() const
+		{
+			return (int) bones.size();
+		}
+
+		int MorphCount() const
+		{
+			return (int) morphs.size();
+		}
+
+		/// eNX`EގE{[E[t̖Opoolɓo^(NameTable::IdAFindIdg悤ɂȂ)
+		/// O͌̕R[ĥ܂ܓo^̂ŁAPMD̃f̖OVMD̖OƓԍɂȂ
+		void InternNames(oguna::StringPool *pool)
+		{
+			textures.Intern(pool);
+			material_names.Intern(pool);
+			bone_names.Intern(pool);
+			morph_names.Intern(pool);
+		}
+
+		/// PMXPMD̃t@Cǂݍ
+		/// cache_filenamenullptrłȂ΁Ãt@C̃nbVvLbV}bvēǂݍ݁A
+		/// ȂΌ̃t@C͂ăLbVo
+		static std::unique_ptr<RuntimeModel> LoadFromFile(const char *filename, const char *cache_filename = nullptr)
+		{
+			oguna::MappedFile file;
+			if (!file.Open(filename))
+			{
+				std::cerr << "could not open \"" << filename << "\"" << std::endl;
+				return nullptr;
+			}
+			auto result = std::make_unique<RuntimeModel>();
+			uint64_t hash = 0;
+			if (cache_filename)
+			{
+				hash = oguna::HashBytes(file.Data(), file.Size());
+				oguna::BakedFile cache;
+				if (cache.Open(cache_filename, oguna::BakedKind::Model, hash, file.Size()) && result->LoadBaked(cache))
+				{
+					return result;
+				}
+			}
+			try
+			{
+				if (file.Size() >= 4 && memcmp(file.Data(), "PMX ", 4) == 0)
+				{
+					pmx::PmxModel model;
+					model.Read(file.Data(), file.Size());
+					result->Convert(model);
+				}
+				else
+				{
+					oguna::BinaryReader reader(file.Data(), file.Size());
+					auto model = pmd::PmdModel::LoadFromReader(&reader);
+					if (!model)
+					{
+						return nullptr;
+					}
+					result->Convert(*model);
+				}
+			}
+			catch (const char *message)
+			{
+				std::cerr << message << std::endl;
+				return nullptr;
+			}
+			if (cache_filename)
+			{
+				oguna::BakedWriter writer;
+				result->Bake(&writer);
+				if (!writer.Save(cache_filename, oguna::BakedKind::Model, hash, file.Size()))
+				{
+					std::cerr << "could not write \"" << cache_filename << "\"" << std::endl;
+				}
+			}
+			return result;
+		}
+
+		/// ׂĂ̔zLbV̐߂Ƃď
+		void Bake(oguna::BakedWriter *writer) const
+		{
+			BakedCounts counts;
+			counts.name_encoding = (uint32_t) name_encoding;
+			counts.vertex_count = vertex_count;
+			counts.additional_uv_count = additional_uv_count;
+			counts.reserved = 0;
+			writer->Add(SectionCounts, &counts, 1);
+			writer->Add(SectionName, name);
+			writer->Add(SectionComment, comment);
+			writer->Add(SectionPositions, positions);
+			writer->Add(SectionNormals, normals);
+			writer->Add(SectionUvs, uvs);
+			for (int k = 0; k < 4; k++)
+			{
+				writer->Add(SectionAdditionalUvs + k, additional_uvs[k]);
+			}
+			writer->Add(SectionEdges, edges);
+			writer->Add(SectionSkinningTypes, skinning.types);
+			writer->Add(SectionSkinningIndices, skinning.bone_indices);
+			writer->Add(SectionSkinningWeights, skinning.bone_weights);
+			writer->Add(SectionSdef, skinning.sdef);
+			writer->Add(SectionIndices, indices);
+			textures.Bake(writer, SectionTextures);
+			writer->Add(SectionMaterials, materials);
+			material_names.Bake(writer, SectionMaterialNames);
+			writer->Add(SectionBones, bones);
+			bone_names.Bake(writer, SectionBoneNames);
+			writer->Add(SectionIks, iks);
+			writer->Add(SectionIkLinks, ik_links);
+			writer->Add(SectionMorphs, morphs);
+			morph_names.Bake(writer, SectionMorphNames);
+			writer->Add(SectionMorphVertices, morph_vertices);
+			writer->Add(SectionMorphPositions, morph_positions);
+			writer->Add(SectionMorphUvVertices, morph_uv_vertices);
+			writer->Add(SectionMorphUvs, morph_uvs);
+			writer->Add(SectionMorphBones, morph_bones);
+			writer->Add(SectionMorphTranslations, morph_translations);
+			writer->Add(SectionMorphRotations, morph_rotations);
+			writer->Add(SectionMorphTargets, morph_targets);
+			writer->Add(SectionMorphWeights, morph_weights);
+		}
+
+		/// LbVz܂Ƃ߂ăRs[
+		/// ߂Ă邩Az̑傫CfbNX͈̔͂Ȃ΋ɂfalseԂ
+		bool LoadBaked(const oguna::BakedFile &file)
+		{
+			size_t count;
+			const BakedCounts *counts = file.Section<BakedCounts>(SectionCounts, &count);
+			if (counts == nullptr || count != 1)
+			{
+				Clear();
+				return false;
+			}
+			name_encoding = (NameEncoding) counts->name_encoding;
+			vertex_count = counts->vertex_count;
+			additional_uv_count = counts->additional_uv_count;
+			bool loaded = file.Read(SectionName, &name)
+				&& file.Read(SectionComment, &comment)
+				&& file.Read(SectionPositions, &positions)
+				&& file.Read(SectionNormals, &normals)
+				&& file.Read(SectionUvs, &uvs)
+				&& file.Read(SectionAdditionalUvs, &additional_uvs[0])
+				&& file.Read(SectionAdditionalUvs + 1, &additional_uvs[1])
+				&& file.Read(SectionAdditionalUvs + 2, &additional_uvs[2])
+				&& file.Read(SectionAdditionalUvs + 3, &additional_uvs[3])
+				&& file.Read(SectionEdges, &edges)
+				&& file.Read(SectionSkinningTypes, &skinning.types)
+				&& file.Read(SectionSkinningIndices, &skinning.bone_indices)
+				&& file.Read(SectionSkinningWeights, &skinning.bone_weights)
+				&& file.Read(SectionSdef, &skinning.sdef)
+				&& file.Read(SectionIndices, &indices)
+				&& textures.LoadBaked(file, SectionTextures)
+				&& file.Read(SectionMaterials, &materials)
+				&& material_names.LoadBaked(file, SectionMaterialNames)
+				&& file.Read(SectionBones, &bones)
+				&& bone_names.LoadBaked(file, SectionBoneNames)
+				&& file.Read(SectionIks, &iks)
+				&& file.Read(SectionIkLinks, &ik_links)
+				&& file.Read(SectionMorphs, &morphs)
+				&& morph_names.LoadBaked(file, SectionMorphNames)
+				&& file.Read(SectionMorphVertices, &morph_vertices)
+				&& file.Read(SectionMorphPositions, &morph_positions)
+				&& file.Read(SectionMorphUvVertices, &morph_uv_vertices)
+				&& file.Read(SectionMorphUvs, &morph_uvs)
+				&& file.Read(SectionMorphBones, &morph_bones)
+				&& file.Read(SectionMorphTranslations, &morph_translations)
+				&& file.Read(SectionMorphRotations, &morph_rotations)
+				&& file.Read(SectionMorphTargets, &morph_targets)
+				&& file.Read(SectionMorphWeights, &morph_weights);
+			if (!loaded || !IsConsistent())
+			{
+				Clear();
+				return false;
+			}
+			return true;
+		}
+
+		/// PMXf(ǂݍłȂZNV̗vf͋ɂ)
+		void Convert(const pmx::PmxModel &model)
+		{
+			Clear();
+			name_encoding = NameEncoding::Utf8;
+			std::string buffer;
+			oguna::EncodingConverter::Utf16ToUtf8(model.model_name.data(), (int) model.model_name.size(), &name);
+			oguna::EncodingConverter::Utf16ToUtf8(model.model_comment.data(), (int) model.model_comment.size(), &comment);
+
+			if (model.IsSectionLoaded(pmx::PmxSection::Vertex))
+			{
+				int n = model.vertex_count;
+				AllocateVertices(n, model.setting.uv);
+				if (model.vertices)
+				{
+					for (int i = 0; i < n; i++)
+					{
+						const pmx::PmxVertex &vertex = model.vertices[i];
+						memcpy(&positions[i * 3], vertex.positon, sizeof(float) * 3);
+						memcpy(&normals[i * 3], vertex.normal, sizeof(float) * 3);
+						memcpy(&uvs[i * 2], vertex.uv, sizeof(float) * 2);
+						for (int k = 0; k < additional_uv_count; k++)
+						{
+							memcpy(&additional_uvs[k][i * 4], vertex.uva[k], sizeof(float) * 4);
+						}
+						edges[i] = vertex.edge;
+					}
+				}
+				else
+				{
+					const pmx::PmxVertexColumns &columns = model.vertex_columns;
+					memcpy(positions.Data(), columns.positions.Data(), sizeof(float) * 3 * n);
+					memcpy(normals.Data(), columns.normals.Data(), sizeof(float) * 3 * n);
+					memcpy(uvs.Data(), columns.uvs.Data(), sizeof(float) * 2 * n);
+					for (int k = 0; k < additional_uv_count; k++)
+					{
+						memcpy(additional_uvs[k].Data(), columns.additional_uvs[k].Data(), sizeof(float) * 4 * n);
+					}
+					memcpy(edges.Data(), columns.edges.Data(), sizeof(float) * n);
+				}
+				if ((int) model.packed_skinning.types.size() == n)
+				{
+					skinning = model.packed_skinning;
+				}
+				else
+				{
+					skinning.Pack(model.vertices.get(), n);
+				}
+			}
+
+			if (model.IsSectionLoaded(pmx::PmxSection::Index))
+			{
+				indices.assign(model.indices.get(), model.indices.get() + model.index_count);
+			}
+
+			if (model.IsSectionLoaded(pmx::PmxSection::Texture))
+			{
+				textures.Reserve(model.texture_count, model.texture_count * 32);
+				for (int i = 0; i < model.texture_count; i++)
+				{
+					AddName(&textures, model.textures[i], &buffer);
+				}
+			}
+
+			if (model.IsSectionLoaded(pmx::PmxSection::Material))
+			{
+				materials.resize(model.material_count);
+				material_names.Reserve(model.material_count, model.material_count * 16);
+				int index_begin = 0;
+				for (int i = 0; i < model.material_count; i++)
+				{
+					const pmx::PmxMaterial &source = model.materials[i];
+					RuntimeMaterial &material = materials[i];
+					memcpy(material.diffuse, source.diffuse, sizeof(float) * 4);
+					memcpy(material.specular, source.specular, sizeof(float) * 3);
+					material.specularity = source.specularlity;
+					memcpy(material.ambient, source.ambient, sizeof(float) * 3);
+					memcpy(material.edge_color, source.edge_color, sizeof(float) * 4);
+					material.edge_size = source.edge_size;
+					material.flag = source.flag;
+					material.sphere_mode = source.sphere_op_mode;
+					material.shared_toon = source.common_toon_flag;
+					material.texture = source.diffuse_texture_index;
+					material.sphere_texture = source.sphere_texture_index;
+					material.toon_texture = source.toon_texture_index;
+					material.index_begin = index_begin;
+					material.index_count = source.index_count;
+					index_begin += source.index_count;
+					AddName(&material_names, source.material_name, &buffer);
+				}
+			}
+
+			if (model.IsSectionLoaded(pmx::PmxSection::Bone))
+			{
+				int n = model.bone_count;
+				bones.resize(n);
+				bone_names.Reserve(n, n * 16);
+				for (int i = 0; i < n; i++)
+				{
+					const pmx::PmxBone &source = model.bones[i];
+					RuntimeBone &bone = bones[i];
+					memcpy(bone.position, source.position, sizeof(float) * 3);
+					bone.parent = ValidIndex(source.parent_index, n);
+					bone.level = source.level;
+					bone.flag = source.bone_flag;
+					bone.tail = (source.bone_flag & 0x0001) ? ValidIndex(source.target_index, n) : -1;
+					memcpy(bone.tail_offset, source.offset, sizeof(float) * 3);
+					bone.grant_parent = (source.bone_flag & (0x0100 | 0x0200)) ? ValidIndex(source.grant_parent_index, n) : -1;
+					bone.grant_weight = source.grant_weight;
+					memcpy(bone.fixed_axis, source.lock_axis_orientation, sizeof(float) * 3);
+					AddName(&bone_names, source.bone_name, &buffer);
+					if (!(source.bone_flag & 0x0020))
+					{
+						continue;
+					}
+					RuntimeIk ik;
+					ik.bone = i;
+					ik.target = source.ik_target_bone_index;
+					ik.loop = source.ik_loop;
+					ik.unit_angle = source.ik_loop_angle_limit;
+					ik.link_begin = (int) ik_links.size();
+					for (int k = 0; k < source.ik_link_count; k++)
+					{
+						const pmx::PmxIkLink &source_link = source.ik_links[k];
+						RuntimeIkLink link;
+						memset(&link, 0, sizeof(link));
+						link.bone = source_link.link_target;
+						link.limited = source_link.angle_lock;
+						memcpy(link.min_radian, source_link.min_radian, sizeof(float) * 3);
+						memcpy(link.max_radian, source_link.max_radian, sizeof(float) * 3);
+						ik_links.push_back(link);
+					}
+					ik.link_end = (int) ik_links.size();
+					iks.push_back(ik);
+				}
+			}
+
+			if (model.IsSectionLoaded(pmx::PmxSection::Morph))
+			{
+				int n = model.morph_count;
+				morphs.resize(n);
+				morph_names.Reserve(n, n * 16);
+				for (int i = 0; i < n; i++)
+				{
+					const pmx::PmxMorph &source = model.morphs[i];
+					RuntimeMorph &morph = morphs[i];
+					morph.category = source.category;
+					morph.type = source.morph_type;
+					AddName(&morph_names, source.morph_name, &buffer);
+					int count = source.offset_count;
+					switch (source.morph_type)
+					{
+					case pmx::MorphType::Vertex:
+						morph.offset_begin = (int) morph_vertices.size();
+						for (int k = 0; k < count; k++)
+						{
+							morph_vertices.push_back(source.vertex_offsets[k].vertex_index);
+							morph_positions.insert(morph_positions.end(), source.vertex_offsets[k].position_offset, source.vertex_offsets[k].position_offset + 3);
+						}
+						morph.offset_end = (int) morph_vertices.size();
+						break;
+					case pmx::MorphType::UV:
+					case pmx::MorphType::AdditionalUV1:
+					case pmx::MorphType::AdditionalUV2:
+					case pmx::MorphType::AdditionalUV3:
+					case pmx::MorphType::AdditionalUV4:
+						morph.offset_begin = (int) morph_uv_vertices.size();
+						for (int k = 0; k < count; k++)
+						{
+							morph_uv_vertices.push_back(source.uv_offsets[k].vertex_index);
+							morph_uvs.insert(morph_uvs.end(), source.uv_offsets[k].uv_offset, source.uv_offsets[k].uv_offset + 4);
+						}
+						morph.offset_end = (int) morph_uv_vertices.size();
+						break;
+					case pmx::MorphType::Bone:
+						morph.offset_begin = (int) morph_bones.size();
+						for (int k = 0; k < count; k++)
+						{
+							morph_bones.push_back(source.bone_offsets[k].bone_index);
+							morph_translations.insert(morph_translations.end(), source.bone_offsets[k].translation, source.bone_offsets[k].translation + 3);
+							morph_rotations.insert(morph_rotations.end(), source.bone_offsets[k].rotation, source.bone_offsets[k].rotation + 4);
+						}
+						morph.offset_end = (int) morph_bones.size();
+						break;
+					case pmx::MorphType::Group:
+						morph.offset_begin = (int) morph_targets.size();
+						for (int k = 0; k < count; k++)
+						{
+							morph_targets.push_back(source.group_offsets[k].morph_index);
+							morph_weights.push_back(source.group_offsets[k].morph_weight);
+						}
+						morph.offset_end = (int) morph_targets.size();
+						break;
+					case pmx::MorphType::Flip:
+						morph.offset_begin = (int) morph_targets.size();
+						for (int k = 0; k < count; k++)
+						{
+							morph_targets.push_back(source.flip_offsets[k].morph_index);
+							morph_weights.push_back(source.flip_offsets[k].morph_value);
+						}
+						morph.offset_end = (int) morph_targets.size();
+						break;
+					default:
+						morph.offset_begin = morph.offset_end = 0;
+						break;
+					}
+				}
+			}
+			ClampIndices();
+		}
+
+		/// PMDf
+		/// {[̎ނPMX̃tOɒA]e͉ẻ]t^(1.0)A]A͐ڑ悩̉]t^(IK{[ԍ̒l/100)ɂ
+		/// IK̐pxƁuЂv܂ރN̐PmdIkŋ߂
+		/// \baseɃ[tƂA_CfbNXbaseăf̒_CfbNXɒ
+		void Convert(const pmd::PmdModel &model)
+		{
+			Clear();
+			name_encoding = NameEncoding::Cp932;
+			name = model.header.name;
+			comment = model.header.comment;
+
+			int n = (int) model.vertices.size();
+			AllocateVertices(n, 0);
+			// XLjO̘gׂ͂ďނ̂ŁA[Ŗ߂Ɋmۂ
+			skinning.types.resize(n);
+			skinning.bone_indices.resize(n * 4);
+			skinning.bone_weights.resize(n * 4);
+			for (int i = 0; i < n; i++)
+			{
+				const pmd::PmdVertex &vertex = model.vertices[i];
+				memcpy(&positions[i * 3], vertex.position, sizeof(float) * 3);
+				memcpy(&normals[i * 3], vertex.normal, sizeof(float) * 3);
+				memcpy(&uvs[i * 2], vertex.uv, sizeof(float) * 2);
+				edges[i] = vertex.edge_invisible ? 0.0f : 1.0f;
+				int *index = &skinning.bone_indices[i * 4];
+				float *weight = &skinning.bone_weights[i * 4];
+				bool single = vertex.bone_weight >= 100 || vertex.bone_index[0] == vertex.bone_index[1];
+				skinning.types[i] = single ? pmx::PmxVertexSkinningType::BDEF1 : pmx::PmxVertexSkinningType::BDEF2;
+				index[0] = vertex.bone_index[0];
+				index[1] = single ? 0 : vertex.bone_index[1];
+				index[2] = index[3] = 0;
+				weight[0] = single ? 1.0f : vertex.bone_weight * 0.01f;
+				weight[1] = 1.0f - weight[0];
+				weight[2] = weight[3] = 0.0f;
+			}
+
+			indices.assign(model.indices.begin(), model.indices.end());
+
+			materials.resize(model.materials.size());
+			int index_begin = 0;
+			for (size_t i = 0; i < model.materials.size(); i++)
+			{
+				const pmd::PmdMaterial &source = model.materials[i];
+				RuntimeMaterial &material = materials[i];
+				memcpy(material.diffuse, source.diffuse, sizeof(float) * 4);
+				memcpy(material.specular, source.specular, sizeof(float) * 3);
+				material.specularity = source.power;
+				memcpy(material.ambient, source.ambient, sizeof(float) * 3);
+				material.edge_color[0] = material.edge_color[1] = material.edge_color[2] = 0.0f;
+				material.edge_color[3] = 1.0f;
+				material.edge_size = 1.0f;
+				// Ȃ痼ʕ`Asx0.98MMDŉe𗎂ƂȂގ
+				material.flag = (source.diffuse[3] < 1.0f ? 0x01 : 0) | (source.diffuse[3] != 0.98f ? 0x0E : 0) | (source.edge_flag ? 0x10 : 0);
+				material.texture = AddTexture(source.texture_filename);
+				material.sphere_texture = AddTexture(source.sphere_filename);
+				material.sphere_mode = 0;
+				if (material.sphere_texture >= 0)
+				{
+					size_t length = source.sphere_filename.size();
+					material.sphere_mode = (length >= 4 && (source.sphere_filename[length - 1] | 0x20) == 'a') ? 2 : 1;
+				}
+				material.shared_toon = 1;
+				material.toon_texture = source.toon_index < 10 ? source.toon_index : -1;
+				material.index_begin = index_begin;
+				material.index_count = source.index_count;
+				index_begin += source.index_count;
+				material_names.Add(std::string());
+			}
+
+			int bone_count = (int) model.bones.size();
+			bones.resize(bone_count);
+			bone_names.Reserve(bone_count, bone_count * 12);
+			for (int i = 0; i < bone_count; i++)
+			{
+				const pmd::PmdBone &source = model.bones[i];
+				RuntimeBone &bone = bones[i];
+				memcpy(bone.position, source.bone_head_pos, sizeof(float) * 3);
+				bone.parent = source.parent_bone_index == 0xFFFF ? -1 : ValidIndex(source.parent_bone_index, bone_count);
+				bone.level = 0;
+				bone.tail = source.tail_pos_bone_index == 0 ? -1 : ValidIndex(source.tail_pos_bone_index, bone_count);
+				bone.tail_offset[0] = bone.tail_offset[1] = bone.tail_offset[2] = 0.0f;
+				bone.grant_parent = -1;
+				bone.grant_weight = 0.0f;
+				bone.fixed_axis[0] = bone.fixed_axis[1] = bone.fixed_axis[2] = 0.0f;
+				bone.flag = 0x0001 | 0x0002;
+				switch (source.bone_type)
+				{
+				case pmd::BoneType::RotationAndMove:
+				case pmd::BoneType::IkEffector:
+					bone.flag |= 0x0004 | 0x0008 | 0x0010;
+					break;
+				case pmd::BoneType::RotationEffectable:
+					bone.grant_parent = ValidIndex(source.ik_parent_bone_index, bone_count);
+					bone.grant_weight = 1.0f;
+					bone.flag |= 0x0100;
+					break;
+				case pmd::BoneType::IkTarget:
+				case pmd::BoneType::Invisible:
+					break;
+				case pmd::BoneType::Twist:
+					bone.flag |= 0x0008 | 0x0010 | 0x0400;
+					if (bone.tail >= 0)
+					{
+						float length = 0.0f;
+						for (int c = 0; c < 3; c++)
+						{
+							bone.fixed_axis[c] = model.bones[bone.tail].bone_head_pos[c] - source.bone_head_pos[c];
+							length += bone.fixed_axis[c] * bone.fixed_axis[c];
+						}
+						length = length > 0.0f ? 1.0f / sqrtf(length) : 0.0f;
+						for (int c = 0; c < 3; c++)
+						{
+							bone.fixed_axis[c] *= length;
+						}
+					}
+					break;
+				case pmd::BoneType::RotationMovement:
+					bone.grant_parent = bone.tail;
+					bone.grant_weight = source.ik_parent_bone_index * 0.01f;
+					bone.tail = -1;
+					bone.flag |= 0x0100;
+					break;
+				default:
+					bone.flag |= 0x0008 | 0x0010;
+					break;
+				}
+				if (bone.grant_parent < 0)
+				{
+					bone.flag &= ~0x0100;
+				}
+				bone_names.Add(source.name);
+			}
+
+			for (auto &source : model.iks)
+			{
+				RuntimeIk ik;
+				ik.bone = source.ik_bone_index;
+				ik.target = source.target_bone_index;
+				ik.loop = source.interations;
+				ik.unit_angle = source.UnitAngle();
+				ik.link_begin = (int) ik_links.size();
+				for (uint16_t bone : source.ik_child_bone_index)
+				{
+					RuntimeIkLink link;
+					memset(&link, 0, sizeof(link));
+					link.bone = bone;
+					link.limited = pmd::PmdIk::LinkLimit(model.bones, bone, link.min_radian, link.max_radian);
+					ik_links.push_back(link);
+				}
+				ik.link_end = (int) ik_links.size();
+				iks.push_back(ik);
+				if (ik.bone < bone_count)
+				{
+					bones[ik.bone].flag |= 0x0020;
+				}
+			}
+
+			const pmd::PmdFace *base = nullptr;
+			size_t offset_count = 0;
+			for (auto &face : model.faces)
+			{
+				if (face.type == pmd::FaceCategory::Base)
+				{
+					base = base ? base : &face;
+				}
+				else
+				{
+					offset_count += face.vertices.size();
+				}
+			}
+			morphs.reserve(model.faces.size());
+			morph_vertices.reserve(offset_count);
+			morph_positions.reserve(offset_count * 3);
+			for (auto &face : model.faces)
+			{
+				if (face.type == pmd::FaceCategory::Base)
+				{
+					continue;
+				}
+				RuntimeMorph morph;
+				memset(&morph, 0, sizeof(morph));
+				morph.category = (pmx::MorphCategory) face.type;
+				morph.type = pmx::MorphType::Vertex;
+				morph.offset_begin = (int) morph_vertices.size();
+				for (auto &vertex : face.vertices)
+				{
+					if (base && vertex.vertex_index >= 0 && vertex.vertex_index < (int) base->vertices.size())
+					{
+						morph_vertices.push_back(base->vertices[vertex.vertex_index].vertex_index);
+						morph_positions.insert(morph_positions.end(), vertex.position, vertex.position + 3);
+					}
+				}
+				morph.offset_end = (int) morph_vertices.size();
+				morphs.push_back(morph);
+				morph_names.Add(face.name);
+			}
+			ClampIndices();
+		}
+
+	private:
+		/// LbV̐
+		enum BakedSectionId : uint32_t
+		{
+			SectionCounts = 1,
+			SectionName,
+			SectionComment,
+			SectionPositions,
+			SectionNormals,
+			SectionUvs,
+			SectionAdditionalUvs,
+			SectionEdges = SectionAdditionalUvs + 4,
+			SectionSkinningTypes,
+			SectionSkinningIndices,
+			SectionSkinningWeights,
+			SectionSdef,
+			SectionIndices,
+			SectionTextures,
+			SectionMaterials = SectionTextures + 2,
+			SectionMaterialNames,
+			SectionBones = SectionMaterialNames + 2,
+			SectionBoneNames,
+			SectionIks = SectionBoneNames + 2,
+			SectionIkLinks,
+			SectionMorphs,
+			SectionMorphNames,
+			SectionMorphVertices = SectionMorphNames + 2,
+			SectionMorphPositions,
+			SectionMorphUvVertices,
+			SectionMorphUvs,
+			SectionMorphBones,
+			SectionMorphTranslations,
+			SectionMorphRotations,
+			SectionMorphTargets,
+			SectionMorphWeights,
+		};
+
+		/// LbVɏޗvfȂ
+		struct BakedCounts
+		{
+			uint32_t name_encoding;
+			int vertex_count;
+			int additional_uv_count;
+			int reserved;
+		};
+
+		static int ValidIndex(int index, int count)
+		{
+			return (index >= 0 && index < count) ? index : -1;
+		}
+
+		/// -1(Ȃ)0 <= index < countǂ
+		static bool IsValidIndex(int index, int count)
+		{
+			return index >= -1 && index < count;
+		}
+
+		/// 0 <= begin <= end <= sizeǂ
+		static bool IsValidRange(int64_t begin, int64_t end, size_t size)
+		{
+			return begin >= 0 && begin <= end && end <= (int64_t) size;
+		}
+
+		/// ̃fɂ͈͊Õ{[EeNX`̃CfbNX-1ɂ
+		/// (XLjOIK͔͈͊O𖳎̂Ōʂ͕ς炸ALbV̓ǂݍ݂IsConsistent͈͂m߂)
+		void ClampIndices()
+		{
+			int bone_count = BoneCount();
+			for (int &index : skinning.bone_indices)
+			{
+				index = ValidIndex(index, bone_count);
+			}
+			for (auto &material : materials)
+			{
+				material.texture = ValidIndex(material.texture, textures.Count());
+				material.sphere_texture = ValidIndex(material.sphere_texture, textures.Count());
+				material.toon_texture = ValidIndex(material.toon_texture, material.shared_toon ? 10 : textures.Count());
+			}
+			for (auto &ik : iks)
+			{
+				ik.bone = ValidIndex(ik.bone, bone_count);
+				ik.target = ValidIndex(ik.target, bone_count);
+			}
+			for (auto &link : ik_links)
+			{
+				link.bone = ValidIndex(link.bone, bone_count);
+			}
+		}
+
+		/// LbVǂݍ񂾔z̑傫ƁAz܂CfbNXނ̒l͈͓ǂ
+		/// [t̃ItZbgw_E{[E[t́Ag͈͊ÔŊm߂Ȃ
+		bool IsConsistent() const
+		{
+			if ((name_encoding != NameEncoding::Utf8 && name_encoding != NameEncoding::Cp932)
+				|| vertex_count < 0 || additional_uv_count < 0 || additional_uv_count > 4)
+			{
+				return false;
+			}
+			size_t n = (size_t) vertex_count;
+			if (positions.Size() != n * 3 || normals.Size() != n * 3 || uvs.Size() != n * 2 || edges.Size() != n
+				|| skinning.types.size() != n || skinning.bone_indices.size() != n * 4 || skinning.bone_weights.size() != n * 4)
+			{
+				return false;
+			}
+			for (int k = 0; k < 4; k++)
+			{
+				if (additional_uvs[k].Size() != (k < additional_uv_count ? n * 4 : 0))
+				{
+					return false;
+				}
+			}
+			for (auto type : skinning.types)
+			{
+				if (type > pmx::PmxVertexSkinningType::QDEF)
+				{
+					return false;
+				}
+			}
+			size_t sdef_count = (size_t) std::count(skinning.types.begin(), skinning.types.end(), pmx::PmxVertexSkinningType::SDEF);
+			if (skinning.sdef.size() != sdef_count)
+			{
+				return false;
+			}
+			for (auto &sdef : skinning.sdef)
+			{
+				if (sdef.vertex_index < 0 || sdef.vertex_index >= vertex_count)
+				{
+					return false;
+				}
+			}
+			int bone_count = BoneCount();
+			for (int index : skinning.bone_indices)
+			{
+				if (!IsValidIndex(index, bone_count))
+				{
+					return false;
+				}
+			}
+			if ((size_t) material_names.Count() != materials.size() || (size_t) bone_names.Count() != bones.size() || (size_t) morph_names.Count() != morphs.size())
+			{
+				return false;
+			}
+			for (auto &material : materials)
+			{
+				if (!IsValidRange(material.index_begin, (int64_t) material.index_begin + material.index_count, indices.size())
+					|| !IsValidIndex(material.texture, textures.Count()) || !IsValidIndex(material.sphere_texture, textures.Count())
+					|| !IsValidIndex(material.toon_texture, material.shared_toon ? 10 : textures.Count()))
+				{
+					return false;
+				}
+			}
+			for (auto &bone : bones)
+			{
+				if (!IsValidIndex(bone.parent, bone_count) || !IsValidIndex(bone.grant_parent, bone_count) || !IsValidIndex(bone.tail, bone_count))
+				{
+					return false;
+				}
+			}
+			for (auto &ik : iks)
+			{
+				if (!IsValidRange(ik.link_begin, ik.link_end, ik_links.size())
+					|| !IsValidIndex(ik.bone, bone_count) || !IsValidIndex(ik.target, bone_count))
+				{
+					return false;
+				}
+			}
+			for (auto &link : ik_links)
+			{
+				if (!IsValidIndex(link.bone, bone_count))
+				{
+					return false;
+				}
+			}
+			if (morph_positions.size() != morph_vertices.size() * 3 || morph_uvs.size() != morph_uv_vertices.size() * 4
+				|| morph_translations.size() != morph_bones.size() * 3 || morph_rotations.size() != morph_bones.size() * 4
+				|| morph_weights.size() != morph_targets.size())
+			{
+				return false;
+			}
+			for (auto &morph : morphs)
+			{
+				size_t size;
+				switch (morph.type)
+				{
+				case pmx::MorphType::Vertex:
+					size = morph_vertices.size();
+					break;
+				case pmx::MorphType::UV:
+				case pmx::MorphType::AdditionalUV1:
+				case pmx::MorphType::AdditionalUV2:
+				case pmx::MorphType::AdditionalUV3:
+				case pmx::MorphType::AdditionalUV4:
+					size = morph_uv_vertices.size();
+					break;
+				case pmx::MorphType::Bone:
+					size = morph_bones.size();
+					break;
+				case pmx::MorphType::Group:
+				case pmx::MorphType::Flip:
+					size = morph_targets.size();
+					break;
+				default:
+					size = 0;
+					break;
+				}
+				if (!IsValidRange(morph.offset_begin, morph.offset_end, size))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void Clear()
+		{
+			name.clear();
+			comment.clear();
+			vertex_count = 0;
+			additional_uv_count = 0;
+			indices.clear();
+			textures.Clear();
+			materials.clear();
+			material_names.Clear();
+			bones.clear();
+			bone_names.Clear();
+			iks.clear();
+			ik_links.clear();
+			morphs.clear();
+			morph_names.Clear();
+			morph_vertices.clear();
+			morph_positions.clear();
+			morph_uv_vertices.clear();
+			morph_uvs.clear();
+			morph_bones.clear();
+			morph_translations.clear();
+			morph_rotations.clear();
+			morph_targets.clear();
+			morph_weights.clear();
+			skinning.Resize(0);
+		}
+
+		/// _̗mۂ(ׂď㏑̂ŁA傫Ȃ炻̂܂܎g)
+		void AllocateVertices(int count, int uv_count)
+		{
+			vertex_count = count;
+			additional_uv_count = uv_count;
+			Allocate(&positions, count * 3);
+			Allocate(&normals, count * 3);
+			Allocate(&uvs, count * 2);
+			for (int k = 0; k < 4; k++)
+			{
+				Allocate(&additional_uvs[k], k < uv_count ? count * 4 : 0);
+			}
+			Allocate(&edges, count);
+		}
+
+		static void Allocate(oguna::AlignedArray<float> *column, size_t size)
+		{
+			if (column->Size() != size)
+			{
+				column->Resize(size);
+			}
+		}
+
+		static void AddName(NameTable *table, const std::wstring &name, std::string *buffer)
+		{
+			oguna::EncodingConverter::Utf16ToUtf8(name.data(), (int) name.size(), buffer);
+			table->Add(*buffer);
+		}
+
+		/// PMD̃eNX`o^(Ȃ-1)
+		int AddTexture(const std::string &filename)
+		{
+			if (filename.empty())
+			{
+				return -1;
+			}
+			int found = textures.Find(filename);
+			if (found >= 0)
+			{
+				return found;
+			}
+			textures.Add(filename);
+			return textures.Count() - 1;
+		}
+	};
+}
\ No newline at end of file
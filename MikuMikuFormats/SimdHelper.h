@@ -0,0 +1,154 @@
+#pragma once
+
+// RpC̐ݒ肩gpłSIMD߃Zbg𔻒肷
+#if defined(__AVX2__)
+#define OGUNA_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OGUNA_SSE2 1
+#endif
+
+#if defined(__SSE4_1__) || defined(OGUNA_AVX2)
+#define OGUNA_SSE41 1
+#endif
+
+#ifdef OGUNA_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef OGUNA_SSE41
+#include <smmintrin.h>
+#endif
+#ifdef OGUNA_AVX2
+#include <immintrin.h>
+#endif
+#include <math.h>
+
+namespace oguna
+{
+	/// floatSIMDWX^{܂Ƃ߂ĉZ
+	/// AVX2Ȃ8ASSE2Ȃ4AǂȂ4vf̔zőp
+	struct FloatLanes
+	{
+#if defined(OGUNA_AVX2)
+		static const int Width = 8;
+		__m256 v;
+
+		static FloatLanes Load(const float *p) { FloatLanes r; r.v = _mm256_loadu_ps(p); return r; }
+		static FloatLanes Set(float a) { FloatLanes r; r.v = _mm256_set1_ps(a); return r; }
+		/// base[offsets[i]]W߂
+		static FloatLanes Gather(const float *base, const int *offsets) { FloatLanes r; r.v = _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i*) offsets), 4); return r; }
+		void Store(float *p) const { _mm256_storeu_ps(p, v); }
+		friend FloatLanes operator+(FloatLanes a, FloatLanes b) { a.v = _mm256_add_ps(a.v, b.v); return a; }
+		friend FloatLanes operator-(FloatLanes a, FloatLanes b) { a.v = _mm256_sub_ps(a.v, b.v); return a; }
+		friend FloatLanes operator*(FloatLanes a, FloatLanes b) { a.v = _mm256_mul_ps(a.v, b.v); return a; }
+		friend FloatLanes operator/(FloatLanes a, FloatLanes b) { a.v = _mm256_div_ps(a.v, b.v); return a; }
+		/// åevfb̕|
+		friend FloatLanes MultiplySign(FloatLanes a, FloatLanes b) { a.v = _mm256_xor_ps(a.v, _mm256_and_ps(b.v, _mm256_set1_ps(-0.0f))); return a; }
+		friend FloatLanes Abs(FloatLanes a) { a.v = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); return a; }
+		friend FloatLanes Sqrt(FloatLanes a) { a.v = _mm256_sqrt_ps(a.v); return a; }
+		friend FloatLanes Max(FloatLanes a, FloatLanes b) { a.v = _mm256_max_ps(a.v, b.v); return a; }
+#elif defined(OGUNA_SSE2)
+		static const int Width = 4;
+		__m128 v;
+
+		static FloatLanes Load(const float *p) { FloatLanes r; r.v = _mm_loadu_ps(p); return r; }
+		static FloatLanes Set(float a) { FloatLanes r; r.v = _mm_set1_ps(a); return r; }
+		/// base[offsets[i]]W߂
+		static FloatLanes Gather(const float *base, const int *offsets) { FloatLanes r; r.v = _mm_setr_ps(base[offsets[0]], base[offsets[1]], base[offsets[2]], base[offsets[3]]); return r; }
+		void Store(float *p) const { _mm_storeu_ps(p, v); }
+		friend FloatLanes operator+(FloatLanes a, FloatLanes b) { a.v = _mm_add_ps(a.v, b.v); return a; }
+		friend FloatLanes operator-(FloatLanes a, FloatLanes b) { a.v = _mm_sub_ps(a.v, b.v); return a; }
+		friend FloatLanes operator*(FloatLanes a, FloatLanes b) { a.v = _mm_mul_ps(a.v, b.v); return a; }
+		friend FloatLanes operator/(FloatLanes a, FloatLanes b) { a.v = _mm_div_ps(a.v, b.v); return a; }
+		/// åevfb̕|
+		friend FloatLanes MultiplySign(FloatLanes a, FloatLanes b) { a.v = _mm_xor_ps(a.v, _mm_and_ps(b.v, _mm_set1_ps(-0.0f))); return a; }
+		friend FloatLanes Abs(FloatLanes a) { a.v = _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); return a; }
+		friend FloatLanes Sqrt(FloatLanes a) { a.v = _mm_sqrt_ps(a.v); return a; }
+		friend FloatLanes Max(FloatLanes a, FloatLanes b) { a.v = _mm_max_ps(a.v, b.v); return a; }
+#else
+		static const int Width = 4;
+		float v[4];
+
+		static FloatLanes Load(const float *p) { FloatLanes r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+		static FloatLanes Set(float a) { FloatLanes r; for (int i = 0; i < 4; i++) r.v[i] = a; return r; }
+		/// base[offsets[i]]W߂
+		static FloatLanes Gather(const float *base, const int *offsets) { FloatLanes r; for (int i = 0; i < 4; i++) r.v[i] = base[offsets[i]]; return r; }
+		void Store(float *p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+		friend FloatLanes operator+(FloatLanes a, FloatLanes b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+		friend FloatLanes operator-(FloatLanes a, FloatLanes b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+		friend FloatLanes operator*(FloatLanes a, FloatLanes b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+		friend FloatLanes operator/(FloatLanes a, FloatLanes b) { for (int i = 0; i < 4; i++) a.v[i] /= b.v[i]; return a; }
+		/// åevfb̕|
+		friend FloatLanes MultiplySign(FloatLanes a, FloatLanes b) { for (int i = 0; i < 4; i++) a.v[i] = b.v[i] < 0.0f ? -a.v[i] : a.v[i]; return a; }
+		friend FloatLanes Abs(FloatLanes a) { for (int i = 0; i < 4; i++) a.v[i] = a.v[i] < 0.0f ? -a.v[i] : a.v[i]; return a; }
+		friend FloatLanes Sqrt(FloatLanes a) { for (int i = 0; i < 4; i++) a.v[i] = sqrtf(a.v[i]); return a; }
+		friend FloatLanes Max(FloatLanes a, FloatLanes b) { for (int i = 0; i < 4; i++) a.v[i] = a.v[i] < b.v[i] ? b.v[i] : a.v[i]; return a; }
+#endif
+	};
+
+	/// 4float(s̈sȂ)܂Ƃ߂ĉZ
+	/// SSE2Ȃ4vf̔zőp
+	struct Float4
+	{
+#if defined(OGUNA_SSE2)
+		__m128 v;
+		static Float4 Load(const float *p) { Float4 r; r.v = _mm_loadu_ps(p); return r; }
+		static Float4 Set(float a) { Float4 r; r.v = _mm_set1_ps(a); return r; }
+		void Store(float *p) const { _mm_storeu_ps(p, v); }
+		friend Float4 operator+(Float4 a, Float4 b) { a.v = _mm_add_ps(a.v, b.v); return a; }
+		friend Float4 operator*(Float4 a, Float4 b) { a.v = _mm_mul_ps(a.v, b.v); return a; }
+#else
+		float v[4];
+		static Float4 Load(const float *p) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+		static Float4 Set(float a) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a; return r; }
+		void Store(float *p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+		friend Float4 operator+(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+		friend Float4 operator*(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+#endif
+	};
+
+	/// ςdot̎la, b䗦tŋʐ`Ԃd݂߂(ʂa * weight_a + b * weight_b)
+	/// Eberly, "A Fast and Accurate Algorithm for Computing SLERP"̑ߎg
+	/// sin((1-t))/sinƂsin(t)/sinƂcosƂ̑ŋ߂̂ŁAacossing킸Ƀ[ƂɌvZł
+	/// 12ōŌ̍␳ƁAS͈͂Ōȋʐ`ԂƂ̍1.2e-6ȉɂȂ
+	/// S[cos >= 0.9(ׂ荇L[Ȃǉ]߂ꍇ)Ȃ4őł؂Aȋʐ`ԂƂ͖̍1.5e-7ȉɂȂ
+	/// Žʂʂ悤ɁAweight_bɂdot̕|
+	inline void SlerpWeights(FloatLanes dot, FloatLanes t, FloatLanes *weight_a, FloatLanes *weight_b)
+	{
+		// u[i] = 1 / (i(2i + 1)), v[i] = i / (2i + 1)
+		static const float u[13] = { 0.0f, 1.0f / 3, 1.0f / 10, 1.0f / 21, 1.0f / 36, 1.0f / 55, 1.0f / 78, 1.0f / 105, 1.0f / 136, 1.0f / 171, 1.0f / 210, 1.0f / 253, 1.0f / 300 };
+		static const float v[13] = { 0.0f, 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15, 8.0f / 17, 9.0f / 19, 10.0f / 21, 11.0f / 23, 12.0f / 25 };
+		FloatLanes one = FloatLanes::Set(1.0f);
+		FloatLanes cos_theta = Abs(dot);
+		FloatLanes x_minus_one = cos_theta - one;
+		float cos_thetas[FloatLanes::Width];
+		cos_theta.Store(cos_thetas);
+		int order = 4;
+		float one_plus_mu = 1.0f;
+		for (int lane = 0; lane < FloatLanes::Width; lane++)
+		{
+			if (cos_thetas[lane] < 0.9f)
+			{
+				order = 12;
+				one_plus_mu = 1.89372f;
+				break;
+			}
+		}
+		FloatLanes d = one - t;
+		FloatLanes t2 = t * t;
+		FloatLanes d2 = d * d;
+		FloatLanes coefficient_t = one;
+		FloatLanes coefficient_d = one;
+		for (int i = order; i >= 1; i--)
+		{
+			float scale = i == order ? one_plus_mu : 1.0f;
+			FloatLanes lane_u = FloatLanes::Set(u[i] * scale);
+			FloatLanes lane_v = FloatLanes::Set(v[i] * scale);
+			coefficient_t = one + (lane_u * t2 - lane_v) * x_minus_one * coefficient_t;
+			coefficient_d = one + (lane_u * d2 - lane_v) * x_minus_one * coefficient_d;
+		}
+		*weight_a = coefficient_d * d;
+		*weight_b = MultiplySign(coefficient_t * t, dot);
+	}
+}
\ No newline at end of file
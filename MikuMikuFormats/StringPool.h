@@ -0,0 +1,398 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace oguna
+{
+	/// ̈ꕔw(L͂Ȃ)
+	struct StringView
+	{
+		const char *data;
+		size_t size;
+
+		std::string ToString() const
+		{
+			return std::string(data, size);
+		}
+
+		bool operator==(const StringView &other) const
+		{
+			return size == other.size && memcmp(data, other.data, size) == 0;
+		}
+
+		bool operator!=(const StringView &other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	/// Oxi[AԍŎQƂ镶̕\
+	/// ͑傫Ȃ܂Ƃ܂(`N)ɋl߂Ċi[̂ŁAOƂɊmۂAo^ς݂̈̕ʒu͕\j܂ŕςȂ
+	/// \ɓo^O͔ԍȂ瓯Ȃ̂ŁAr͔ԍ̔rōς
+	/// f⃂[VƂɎAShared()őŜŋL
+	class StringPool
+	{
+	public:
+		/// Ȕԍ
+		static const uint32_t InvalidId = 0xFFFFFFFF;
+
+		/// synchronizedȂo^ƎQƂbNĕ̃Xbhg悤ɂ
+		explicit StringPool(bool synchronized = false, size_t chunk_size = 4096)
+			: synchronized(synchronized)
+			, chunk_size(chunk_size)
+			, chunk_used(chunk_size)
+			, chunk_bytes(0)
+		{}
+
+		StringPool(const StringPool&) = delete;
+		StringPool& operator=(const StringPool&) = delete;
+
+		/// o^ĔԍԂ(o^ς݂Ȃ炻̔ԍ)
+		uint32_t Intern(const char *data, size_t size)
+		{
+			Lock lock(this);
+			uint32_t hash = Hash(data, size);
+			uint32_t found = Lookup(data, size, hash);
+			if (found != InvalidId)
+			{
+				return found;
+			}
+			Entry entry;
+			entry.data = Store(data, size);
+			entry.size = (uint32_t) size;
+			entry.hash = hash;
+			uint32_t id = (uint32_t) entries.size();
+			entries.push_back(entry);
+			if (entries.size() * 2 > slots.size())
+			{
+				Rehash(slots.empty() ? 64 : slots.size() * 2);
+			}
+			else
+			{
+				Insert(id);
+			}
+			return id;
+		}
+
+		uint32_t Intern(const std::string &value)
+		{
+			return Intern(value.data(), value.size());
+		}
+
+		/// o^ς݂̔̕ԍ(ȂInvalidId)
+		uint32_t Find(const char *data, size_t size) const
+		{
+			Lock lock(this);
+			return Lookup(data, size, Hash(data, size));
+		}
+
+		uint32_t Find(const std::string &value) const
+		{
+			return Find(value.data(), value.size());
+		}
+
+		/// ԍid̕(\j܂ŗLA'\0'ŏI)
+		StringView View(uint32_t id) const
+		{
+			Lock lock(this);
+			StringView view;
+			view.data = entries[id].data;
+			view.size = entries[id].size;
+			return view;
+		}
+
+		std::string Get(uint32_t id) const
+		{
+			return View(id).ToString();
+		}
+
+		/// o^Ă镶̐
+		size_t Count() const
+		{
+			Lock lock(this);
+			return entries.size();
+		}
+
+		/// \gĂoCg
+		size_t MemorySize() const
+		{
+			Lock lock(this);
+			return (chunks.size() + large_chunks.size()) * sizeof(std::unique_ptr<char[]>) + chunk_bytes
+				+ entries.capacity() * sizeof(Entry) + slots.capacity() * sizeof(uint32_t);
+		}
+
+		/// vZXŜŋL\(̃Xbhg)
+		static StringPool& Shared()
+		{
+			static StringPool pool(true);
+			return pool;
+		}
+
+	private:
+		struct Entry
+		{
+			const char *data;
+			uint32_t size;
+			uint32_t hash;
+		};
+
+		/// synchronized̂ƂbN
+		class Lock
+		{
+		public:
+			explicit Lock(const StringPool *pool)
+				: mutex(pool->synchronized ? &pool->mutex : nullptr)
+			{
+				if (mutex)
+				{
+					mutex->lock();
+				}
+			}
+
+			~Lock()
+			{
+				if (mutex)
+				{
+					mutex->unlock();
+				}
+			}
+
+		private:
+			std::mutex *mutex;
+		};
+
+		bool synchronized;
+		mutable std::mutex mutex;
+		/// l߂`N
+		std::vector<std::unique_ptr<char[]>> chunks;
+		/// `NɎ܂Ȃ
+		std::vector<std::unique_ptr<char[]>> large_chunks;
+		size_t chunk_size;
+		/// Ō̃`N̎gpς݃oCg
+		size_t chunk_used;
+		/// `N̍voCg
+		size_t chunk_bytes;
+		std::vector<Entry> entries;
+		/// ԍ̃nbV\(󂫂InvalidIdA傫2̗ݏ)
+		std::vector<uint32_t> slots;
+
+		/// FNV-1a
+		static uint32_t Hash(const char *data, size_t size)
+		{
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < size; i++)
+			{
+				hash = (hash ^ (uint8_t) data[i]) * 16777619u;
+			}
+			return hash;
+		}
+
+		uint32_t Lookup(const char *data, size_t size, uint32_t hash) const
+		{
+			if (slots.empty())
+			{
+				return InvalidId;
+			}
+			size_t mask = slots.size() - 1;
+			for (size_t slot = hash & mask; slots[slot] != InvalidId; slot = (slot + 1) & mask)
+			{
+				const Entry &entry = entries[slots[slot]];
+				if (entry.hash == hash && entry.size == size && memcmp(entry.data, data, size) == 0)
+				{
+					return slots[slot];
+				}
+			}
+			return InvalidId;
+		}
+
+		void Insert(uint32_t id)
+		{
+			size_t mask = slots.size() - 1;
+			size_t slot = entries[id].hash & mask;
+			while (slots[slot] != InvalidId)
+			{
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = id;
+		}
+
+		void Rehash(size_t size)
+		{
+			slots.assign(size, (uint32_t) InvalidId);
+			for (uint32_t id = 0; id < (uint32_t) entries.size(); id++)
+			{
+				Insert(id);
+			}
+		}
+
+		/// '\0'tŃ`NɎʂ(`N1/4𒴂镶͐p̃`Nɒu)
+		const char* Store(const char *data, size_t size)
+		{
+			char *out;
+			if (size + 1 > chunk_size / 4)
+			{
+				large_chunks.emplace_back(new char[size + 1]);
+				out = large_chunks.back().get();
+				chunk_bytes += size + 1;
+			}
+			else
+			{
+				if (chunk_used + size + 1 > chunk_size)
+				{
+					chunks.emplace_back(new char[chunk_size]);
+					chunk_used = 0;
+					chunk_bytes += chunk_size;
+				}
+				out = chunks.back().get() + chunk_used;
+				chunk_used += size + 1;
+			}
+			if (size)
+			{
+				memcpy(out, data, size);
+			}
+			out[size] = '\0';
+			return out;
+		}
+	};
+
+	/// StringPoolɓo^O̔ԍ̕
+	/// ԍʒuւ̍(StringPoolƓJԒn@̃nbV\)̂ŁAԍŗvf̂ɕтǂȂ
+	class StringIdList
+	{
+	public:
+		void Clear()
+		{
+			ids.clear();
+			slots.clear();
+		}
+
+		void Reserve(size_t count)
+		{
+			ids.reserve(count);
+			if (count * 2 > slots.size())
+			{
+				Rehash(SlotCount(count));
+			}
+		}
+
+		/// ɉĈʒuԂ(ԍłɂĂA͍ŏ̈ʒuw܂܂ɂ)
+		int Push(uint32_t id)
+		{
+			int position = (int) ids.size();
+			ids.push_back(id);
+			if (ids.size() * 2 > slots.size())
+			{
+				Rehash(SlotCount(ids.size()));
+			}
+			else
+			{
+				Insert((uint32_t) position);
+			}
+			return position;
+		}
+
+		int Count() const
+		{
+			return (int) ids.size();
+		}
+
+		uint32_t Id(int position) const
+		{
+			return ids[position];
+		}
+
+		/// ԍid̍ŏ̈ʒu(Ȃ-1)
+		int Find(uint32_t id) const
+		{
+			if (slots.empty())
+			{
+				return -1;
+			}
+			size_t mask = slots.size() - 1;
+			for (size_t slot = Hash(id) & mask; slots[slot] != StringPool::InvalidId; slot = (slot + 1) & mask)
+			{
+				if (ids[slots[slot]] == id)
+				{
+					return (int) slots[slot];
+				}
+			}
+			return -1;
+		}
+
+		/// from̔ԍtoɓo^
+		void Reintern(const StringPool &from, StringPool *to)
+		{
+			if (&from == to)
+			{
+				return;
+			}
+			std::vector<uint32_t> source;
+			source.swap(ids);
+			Clear();
+			Reserve(source.size());
+			for (uint32_t id : source)
+			{
+				StringView name = from.View(id);
+				Push(to->Intern(name.data, name.size));
+			}
+		}
+
+		/// тƍgĂoCg
+		size_t MemorySize() const
+		{
+			return (ids.capacity() + slots.capacity()) * sizeof(uint32_t);
+		}
+
+	private:
+		std::vector<uint32_t> ids;
+		/// ʒũnbV\(󂫂StringPool::InvalidIdA傫2̗ݏ)
+		std::vector<uint32_t> slots;
+
+		/// ԍ0珇ɐÛŁAĂ牺ʃrbgg
+		static uint32_t Hash(uint32_t id)
+		{
+			return (id * 2654435761u) >> 7;
+		}
+
+		/// count𔼕ȉ̖܂œ傫
+		static size_t SlotCount(size_t count)
+		{
+			size_t size = 16;
+			while (size < count * 2)
+			{
+				size *= 2;
+			}
+			return size;
+		}
+
+		/// ԍłɂΓȂ
+		void Insert(uint32_t position)
+		{
+			size_t mask = slots.size() - 1;
+			size_t slot = Hash(ids[position]) & mask;
+			while (slots[slot] != StringPool::InvalidId)
+			{
+				if (ids[slots[slot]] == ids[position])
+				{
+					return;
+				}
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = position;
+		}
+
+		void Rehash(size_t size)
+		{
+			slots.assign(size, (uint32_t) StringPool::InvalidId);
+			for (uint32_t position = 0; position < (uint32_t) ids.size(); position++)
+			{
+				Insert(position);
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace oguna
+{
+	/// Œ萔̃[J[XbhœYt̃^XNQɎs
+	/// RuňĂяoXbhsɎQAׂẴ^XN̊҂
+	class ThreadPool
+	{
+	protected:
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		/// Run̓Ăяo𒼗񉻂
+		std::mutex run_mutex;
+		/// s̃^XN
+		const std::function<void(int)> *task;
+		int task_count;
+		std::atomic<int> next_index;
+		int running_workers;
+		unsigned generation;
+		bool stopping;
+		/// ŏɔO
+		std::exception_ptr error;
+
+		static bool& IsWorkerThread()
+		{
+			static thread_local bool is_worker = false;
+			return is_worker;
+		}
+
+		/// ̃^XNos
+		void Drain()
+		{
+			for (;;)
+			{
+				int index = next_index.fetch_add(1);
+				if (index >= task_count)
+				{
+					return;
+				}
+				try
+				{
+					(*task)(index);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!error)
+					{
+						error = std::current_exception();
+					}
+					// c̃^XN͎sȂ
+					next_index.store(task_count);
+				}
+			}
+		}
+
+		void WorkerMain()
+		{
+			IsWorkerThread() = true;
+			unsigned seen = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&] { return stopping || generation != seen; });
+					if (stopping)
+					{
+						return;
+					}
+					seen = generation;
+				}
+				Drain();
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (--running_workers == 0)
+					{
+						done.notify_all();
+					}
+				}
+			}
+		}
+
+	public:
+		/// thread_count0ȉȂn[hEFÃXbhɍ킹
+		explicit ThreadPool(int thread_count = 0)
+			: task(nullptr)
+			, task_count(0)
+			, next_index(0)
+			, running_workers(0)
+			, generation(0)
+			, stopping(false)
+		{
+			if (thread_count <= 0)
+			{
+				thread_count = (int) std::thread::hardware_concurrency();
+			}
+			// ĂяoXbhsɎQ̂Ń[J[͈Ȃ
+			for (int i = 1; i < thread_count; i++)
+			{
+				workers.emplace_back(&ThreadPool::WorkerMain, this);
+			}
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (auto &worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/// Ăяo܂߂
+		int ThreadCount() const
+		{
+			return (int) workers.size() + 1;
+		}
+
+		/// func(0)`func(count-1)ɎsĊ҂
+		/// ^XNO𓊂ꍇ͎cł؂Aŏ̗OĂяo֓
+		void Run(int count, const std::function<void(int)> &func)
+		{
+			if (count <= 0)
+			{
+				return;
+			}
+			// [J[̓qĂяo^XN̏ꍇ͂̏Ŏs
+			if (workers.empty() || count == 1 || IsWorkerThread())
+			{
+				for (int i = 0; i < count; i++)
+				{
+					func(i);
+				}
+				return;
+			}
+			std::lock_guard<std::mutex> run_lock(run_mutex);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				task = &func;
+				task_count = count;
+				next_index.store(0);
+				error = nullptr;
+				running_workers = (int) workers.size();
+				generation++;
+			}
+			wake.notify_all();
+			Drain();
+			std::exception_ptr result;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				done.wait(lock, [&] { return running_workers == 0; });
+				task = nullptr;
+				result = error;
+				error = nullptr;
+			}
+			if (result)
+			{
+				std::rethrow_exception(result);
+			}
+		}
+
+		/// vZXŜŋLXbhv[
+		static ThreadPool& Shared()
+		{
+			static ThreadPool pool;
+			return pool;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+#pragma once
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "Pmx.h"
+#include "Pmd.h"
+#include "RuntimeModel.h"
+#include "AlignedArray.h"
+#include "SimdHelper.h"
+
+namespace mmd
+{
+	/// _[t(PMX̒_[tAPMD̕\)̈ʒuItZbgdݕtő킹
+	///
+	/// [tƂ̃ItZbg𒸓_CfbNXɈ̔z֋l߂ĂA
+	/// d݂|vZSIMDł܂Ƃ߂čsA_Ƃ̍obt@֑
+	/// Apply͑O񂩂d݂ς[t̍𑫂̂ŁA̃[tȂς̒_GȂ
+	/// 𑫂Ɗۂߌ덷܂̂ŁARebuildInterval񂲂ƂɑŜvZ
+	class VertexMorph
+	{
+	public:
+		/// ōXV񐔂̏(ŜvZ)
+		static const int RebuildInterval = 1024;
+
+		VertexMorph()
+			: vertex_count(0)
+			, active_entries(0)
+			, update_count(0)
+		{}
+
+		/// PMX̒_[t(d݂̓[tCfbNXŁA_[tȊO͖)
+		void Setup(const pmx::PmxModel &model)
+		{
+			std::vector<std::vector<std::pair<int, const float*>>> morphs(model.morph_count);
+			for (int i = 0; i < model.morph_count; i++)
+			{
+				const pmx::PmxMorph &morph = model.morphs[i];
+				if (morph.morph_type != pmx::MorphType::Vertex)
+				{
+					continue;
+				}
+				for (int k = 0; k < morph.offset_count; k++)
+				{
+					const pmx::PmxMorphVertexOffset &offset = morph.vertex_offsets[k];
+					morphs[i].push_back(std::make_pair(offset.vertex_index, offset.position_offset));
+				}
+			}
+			Build(model.vertex_count, morphs);
+		}
+
+		/// PMD̕\(d݂͕\CfbNXŁAbase͖)
+		/// baseȊO̕\̒_CfbNXbase̒_̔ԍȂ̂ŁAf̒_CfbNXɒ
+		void Setup(const pmd::PmdModel &model)
+		{
+			const pmd::PmdFace *base = nullptr;
+			for (auto &face : model.faces)
+			{
+				if (face.type == pmd::FaceCategory::Base)
+				{
+					base = &face;
+					break;
+				}
+			}
+			std::vector<std::vector<std::pair<int, const float*>>> morphs(model.faces.size());
+			for (size_t i = 0; i < model.faces.size(); i++)
+			{
+				const pmd::PmdFace &face = model.faces[i];
+				if (&face == base || base == nullptr)
+				{
+					continue;
+				}
+				for (auto &vertex : face.vertices)
+				{
+					if (vertex.vertex_index >= 0 && vertex.vertex_index < (int) base->vertices.size())
+					{
+						morphs[i].push_back(std::make_pair(base->vertices[vertex.vertex_index].vertex_index, vertex.position));
+					}
+				}
+			}
+			Build((int) model.vertices.size(), morphs);
+		}
+
+		/// RuntimeModel̒_[t(d݂̓[tCfbNXŁA_[tȊO͖)
+		void Setup(const RuntimeModel &model)
+		{
+			std::vector<std::vector<std::pair<int, const float*>>> morphs(model.MorphCount());
+			for (int i = 0; i < model.MorphCount(); i++)
+			{
+				const RuntimeMorph &morph = model.morphs[i];
+				if (morph.type != pmx::MorphType::Vertex)
+				{
+					continue;
+				}
+				morphs[i].reserve(morph.offset_end - morph.offset_begin);
+				for (int k = morph.offset_begin; k < morph.offset_end; k++)
+				{
+					morphs[i].push_back(std::make_pair(model.morph_vertices[k], &model.morph_positions[k * 3]));
+				}
+			}
+			Build(model.vertex_count, morphs);
+		}
+
+		/// [t̏d݂weights([t)ɂ
+		/// O񂩂ς[t̍𑫂Aobt@ďd݂̂郂[t𑫂ΑŜvZ
+		void Apply(const float *weights)
+		{
+			changed.clear();
+			size_t changed_entries = 0;
+			size_t next_active_entries = active_entries;
+			for (int i = 0; i < MorphCount(); i++)
+			{
+				if (weights[i] != applied_weights[i])
+				{
+					size_t entries = morph_offsets[i + 1] - morph_offsets[i];
+					changed.push_back(i);
+					changed_entries += entries;
+					if (applied_weights[i] == 0.0f)
+					{
+						next_active_entries += entries;
+					}
+					else if (weights[i] == 0.0f)
+					{
+						next_active_entries -= entries;
+					}
+				}
+			}
+			if (changed.empty())
+			{
+				return;
+			}
+			// obt@Ԃ͒_4ŃGg1xƌς
+			if (++update_count >= RebuildInterval || changed_entries > next_active_entries + vertex_count / 4)
+			{
+				Rebuild(weights);
+				return;
+			}
+			for (int morph : changed)
+			{
+				AddMorph(morph, weights[morph] - applied_weights[morph]);
+				applied_weights[morph] = weights[morph];
+			}
+			active_entries = next_active_entries;
+		}
+
+		/// g킸ɑŜvZ
+		void Rebuild(const float *weights)
+		{
+			memset(deltas.Data(), 0, sizeof(float) * vertex_count * 3);
+			active_entries = 0;
+			for (int i = 0; i < MorphCount(); i++)
+			{
+				applied_weights[i] = weights[i];
+				if (weights[i] != 0.0f)
+				{
+					active_entries += morph_offsets[i + 1] - morph_offsets[i];
+					AddMorph(i, weights[i]);
+				}
+			}
+			update_count = 0;
+		}
+
+		/// _Ƃ̈ʒu̍(_*3)
+		const float* Deltas() const
+		{
+			return deltas.Data();
+		}
+
+		/// Kpς݂̏d([t)
+		const float* Weights() const
+		{
+			return applied_weights.data();
+		}
+
+		int MorphCount() const
+		{
+			return (int) applied_weights.size();
+		}
+
+		int VertexCount() const
+		{
+			return vertex_count;
+		}
+
+		/// [tmorph_̐
+		int OffsetCount(int morph) const
+		{
+			return (int) (morph_offsets[morph + 1] - morph_offsets[morph]);
+		}
+
+	private:
+		int vertex_count;
+		/// [tƂentries͈̔([t+1)
+		std::vector<size_t> morph_offsets;
+		/// _CfbNX*3
+		std::vector<int> entry_vertices;
+		/// ʒuItZbg(Gg*3)
+		oguna::AlignedArray<float> entry_offsets;
+		/// _Ƃ̈ʒu̍
+		oguna::AlignedArray<float> deltas;
+		std::vector<float> applied_weights;
+		/// d݂0łȂ[t̃Gg
+		size_t active_entries;
+		int update_count;
+		/// Applyŏd݂ς[t
+		std::vector<int> changed;
+
+		void Build(int vertex_count, std::vector<std::vector<std::pair<int, const float*>>> &morphs)
+		{
+			this->vertex_count = vertex_count;
+			deltas.Resize(vertex_count * 3);
+			applied_weights.assign(morphs.size(), 0.0f);
+			morph_offsets.assign(1, 0);
+			size_t total = 0;
+			for (auto &morph : morphs)
+			{
+				// ͈͊O̒_A_CfbNXɕׂčobt@ւ݂̏A
+				morph.erase(std::remove_if(morph.begin(), morph.end(), [vertex_count](const std::pair<int, const float*> &entry)
+				{
+					return entry.first < 0 || entry.first >= vertex_count;
+				}), morph.end());
+				std::stable_sort(morph.begin(), morph.end(), [](const std::pair<int, const float*> &a, const std::pair<int, const float*> &b)
+				{
+					return a.first < b.first;
+				});
+				total += morph.size();
+				morph_offsets.push_back(total);
+			}
+			entry_vertices.resize(total);
+			entry_offsets.Resize(total * 3);
+			size_t entry = 0;
+			for (auto &morph : morphs)
+			{
+				for (auto &offset : morph)
+				{
+					entry_vertices[entry] = offset.first * 3;
+					memcpy(&entry_offsets[entry * 3], offset.second, sizeof(float) * 3);
+					entry++;
+				}
+			}
+			active_entries = 0;
+			update_count = 0;
+			changed.clear();
+		}
+
+		/// [tmorph̃ItZbgweight|đ
+		void AddMorph(int morph, float weight)
+		{
+			typedef oguna::FloatLanes Lanes;
+			const int width = Lanes::Width;
+			size_t begin = morph_offsets[morph];
+			size_t end = morph_offsets[morph + 1];
+			float *delta = deltas.Data();
+			const float *offsets = entry_offsets.Data();
+			const int *vertices = entry_vertices.data();
+			Lanes lane_weight = Lanes::Set(weight);
+			// width̃Gg(x, y, z)3 * width̘AfloatȂ̂ŁA3ɕďd݂|
+			float scaled[3 * width];
+			size_t i = begin;
+			for (; i + width <= end; i += width)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					(Lanes::Load(offsets + i * 3 + k * width) * lane_weight).Store(scaled + k * width);
+				}
+				for (int lane = 0; lane < width; lane++)
+				{
+					float *d = delta + vertices[i + lane];
+					d[0] += scaled[lane * 3];
+					d[1] += scaled[lane * 3 + 1];
+					d[2] += scaled[lane * 3 + 2];
+				}
+			}
+			for (; i < end; i++)
+			{
+				float *d = delta + vertices[i];
+				d[0] += offsets[i * 3] * weight;
+				d[1] += offsets[i * 3 + 1] * weight;
+				d[2] += offsets[i * 3 + 2] * weight;
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -1,12 +1,28 @@
+#pragma once
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <memory>
 #include <iostream>
 #include <fstream>
 #include <ostream>
+#include <stdlib.h>
+#include "BinaryReader.h"
+#include "BinaryWriter.h"
+#include "EncodingHelper.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 
 namespace vmd
 {
+	/// OsizeoCǧŒ蒷ɋl߂(ΐ؂l߁AZ0Ŗ߂)
+	inline void PackFixedString(char *out, const std::string &value, size_t size)
+	{
+		size_t length = value.size() < size ? value.size() : size;
+		memcpy(out, value.data(), length);
+		memset(out + length, 0, size - length);
+	}
+
 	/// {[t[
 	class VmdBoneFrame
 	{
@@ -22,24 +38,38 @@ namespace vmd
 		/// ԋȐ
 		char interpolation[4][4][4];
 
-		void Read(std::istream* stream)
+		void Read(oguna::BinaryReader *reader)
+		{
+			// 111oCǧŒ蒷R[h܂Ƃ߂ĎQƂ
+			const char *record = reader->View(111);
+			const char *terminal = (const char*) memchr(record, '\0', 15);
+			name.assign(record, terminal ? terminal : record + 15);
+			memcpy(&frame, record + 15, sizeof(int));
+			memcpy(position, record + 19, sizeof(float) * 3);
+			memcpy(orientation, record + 31, sizeof(float) * 4);
+			memcpy(interpolation, record + 47, sizeof(char) * 4 * 4 * 4);
+		}
+
+		/// 111oCǧŒ蒷R[hɋl߂
+		void Pack(char *record) const
+		{
+			PackFixedString(record, name, 15);
+			memcpy(record + 15, &frame, sizeof(int));
+			memcpy(record + 19, position, sizeof(float) * 3);
+			memcpy(record + 31, orientation, sizeof(float) * 4);
+			memcpy(record + 47, interpolation, sizeof(char) * 4 * 4 * 4);
+		}
+
+		void Write(oguna::BinaryWriter *writer) const
 		{
-			char buffer[15];
-			stream->read((char*) buffer, sizeof(char)*15);
-			name = std::string(buffer);
-			stream->read((char*) &frame, sizeof(int));
-			stream->read((char*) position, sizeof(float)*3);
-			stream->read((char*) orientation, sizeof(float)*4);
-			stream->read((char*) interpolation, sizeof(char) * 4 * 4 * 4);
+			Pack(writer->Append(111));
 		}
 
-		void Write(std::ostream* stream)
+		void Write(std::ostream* stream) const
 		{
-			stream->write((char*)name.c_str(), sizeof(char) * 15);
-			stream->write((char*)&frame, sizeof(int));
-			stream->write((char*)position, sizeof(float) * 3);
-			stream->write((char*)orientation, sizeof(float) * 4);
-			stream->write((char*)interpolation, sizeof(char) * 4 * 4 * 4);
+			char record[111];
+			Pack(record);
+			stream->write(record, sizeof(record));
 		}
 	};
 
@@ -54,20 +84,31 @@ namespace vmd
 		/// t[ԍ
 		uint32_t frame;
 
-		void Read(std::istream* stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			char buffer[15];
-			stream->read((char*) &buffer, sizeof(char) * 15);
-			face_name = std::string(buffer);
-			stream->read((char*) &frame, sizeof(int));
-			stream->read((char*) &weight, sizeof(float));
+			face_name = reader->ReadFixedString(15);
+			frame = reader->Read<uint32_t>();
+			weight = reader->Read<float>();
 		}
 
-		void Write(std::ostream* stream)
+		/// 23oCǧŒ蒷R[hɋl߂
+		void Pack(char *record) const
 		{
-			stream->write((char*)face_name.c_str(), sizeof(char) * 15);
-			stream->write((char*)&frame, sizeof(int));
-			stream->write((char*)&weight, sizeof(float));
+			PackFixedString(record, face_name, 15);
+			memcpy(record + 15, &frame, sizeof(uint32_t));
+			memcpy(record + 19, &weight, sizeof(float));
+		}
+
+		void Write(oguna::BinaryWriter *writer) const
+		{
+			Pack(writer->Append(23));
+		}
+
+		void Write(std::ostream* stream) const
+		{
+			char record[23];
+			Pack(record);
+			stream->write(record, sizeof(record));
 		}
 	};
 
@@ -90,26 +131,41 @@ namespace vmd
 		/// sf[^
 		char unknown[3];
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			stream->read((char*) &frame, sizeof(int));
-			stream->read((char*) &distance, sizeof(float));
-			stream->read((char*) position, sizeof(float) * 3);
-			stream->read((char*) orientation, sizeof(float) * 3);
-			stream->read((char*) interpolation, sizeof(char) * 24);
-			stream->read((char*) &angle, sizeof(float));
-			stream->read((char*) unknown, sizeof(char) * 3);
+			// Œ蒷R[h܂Ƃ߂ĎQƂ
+			const char *record = reader->View(63);
+			memcpy(&frame, record, sizeof(int));
+			memcpy(&distance, record + 4, sizeof(float));
+			memcpy(position, record + 8, sizeof(float) * 3);
+			memcpy(orientation, record + 20, sizeof(float) * 3);
+			memcpy(interpolation, record + 32, sizeof(char) * 24);
+			memcpy(&angle, record + 56, sizeof(float));
+			memcpy(unknown, record + 60, sizeof(char) * 3);
 		}
 
-		void Write(std::ostream *stream)
+		/// Œ蒷R[hɋl߂
+		void Pack(char *record) const
 		{
-			stream->write((char*)&frame, sizeof(int));
-			stream->write((char*)&distance, sizeof(float));
-			stream->write((char*)position, sizeof(float) * 3);
-			stream->write((char*)orientation, sizeof(float) * 3);
-			stream->write((char*)interpolation, sizeof(char) * 24);
-			stream->write((char*)&angle, sizeof(float));
-			stream->write((char*)unknown, sizeof(char) * 3);
+			memcpy(record, &frame, sizeof(int));
+			memcpy(record + 4, &distance, sizeof(float));
+			memcpy(record + 8, position, sizeof(float) * 3);
+			memcpy(record + 20, orientation, sizeof(float) * 3);
+			memcpy(record + 32, interpolation, sizeof(char) * 24);
+			memcpy(record + 56, &angle, sizeof(float));
+			memcpy(record + 60, unknown, sizeof(char) * 3);
+		}
+
+		void Write(oguna::BinaryWriter *writer) const
+		{
+			Pack(writer->Append(63));
+		}
+
+		void Write(std::ostream *stream) const
+		{
+			char record[63];
+			Pack(record);
+			stream->write(record, sizeof(record));
 		}
 	};
 
@@ -124,18 +180,31 @@ namespace vmd
 		/// ʒu
 		float position[3];
 
-		void Read(std::istream* stream)
+		void Read(oguna::BinaryReader *reader)
+		{
+			frame = reader->Read<int>();
+			reader->Read(color, 3);
+			reader->Read(position, 3);
+		}
+
+		/// 28oCǧŒ蒷R[hɋl߂
+		void Pack(char *record) const
+		{
+			memcpy(record, &frame, sizeof(int));
+			memcpy(record + 4, color, sizeof(float) * 3);
+			memcpy(record + 16, position, sizeof(float) * 3);
+		}
+
+		void Write(oguna::BinaryWriter *writer) const
 		{
-			stream->read((char*) &frame, sizeof(int));
-			stream->read((char*) color, sizeof(float) * 3);
-			stream->read((char*) position, sizeof(float) * 3);
+			Pack(writer->Append(28));
 		}
 
-		void Write(std::ostream* stream)
+		void Write(std::ostream* stream) const
 		{
-			stream->write((char*)&frame, sizeof(int));
-			stream->write((char*)color, sizeof(float) * 3);
-			stream->write((char*)position, sizeof(float) * 3);
+			char record[28];
+			Pack(record);
+			stream->write(record, sizeof(record));
 		}
 	};
 
@@ -155,35 +224,39 @@ namespace vmd
 		bool display;
 		std::vector<VmdIkEnable> ik_enable;
 
-		void Read(std::istream *stream)
+		void Read(oguna::BinaryReader *reader)
 		{
-			char buffer[20];
-			stream->read((char*) &frame, sizeof(int));
-			stream->read((char*) &display, sizeof(uint8_t));
-			int ik_count;
-			stream->read((char*) &ik_count, sizeof(int));
+			frame = reader->Read<int>();
+			display = reader->Read<uint8_t>() != 0;
+			int ik_count = reader->Read<int>();
 			ik_enable.resize(ik_count);
 			for (int i = 0; i < ik_count; i++)
 			{
-				stream->read(buffer, 20);
-				ik_enable[i].ik_name = std::string(buffer);
-				stream->read((char*) &ik_enable[i].enable, sizeof(uint8_t));
+				ik_enable[i].ik_name = reader->ReadFixedString(20);
+				ik_enable[i].enable = reader->Read<uint8_t>() != 0;
 			}
 		}
 
-		void Write(std::ostream *stream)
+		void Write(oguna::BinaryWriter *writer) const
 		{
-			stream->write((char*)&frame, sizeof(int));
-			stream->write((char*)&display, sizeof(uint8_t));
 			int ik_count = static_cast<int>(ik_enable.size());
-			stream->write((char*)&ik_count, sizeof(int));
+			char *record = writer->Append(9 + 21 * ik_count);
+			memcpy(record, &frame, sizeof(int));
+			record[4] = display ? 1 : 0;
+			memcpy(record + 5, &ik_count, sizeof(int));
 			for (int i = 0; i < ik_count; i++)
 			{
-				const VmdIkEnable& ik_enable = this->ik_enable.at(i);
-				stream->write(ik_enable.ik_name.c_str(), 20);
-				stream->write((char*)&ik_enable.enable, sizeof(uint8_t));
+				char *ik = record + 9 + 21 * i;
+				PackFixedString(ik, ik_enable[i].ik_name, 20);
+				ik[20] = ik_enable[i].enable ? 1 : 0;
 			}
 		}
+
+		void Write(std::ostream *stream) const
+		{
+			oguna::BinaryWriter writer(stream, 9 + 21 * ik_enable.size());
+			Write(&writer);
+		}
 	};
 
 	/// VMD[V
@@ -207,154 +280,205 @@ namespace vmd
 
 		static std::unique_ptr<VmdMotion> LoadFromFile(char const *filename)
 		{
-			std::ifstream stream(filename, std::ios::binary);
-			auto result = LoadFromStream(&stream);
-			stream.close();
-			return result;
+			oguna::MappedFile file;
+			if (!file.Open(filename))
+			{
+				std::cerr << "could not open \"" << filename << "\"" << std::endl;
+				return nullptr;
+			}
+			oguna::BinaryReader reader(file.Data(), file.Size());
+			return LoadFromReader(&reader);
 		}
 
 		static std::unique_ptr<VmdMotion> LoadFromStream(std::ifstream *stream)
 		{
+			oguna::BinaryReader reader(stream);
+			return LoadFromReader(&reader);
+		}
 
-			char buffer[30];
-			auto result = std::make_unique<VmdMotion>();
-
-			// magic and version
-			stream->read((char*) buffer, 30);
-			if (strncmp(buffer, "Vocaloid Motion Data", 20))
+		static std::unique_ptr<VmdMotion> LoadFromReader(oguna::BinaryReader *reader)
+		{
+			try
 			{
-				std::cerr << "invalid vmd file." << std::endl;
+				return ReadMotion(reader);
+			}
+			catch (const char *message)
+			{
+				std::cerr << message << std::endl;
 				return nullptr;
 			}
-			result->version = std::atoi(buffer + 20);
-
-			// name
-			stream->read(buffer, 20);
-			result->model_name = std::string(buffer);
+		}
 
-			// bone frames
-			int bone_frame_num;
-			stream->read((char*) &bone_frame_num, sizeof(int));
-			result->bone_frames.resize(bone_frame_num);
-			for (int i = 0; i < bone_frame_num; i++)
+		bool SaveToFile(const char *filename) const
+		{
+			std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+			if (!stream)
 			{
-				result->bone_frames[i].Read(stream);
+				std::cerr << "could not open \"" << filename << "\"" << std::endl;
+				return false;
 			}
+			return SaveToStream(&stream);
+		}
 
-			// face frames
-			int face_frame_num;
-			stream->read((char*) &face_frame_num, sizeof(int));
-			result->face_frames.resize(face_frame_num);
-			for (int i = 0; i < face_frame_num; i++)
+		bool SaveToFile(const std::u16string& filename) const
+		{
+#ifdef _WIN32
+			std::ofstream stream((const wchar_t*) filename.c_str(), std::ios::binary | std::ios::trunc);
+			if (!stream)
 			{
-				result->face_frames[i].Read(stream);
+				return false;
 			}
+			return SaveToStream(&stream);
+#else
+			// WindowsȊOłUTF8̃pXƂĊJ
+			std::wstring wide;
+			std::string path;
+			oguna::EncodingConverter::Utf16LeToUtf16((const char*) filename.data(), (int) (filename.size() * sizeof(char16_t)), &wide);
+			oguna::EncodingConverter::Utf16ToUtf8(wide.data(), (int) wide.size(), &path);
+			return SaveToFile(path.c_str());
+#endif
+		}
+
+		/// Œ蒷R[h傫ȃobt@ɋl߁A܂Ƃ߂ăXg[֏o
+		bool SaveToStream(std::ostream *stream) const
+		{
+			oguna::BinaryWriter writer(stream, 1 << 20);
+			Write(&writer);
+			return writer.Flush();
+		}
+
+		/// 
+		void Write(oguna::BinaryWriter *writer) const
+		{
+			// magic and version
+			writer->WriteFixedString("Vocaloid Motion Data 0002", 30);
+
+			// name
+			writer->WriteFixedString(model_name, 20);
+
+			// bone frames
+			WriteRecords(writer, bone_frames, 111);
+
+			// face frames
+			WriteRecords(writer, face_frames, 23);
 
 			// camera frames
-			int camera_frame_num;
-			stream->read((char*) &camera_frame_num, sizeof(int));
-			result->camera_frames.resize(camera_frame_num);
-			for (int i = 0; i < camera_frame_num; i++)
-			{
-				result->camera_frames[i].Read(stream);
-			}
+			WriteRecords(writer, camera_frames, 63);
 
 			// light frames
-			int light_frame_num;
-			stream->read((char*) &light_frame_num, sizeof(int));
-			result->light_frames.resize(light_frame_num);
-			for (int i = 0; i < light_frame_num; i++)
-			{
-				result->light_frames[i].Read(stream);
-			}
+			WriteRecords(writer, light_frames, 28);
 
-			// unknown2
-			stream->read(buffer, 4);
+			// self shadow datas
+			writer->Write<int>(0);
 
 			// ik frames
-			if (stream->peek() != std::ios::traits_type::eof())
-			{
-				int ik_num;
-				stream->read((char*) &ik_num, sizeof(int));
-				result->ik_frames.resize(ik_num);
-				for (int i = 0; i < ik_num; i++)
-				{
-					result->ik_frames[i].Read(stream);
-				}
-			}
-
-			if (stream->peek() != std::ios::traits_type::eof())
+			writer->Write(static_cast<int>(ik_frames.size()));
+			for (const VmdIkFrame &frame : ik_frames)
 			{
-				std::cerr << "vmd stream has unknown data." << std::endl;
+				frame.Write(writer);
 			}
+		}
 
-			return result;
+		/// ̃[Vꂼ̃t@C֕ɏo(ׂĐtrue)
+		static bool SaveToFiles(const std::vector<const VmdMotion*> &motions, const std::vector<std::string> &filenames)
+		{
+			int count = (int) std::min(motions.size(), filenames.size());
+			std::vector<char> succeeded(count, 0);
+			oguna::ThreadPool::Shared().Run(count, [&](int i) {
+				succeeded[i] = motions[i]->SaveToFile(filenames[i].c_str()) ? 1 : 0;
+			});
+			return motions.size() == filenames.size() && std::find(succeeded.begin(), succeeded.end(), 0) == succeeded.end();
 		}
 
-		bool SaveToFile(const std::u16string& filename)
+	private:
+		/// vfƌŒ蒷̃R[h(萔obt@ɂ܂Ƃ߂ċl߂)
+		template<typename T>
+		static void WriteRecords(oguna::BinaryWriter *writer, const std::vector<T> &frames, size_t record_size)
 		{
-			std::ofstream stream(filename.c_str(), std::ios::binary);
-			auto result = SaveToStream(&stream);
-			stream.close();
-			return result;
+			const size_t chunk = 4096;
+			writer->Write(static_cast<int>(frames.size()));
+			for (size_t begin = 0; begin < frames.size(); begin += chunk)
+			{
+				size_t end = std::min(begin + chunk, frames.size());
+				char *out = writer->Append(record_size * (end - begin));
+				for (size_t i = begin; i < end; i++)
+				{
+					frames[i].Pack(out + record_size * (i - begin));
+				}
+			}
 		}
 
-		bool SaveToStream(std::ofstream *stream)
+		static std::unique_ptr<VmdMotion> ReadMotion(oguna::BinaryReader *reader)
 		{
-			std::string magic = "Vocaloid Motion Data 0002\0";
-			magic.resize(30);
+			auto result = std::make_unique<VmdMotion>();
 
 			// magic and version
-			stream->write(magic.c_str(), 30);
+			const char *magic = reader->View(30);
+			if (strncmp(magic, "Vocaloid Motion Data", 20))
+			{
+				std::cerr << "invalid vmd file." << std::endl;
+				return nullptr;
+			}
+			result->version = std::atoi(std::string(magic + 20, 10).c_str());
 
 			// name
-			stream->write(model_name.c_str(), 20);
+			result->model_name = reader->ReadFixedString(20);
 
 			// bone frames
-			const int bone_frame_num = static_cast<int>(bone_frames.size());
-			stream->write(reinterpret_cast<const char*>(&bone_frame_num), sizeof(int));
+			int bone_frame_num = reader->Read<int>();
+			result->bone_frames.resize(bone_frame_num);
 			for (int i = 0; i < bone_frame_num; i++)
 			{
-				bone_frames[i].Write(stream);
+				result->bone_frames[i].Read(reader);
 			}
 
 			// face frames
-			const int face_frame_num = static_cast<int>(face_frames.size());
-			stream->write(reinterpret_cast<const char*>(&face_frame_num), sizeof(int));
+			int face_frame_num = reader->Read<int>();
+			result->face_frames.resize(face_frame_num);
 			for (int i = 0; i < face_frame_num; i++)
 			{
-				face_frames[i].Write(stream);
+				result->face_frames[i].Read(reader);
 			}
 
 			// camera frames
-			const int camera_frame_num = static_cast<int>(camera_frames.size());
-			stream->write(reinterpret_cast<const char*>(&camera_frame_num), sizeof(int));
+			int camera_frame_num = reader->Read<int>();
+			result->camera_frames.resize(camera_frame_num);
 			for (int i = 0; i < camera_frame_num; i++)
 			{
-				camera_frames[i].Write(stream);
+				result->camera_frames[i].Read(reader);
 			}
 
 			// light frames
-			const int light_frame_num = static_cast<int>(light_frames.size());
-			stream->write(reinterpret_cast<const char*>(&light_frame_num), sizeof(int));
+			int light_frame_num = reader->Read<int>();
+			result->light_frames.resize(light_frame_num);
 			for (int i = 0; i < light_frame_num; i++)
 			{
-				light_frames[i].Write(stream);
+				result->light_frames[i].Read(reader);
 			}
 
-			// self shadow datas
-			const int self_shadow_num = 0;
-			stream->write(reinterpret_cast<const char*>(&self_shadow_num), sizeof(int));
+			// unknown2
+			if (!reader->Eof())
+			{
+				reader->Skip(4);
+			}
 
 			// ik frames
-			const int ik_num = static_cast<int>(ik_frames.size());
-			stream->write(reinterpret_cast<const char*>(&ik_num), sizeof(int));
-			for (int i = 0; i < ik_num; i++)
+			if (!reader->Eof())
+			{
+				int ik_num = reader->Read<int>();
+				result->ik_frames.resize(ik_num);
+				for (int i = 0; i < ik_num; i++)
+				{
+					result->ik_frames[i].Read(reader);
+				}
+			}
+
+			if (!reader->Eof())
 			{
-				ik_frames[i].Write(stream);
+				std::cerr << "vmd stream has unknown data." << std::endl;
 			}
 
-			return true;
+			return result;
 		}
 	};
 }
\ No newline at end of file
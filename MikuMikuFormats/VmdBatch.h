@@ -0,0 +1,316 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "VmdTrack.h"
+#include "VmdSampler.h"
+#include "SimdHelper.h"
+
+namespace vmd
+{
+	/// ̎̕p(gbN̕тVmdTrackMotionƓ)
+	class VmdPose
+	{
+	public:
+		/// {[̈ʒu(gbN*3)
+		std::vector<float> positions;
+		/// {[̉](gbN*4)
+		std::vector<float> orientations;
+		/// \̏d(gbN)
+		std::vector<float> face_weights;
+
+		/// [ṼgbNɍ킹(傫ȂmۂȂ)
+		void Resize(const VmdTrackMotion &motion)
+		{
+			positions.resize(motion.BoneTrackCount() * 3);
+			orientations.resize(motion.BoneTrackCount() * 4);
+			face_weights.resize(motion.FaceTrackCount());
+		}
+	};
+
+	/// p߂郂[Vƃt[
+	struct VmdPoseRequest
+	{
+		const VmdTrackMotion *motion;
+		float frame;
+	};
+
+	/// ̃LN^[̎p܂Ƃ߂ċ߂
+	/// v[Vƃt[ŕבւA[Vœt[̗v͈x߂Ďʂ
+	/// {[\AgbNƂɏd̂Ȃt[ׂĕׁA(gbN, t[)̑gSIMD̕(AVX28AȊO4)W߂
+	/// ̃[̑g͓gbN̕ʂ̃LN^[ɂȂ̂ŁAL[̒T̓gbÑJ[\瑱Đi݁AL[ƋȐ̕\𑱂ēǂ
+	/// ʒu̐`ԂƉ]̋ʐ`Ԃ͕̕܂Ƃ߂ČvZ
+	/// Ɨ̈g񂷂̂ŁAXbhƂɈpӂČJԂg
+	class VmdBatchEvaluator
+	{
+	public:
+		static const int Width = oguna::FloatLanes::Width;
+
+		VmdBatchEvaluator()
+			: lane_count(0)
+		{}
+
+		/// requests[i]̎pposes[i]ɋ߂
+		void Evaluate(const VmdPoseRequest *requests, int count, VmdPose *poses)
+		{
+			order.resize(count);
+			for (int i = 0; i < count; i++)
+			{
+				order[i] = i;
+			}
+			auto less = [requests](int a, int b)
+			{
+				if (requests[a].motion != requests[b].motion)
+				{
+					return requests[a].motion < requests[b].motion;
+				}
+				return requests[a].frame < requests[b].frame;
+			};
+			// t[œn邱Ƃ̂ŁAłΕבւȂ
+			if (!std::is_sorted(order.begin(), order.end(), less))
+			{
+				std::sort(order.begin(), order.end(), less);
+			}
+
+			int group = 0;
+			while (group < count)
+			{
+				const VmdTrackMotion *motion = requests[order[group]].motion;
+				frames.clear();
+				targets.clear();
+				duplicates.clear();
+				int end = group;
+				for (; end < count && requests[order[end]].motion == motion; end++)
+				{
+					int index = order[end];
+					poses[index].Resize(*motion);
+					if (end > group && requests[index].frame == frames.back())
+					{
+						duplicates.push_back(std::make_pair(index, targets.back()));
+					}
+					else
+					{
+						frames.push_back(requests[index].frame);
+						targets.push_back(index);
+					}
+				}
+				EvaluateBones(*motion, poses);
+				EvaluateFaces(*motion, poses);
+				for (auto &duplicate : duplicates)
+				{
+					const VmdPose &source = poses[duplicate.second];
+					VmdPose &destination = poses[duplicate.first];
+					std::copy(source.positions.begin(), source.positions.end(), destination.positions.begin());
+					std::copy(source.orientations.begin(), source.orientations.end(), destination.orientations.begin());
+					std::copy(source.face_weights.begin(), source.face_weights.end(), destination.face_weights.begin());
+				}
+				group = end;
+			}
+		}
+
+	private:
+		/// v̕я
+		std::vector<int> order;
+		/// [V̗v̏d̂Ȃt[()
+		std::vector<float> frames;
+		/// framešʂޗv
+		std::vector<int> targets;
+		/// (ʂ, ʂ)
+		std::vector<std::pair<int, int>> duplicates;
+
+		/// SIMDŌvZ(gbN, t[)̑g
+		int lane_count;
+		float lane_p0[3][Width];
+		float lane_p1[3][Width];
+		float lane_q0[4][Width];
+		float lane_q1[4][Width];
+		float lane_t[4][Width];
+		float *lane_position[Width];
+		float *lane_orientation[Width];
+
+		void EvaluateBones(const VmdTrackMotion &motion, VmdPose *poses)
+		{
+			const uint32_t *key_frames = motion.bone_key_frames.data();
+			lane_count = 0;
+			for (int track = 0; track < motion.BoneTrackCount(); track++)
+			{
+				int begin = motion.bone_key_offsets[track];
+				int end = motion.bone_key_offsets[track + 1];
+				int cursor = begin;
+				for (size_t i = 0; i < frames.size(); i++)
+				{
+					VmdPose &pose = poses[targets[i]];
+					float frame = frames[i];
+					float *position = &pose.positions[track * 3];
+					float *orientation = &pose.orientations[track * 4];
+					if (begin == end)
+					{
+						// L[̂ȂgbN
+						position[0] = position[1] = position[2] = 0.0f;
+						orientation[0] = orientation[1] = orientation[2] = 0.0f;
+						orientation[3] = 1.0f;
+						continue;
+					}
+					// frames͏Ȃ̂őÕt[̃L[T
+					int key = VmdMotionSampler::FindKey(key_frames, begin, end, frame, cursor);
+					cursor = key;
+					const float *p0 = &motion.bone_key_positions[key * 3];
+					const float *q0 = &motion.bone_key_orientations[key * 4];
+					float frame0 = (float) key_frames[key];
+					if (key + 1 == end || frame <= frame0)
+					{
+						// ԂȂgbN̓[ɓꂸɂ̂܂܎ʂ
+						memcpy(position, p0, sizeof(float) * 3);
+						memcpy(orientation, q0, sizeof(float) * 4);
+						continue;
+					}
+					int next = key + 1;
+					float t = (frame - frame0) / ((float) key_frames[next] - frame0);
+					const int *curve = &motion.bone_key_curves[next * 4];
+					float eased[4];
+					for (int channel = 0; channel < 4; channel++)
+					{
+						// Ȑg`l͕]Ȃ
+						eased[channel] = channel > 0 && curve[channel] == curve[channel - 1] ? eased[channel - 1] : motion.curves.Evaluate(curve[channel], t);
+					}
+					AddBoneLane(p0, &motion.bone_key_positions[next * 3], q0, &motion.bone_key_orientations[next * 4], eased, position, orientation);
+				}
+			}
+			if (lane_count > 0)
+			{
+				// 󂢂Ă郌[͍Ō̃[̒lŖ߂
+				for (int lane = lane_count; lane < Width; lane++)
+				{
+					int last = lane_count - 1;
+					for (int c = 0; c < 3; c++)
+					{
+						lane_p0[c][lane] = lane_p0[c][last];
+						lane_p1[c][lane] = lane_p1[c][last];
+					}
+					for (int c = 0; c < 4; c++)
+					{
+						lane_q0[c][lane] = lane_q0[c][last];
+						lane_q1[c][lane] = lane_q1[c][last];
+						lane_t[c][lane] = lane_t[c][last];
+					}
+				}
+				FlushBoneLanes();
+			}
+		}
+
+		void AddBoneLane(const float *p0, const float *p1, const float *q0, const float *q1, const float *eased, float *position, float *orientation)
+		{
+			int lane = lane_count;
+			for (int c = 0; c < 3; c++)
+			{
+				lane_p0[c][lane] = p0[c];
+				lane_p1[c][lane] = p1[c];
+			}
+			for (int c = 0; c < 4; c++)
+			{
+				lane_q0[c][lane] = q0[c];
+				lane_q1[c][lane] = q1[c];
+				lane_t[c][lane] = eased[c];
+			}
+			lane_position[lane] = position;
+			lane_orientation[lane] = orientation;
+			if (++lane_count == Width)
+			{
+				FlushBoneLanes();
+			}
+		}
+
+		/// W߂[܂Ƃ߂ĕԂď
+		void FlushBoneLanes()
+		{
+			typedef oguna::FloatLanes Lanes;
+			float result[7][Width];
+			for (int c = 0; c < 3; c++)
+			{
+				Lanes p0 = Lanes::Load(lane_p0[c]);
+				(p0 + (Lanes::Load(lane_p1[c]) - p0) * Lanes::Load(lane_t[c])).Store(result[c]);
+			}
+
+			Lanes q0[4], q1[4];
+			for (int c = 0; c < 4; c++)
+			{
+				q0[c] = Lanes::Load(lane_q0[c]);
+				q1[c] = Lanes::Load(lane_q1[c]);
+			}
+			Lanes dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+			Lanes weight_a, weight_b;
+			oguna::SlerpWeights(dot, Lanes::Load(lane_t[3]), &weight_a, &weight_b);
+			for (int c = 0; c < 4; c++)
+			{
+				(q0[c] * weight_a + q1[c] * weight_b).Store(result[3 + c]);
+			}
+
+			for (int lane = 0; lane < lane_count; lane++)
+			{
+				float *position = lane_position[lane];
+				float *orientation = lane_orientation[lane];
+				for (int c = 0; c < 3; c++)
+				{
+					position[c] = result[c][lane];
+				}
+				for (int c = 0; c < 4; c++)
+				{
+					orientation[c] = result[3 + c][lane];
+				}
+			}
+			lane_count = 0;
+		}
+
+		/// \͐`Ԃ[ƂɌvZ
+		void EvaluateFaces(const VmdTrackMotion &motion, VmdPose *poses)
+		{
+			typedef oguna::FloatLanes Lanes;
+			const uint32_t *key_frames = motion.face_key_frames.data();
+			const float *weights = motion.face_key_weights.data();
+			float w0[Width], w1[Width], t[Width], result[Width];
+			float *outputs[Width];
+			int count = 0;
+			for (int track = 0; track < motion.FaceTrackCount(); track++)
+			{
+				int begin = motion.face_key_offsets[track];
+				int end = motion.face_key_offsets[track + 1];
+				int cursor = begin;
+				for (size_t i = 0; i < frames.size(); i++)
+				{
+					float frame = frames[i];
+					outputs[count] = &poses[targets[i]].face_weights[track];
+					t[count] = 0.0f;
+					if (begin == end)
+					{
+						w0[count] = w1[count] = 0.0f;
+					}
+					else
+					{
+						int key = VmdMotionSampler::FindKey(key_frames, begin, end, frame, cursor);
+						cursor = key;
+						float frame0 = (float) key_frames[key];
+						w0[count] = w1[count] = weights[key];
+						if (key + 1 < end && frame > frame0)
+						{
+							w1[count] = weights[key + 1];
+							t[count] = (frame - frame0) / ((float) key_frames[key + 1] - frame0);
+						}
+					}
+					if (++count == Width || (track + 1 == motion.FaceTrackCount() && i + 1 == frames.size()))
+					{
+						for (int lane = count; lane < Width; lane++)
+						{
+							w0[lane] = w1[lane] = t[lane] = 0.0f;
+						}
+						Lanes a = Lanes::Load(w0);
+						(a + (Lanes::Load(w1) - a) * Lanes::Load(t)).Store(result);
+						for (int lane = 0; lane < count; lane++)
+						{
+							*outputs[lane] = result[lane];
+						}
+						count = 0;
+					}
+				}
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,723 @@
+#pragma once
+#include <math.h>
+#include <array>
+#include <map>
+#include "VmdTrack.h"
+#include "VmdSampler.h"
+#include "MathHelper.h"
+
+namespace vmd
+{
+	/// gbNƂ̃L[̃t[ԍAÕL[Ƃ̍(16bit)Ŏ
+	/// L[BlockSize(16bitɎ܂ȂƂ͂)܂Ƃ܂ƂA܂Ƃ܂̐擪t[ԍ̂܂܎
+	/// ܂Ƃ܂̐擪̃L[̍0ɂĂ(gbÑL[̃t[ԍ͏dȂȂ̂ŁAȊO̍1ȏ)
+	class VmdPackedFrames
+	{
+	public:
+		/// ܂Ƃ܂肠̃L[̐
+		static const int BlockSize = 16;
+
+		/// ǂݐi߂ʒu
+		struct Cursor
+		{
+			/// L[̔ԍ
+			int key;
+			/// L[̃t[ԍ
+			uint32_t frame;
+			/// L[܂Ƃ܂
+			int block;
+		};
+
+		/// ܂Ƃ܂̐擪
+		struct Block
+		{
+			uint32_t frame;
+			int key;
+		};
+
+		/// ÕL[Ƃ̍(L[)
+		std::vector<uint16_t> deltas;
+		/// ܂Ƃ܂
+		std::vector<Block> blocks;
+		/// gbNƂ̂܂Ƃ܂̊Jnʒu(gbN+1)
+		std::vector<int> block_offsets;
+
+		/// gbNƂ̃L[̊Jnʒuoffsetsƃt[ԍframesgݗĂ
+		void Build(const std::vector<int> &offsets, const std::vector<uint32_t> &frames)
+		{
+			deltas.resize(frames.size());
+			blocks.clear();
+			block_offsets.assign(1, 0);
+			for (size_t t = 0; t + 1 < offsets.size(); t++)
+			{
+				int block_begin = 0;
+				for (int k = offsets[t]; k < offsets[t + 1]; k++)
+				{
+					uint32_t delta = k > offsets[t] ? frames[k] - frames[k - 1] : 0;
+					if (k == offsets[t] || k - block_begin >= BlockSize || delta > 0xFFFF)
+					{
+						Block block;
+						block.frame = frames[k];
+						block.key = k;
+						blocks.push_back(block);
+						block_begin = k;
+						delta = 0;
+					}
+					deltas[k] = (uint16_t) delta;
+				}
+				block_offsets.push_back((int) blocks.size());
+			}
+		}
+
+		/// gbNtrack̐擪̃L[w(L[Ȃkeyend)
+		Cursor Begin(int track, int end) const
+		{
+			Cursor cursor;
+			cursor.block = block_offsets[track];
+			cursor.key = end;
+			cursor.frame = 0;
+			if (cursor.block < block_offsets[track + 1])
+			{
+				cursor.key = blocks[cursor.block].key;
+				cursor.frame = blocks[cursor.block].frame;
+			}
+			return cursor;
+		}
+
+		/// cursor̎̃L[̃t[ԍ(cursor.key + 1 < endł邱)
+		uint32_t NextFrame(const Cursor &cursor) const
+		{
+			uint16_t delta = deltas[cursor.key + 1];
+			return delta ? cursor.frame + delta : blocks[cursor.block + 1].frame;
+		}
+
+		/// ̃L[֐i߂
+		void Advance(Cursor *cursor) const
+		{
+			uint16_t delta = deltas[cursor->key + 1];
+			cursor->key++;
+			if (delta)
+			{
+				cursor->frame += delta;
+			}
+			else
+			{
+				cursor->block++;
+				cursor->frame = blocks[cursor->block].frame;
+			}
+		}
+
+		/// gbNtrack([begin, end))frameȉ̍Ō̃L[cursor𓮂(擪OȂ擪)
+		/// framecursorȂ炻̂܂ܓǂݐi߁AOȂ܂Ƃ܂񕪒T
+		void Seek(int track, int end, float frame, Cursor *cursor) const
+		{
+			if (cursor->key >= end)
+			{
+				return;
+			}
+			if ((float) cursor->frame > frame)
+			{
+				int low = block_offsets[track];
+				int high = block_offsets[track + 1];
+				while (low < high)
+				{
+					int middle = (low + high) / 2;
+					if ((float) blocks[middle].frame <= frame)
+					{
+						low = middle + 1;
+					}
+					else
+					{
+						high = middle;
+					}
+				}
+				cursor->block = low > block_offsets[track] ? low - 1 : block_offsets[track];
+				cursor->key = blocks[cursor->block].key;
+				cursor->frame = blocks[cursor->block].frame;
+			}
+			while (cursor->key + 1 < end && (float) NextFrame(*cursor) <= frame)
+			{
+				Advance(cursor);
+			}
+		}
+	};
+
+	/// 풓Ă߂̈k[V
+	/// {[̃L[̓t[ԍ(16bit)AʒugbNƂ͈̔͂ŗʎq16bit*3A
+	/// ]ő̐3(smallest three)48bitAԋȐȐ̑g̔ԍ(16bit)ŎA
+	/// lςȂgbN̓L[Ƃ̈ʒuE]Ȃ
+	/// \̃L[̓t[ԍ̍ƁAgbNƂ͈̔͂ŗʎq16bit̏d݂Ŏ
+	/// JECgEIK̓L[Ȃ̂VmdTrackMotionƓ`Ŏ
+	/// ʎq̌덷͈ʒuEd݂gbN͈̔͂1/131070A]̊e2.2e-5x
+	class VmdCompressedMotion
+	{
+	public:
+		/// {[gbN̗ʎq͈̔
+		struct BoneTrack
+		{
+			/// ʒu̍ŏlƍ(ʒuςȂgbNł͍ŏl̒lō݂0)
+			float position_min[3];
+			float position_step[3];
+			/// ʒuE]ςȂgbN̉]
+			float orientation[4];
+			/// bone_key_positions̊Jnʒu(ʒuςȂ-1)
+			int position_offset;
+			/// bone_key_orientations̊Jnʒu(]ςȂ-1)
+			int orientation_offset;
+		};
+
+		/// \gbN̗ʎq͈̔
+		struct FaceTrack
+		{
+			float weight_min;
+			float weight_step;
+		};
+
+		VmdCompressedMotion()
+			: version(0)
+			, curves(&own_curves)
+			, own_name_pool(std::make_shared<oguna::StringPool>())
+			, name_pool(own_name_pool.get())
+		{}
+
+		VmdCompressedMotion(const VmdCompressedMotion&) = delete;
+		VmdCompressedMotion& operator=(const VmdCompressedMotion&) = delete;
+
+		/// f
+		std::string model_name;
+		/// o[W
+		int version;
+
+		/// {[NamePool()̔ԍ(gbN)
+		oguna::StringIdList bone_names;
+		/// {[gbNƂ̃L[̊Jnʒu(gbN+1)
+		std::vector<int> bone_key_offsets;
+		/// {[gbN̗ʎq͈̔(gbN)
+		std::vector<BoneTrack> bone_tracks;
+		/// t[ԍ
+		VmdPackedFrames bone_key_frames;
+		/// ʎqʒu(ʒuςgbÑL[*3)
+		std::vector<uint16_t> bone_key_positions;
+		/// smallest threeŋl߂](]ςgbÑL[*3)
+		std::vector<uint16_t> bone_key_orientations;
+		/// ԋȐ̑g̔ԍ(L[)
+		std::vector<uint16_t> bone_key_curve_sets;
+		/// ԋȐ̑g(g̐*4AX, Y, Z, ]̋Ȑԍ)
+		std::vector<int> curve_sets;
+
+		/// \NamePool()̔ԍ(gbN)
+		oguna::StringIdList face_names;
+		/// \gbNƂ̃L[̊Jnʒu(gbN+1)
+		std::vector<int> face_key_offsets;
+		/// \gbN̗ʎq͈̔(gbN)
+		std::vector<FaceTrack> face_tracks;
+		/// t[ԍ
+		VmdPackedFrames face_key_frames;
+		/// ʎqd(L[)
+		std::vector<uint16_t> face_key_weights;
+
+		/// Jt[(t[ԍ)
+		std::vector<VmdCameraFrame> camera_frames;
+		/// J̕ԋȐ̔ԍ(t[*6)
+		std::vector<int> camera_key_curves;
+		/// Cgt[(t[ԍ)
+		std::vector<VmdLightFrame> light_frames;
+		/// IKt[(t[ԍ)
+		std::vector<VmdIkFrame> ik_frames;
+
+		/// {[gbN
+		int BoneTrackCount() const
+		{
+			return bone_names.Count();
+		}
+
+		/// \gbN
+		int FaceTrackCount() const
+		{
+			return face_names.Count();
+		}
+
+		/// Oo^Ă\(k̃[VƓ)
+		oguna::StringPool* NamePool() const
+		{
+			return name_pool;
+		}
+
+		/// gbNt̃{[(NamePool()j܂ŗL)
+		oguna::StringView BoneName(int t) const
+		{
+			return name_pool->View(bone_names.Id(t));
+		}
+
+		/// gbNt̕\
+		oguna::StringView FaceName(int t) const
+		{
+			return name_pool->View(face_names.Id(t));
+		}
+
+		/// {[gbNԍ(Ȃ-1)
+		int FindBoneTrack(const std::string &name) const
+		{
+			return FindBoneTrackById(name_pool->Find(name));
+		}
+
+		/// \gbNԍ(Ȃ-1)
+		int FindFaceTrack(const std::string &name) const
+		{
+			return FindFaceTrackById(name_pool->Find(name));
+		}
+
+		/// {[ƕ\poolɓo^AȌpool̔ԍŎ
+		/// poolɖOo^fƂ́AׂɔԍŃgbNΉt
+		void InternNames(oguna::StringPool *pool)
+		{
+			bone_names.Reintern(*name_pool, pool);
+			face_names.Reintern(*name_pool, pool);
+			name_pool = pool;
+			own_name_pool.reset();
+		}
+
+		/// NamePool()̔ԍ{[gbN(Ȃ-1)
+		int FindBoneTrackById(uint32_t name_id) const
+		{
+			return bone_names.Find(name_id);
+		}
+
+		/// NamePool()̔ԍ\gbN(Ȃ-1)
+		int FindFaceTrackById(uint32_t name_id) const
+		{
+			return face_names.Find(name_id);
+		}
+
+		/// ԋȐ̕\
+		const VmdCurveTable& Curves() const
+		{
+			return *curves;
+		}
+
+		/// L[ƕ\gĂoCg(L̋Ȑ̕\ƁAOo^Ă\͊܂߂Ȃ)
+		size_t MemorySize() const
+		{
+			size_t size = sizeof(*this);
+			size += bone_names.MemorySize() + face_names.MemorySize();
+			size += bone_key_offsets.size() * sizeof(int) + bone_tracks.size() * sizeof(BoneTrack)
+				+ FramesSize(bone_key_frames) + bone_key_positions.size() * sizeof(uint16_t)
+				+ bone_key_orientations.size() * sizeof(uint16_t) + bone_key_curve_sets.size() * sizeof(uint16_t)
+				+ curve_sets.size() * sizeof(int)
+				+ face_key_offsets.size() * sizeof(int) + face_tracks.size() * sizeof(FaceTrack)
+				+ FramesSize(face_key_frames) + face_key_weights.size() * sizeof(uint16_t)
+				+ camera_frames.size() * sizeof(VmdCameraFrame) + camera_key_curves.size() * sizeof(int)
+				+ light_frames.size() * sizeof(VmdLightFrame) + ik_frames.size() * sizeof(VmdIkFrame);
+			if (curves == &own_curves)
+			{
+				size += own_curves.MemorySize();
+			}
+			return size;
+		}
+
+		/// VmdTrackMotionk
+		/// shared_curvesnƕԋȐ̕\ɓo^ĕ̃[VŋL
+		/// (\͈k[V蒷ێAo^͑̃Xbh]Ȃ)
+		/// Ȑ̑g65536𒴂ꍇnullptrԂ
+		static std::unique_ptr<VmdCompressedMotion> Compress(const VmdTrackMotion &motion, VmdCurveTable *shared_curves = nullptr)
+		{
+			auto result = std::make_unique<VmdCompressedMotion>();
+			result->own_name_pool = motion.own_name_pool;
+			result->name_pool = motion.name_pool;
+			result->model_name = motion.model_name;
+			result->version = motion.version;
+			if (shared_curves)
+			{
+				result->curves = shared_curves;
+			}
+			else
+			{
+				result->own_curves = motion.curves;
+			}
+			// ̋Ȑԍ爳k̕\̔ԍւ̑Ή
+			std::vector<int> curve_map(motion.curves.Count());
+			for (int i = 0; i < motion.curves.Count(); i++)
+			{
+				const uint8_t *c = motion.curves.Control(i);
+				curve_map[i] = shared_curves ? shared_curves->Add(c[0], c[1], c[2], c[3]) : i;
+			}
+
+			if (!result->CompressBones(motion, curve_map))
+			{
+				std::cerr << "too many interpolation curves" << std::endl;
+				return nullptr;
+			}
+			result->CompressFaces(motion);
+
+			result->camera_frames = motion.camera_frames;
+			result->camera_key_curves.resize(motion.camera_key_curves.size());
+			for (size_t i = 0; i < motion.camera_key_curves.size(); i++)
+			{
+				result->camera_key_curves[i] = curve_map[motion.camera_key_curves[i]];
+			}
+			result->light_frames = motion.light_frames;
+			result->ik_frames = motion.ik_frames;
+			return result;
+		}
+
+		/// {[̃L[keÿʒu߂
+		void DecodePosition(int track, int key, float *position) const
+		{
+			const BoneTrack &info = bone_tracks[track];
+			if (info.position_offset < 0)
+			{
+				memcpy(position, info.position_min, sizeof(float) * 3);
+				return;
+			}
+			const uint16_t *q = &bone_key_positions[(info.position_offset + key - bone_key_offsets[track]) * 3];
+			for (int i = 0; i < 3; i++)
+			{
+				position[i] = info.position_min[i] + (float) q[i] * info.position_step[i];
+			}
+		}
+
+		/// {[̃L[keỷ]߂
+		void DecodeOrientation(int track, int key, float *orientation) const
+		{
+			const BoneTrack &info = bone_tracks[track];
+			if (info.orientation_offset < 0)
+			{
+				memcpy(orientation, info.orientation, sizeof(float) * 4);
+				return;
+			}
+			UnpackQuaternion(&bone_key_orientations[(info.orientation_offset + key - bone_key_offsets[track]) * 3], orientation);
+		}
+
+		/// \̃L[key̏d݂߂
+		float DecodeWeight(int track, int key) const
+		{
+			const FaceTrack &info = face_tracks[track];
+			return info.weight_min + (float) face_key_weights[key] * info.weight_step;
+		}
+
+		/// ]ő̐348bitɋl߂
+		/// ő̐ɂȂ悤ɕ낦Ac[-1/2, 1/2]15bitŎA2bitɍő̐̔ԍ
+		static void PackQuaternion(const float *orientation, uint16_t *packed)
+		{
+			float q[4];
+			memcpy(q, orientation, sizeof(q));
+			oguna::QuaternionNormalize(q);
+			int largest = 0;
+			for (int i = 1; i < 4; i++)
+			{
+				if (fabsf(q[i]) > fabsf(q[largest]))
+				{
+					largest = i;
+				}
+			}
+			float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+			uint64_t bits = (uint64_t) largest << 45;
+			for (int i = 0, slot = 0; i < 4; i++)
+			{
+				if (i == largest)
+				{
+					continue;
+				}
+				float value = q[i] * sign * SquareRoot2;
+				value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+				uint64_t quantized = (uint64_t) floorf((value + 1.0f) * 0.5f * QuaternionScale + 0.5f);
+				bits |= quantized << (slot * 15);
+				slot++;
+			}
+			packed[0] = (uint16_t) bits;
+			packed[1] = (uint16_t) (bits >> 16);
+			packed[2] = (uint16_t) (bits >> 32);
+		}
+
+		/// PackQuaternionŋl߂]߂
+		static void UnpackQuaternion(const uint16_t *packed, float *orientation)
+		{
+			uint64_t bits = (uint64_t) packed[0] | ((uint64_t) packed[1] << 16) | ((uint64_t) packed[2] << 32);
+			int largest = (int) (bits >> 45) & 3;
+			float sum = 0.0f;
+			for (int i = 0, slot = 0; i < 4; i++)
+			{
+				if (i == largest)
+				{
+					continue;
+				}
+				float value = ((float) ((bits >> (slot * 15)) & 0x7FFF) * (2.0f / QuaternionScale) - 1.0f) * (1.0f / SquareRoot2);
+				orientation[i] = value;
+				sum += value * value;
+				slot++;
+			}
+			orientation[largest] = sqrtf(std::max(0.0f, 1.0f - sum));
+		}
+
+	private:
+		static constexpr float SquareRoot2 = 1.41421356f;
+		static constexpr float QuaternionScale = 32767.0f;
+
+		/// ŐȐ̕\
+		VmdCurveTable own_curves;
+		/// gȐ̕\(own_curvesL̕\)
+		const VmdCurveTable *curves;
+		/// k̃[VƋL鎩O̖O̕\(L̕\gƂnullptr)
+		std::shared_ptr<oguna::StringPool> own_name_pool;
+		/// Oo^Ă\
+		oguna::StringPool *name_pool;
+
+		static size_t FramesSize(const VmdPackedFrames &frames)
+		{
+			return frames.deltas.size() * sizeof(uint16_t) + frames.blocks.size() * sizeof(VmdPackedFrames::Block) + frames.block_offsets.size() * sizeof(int);
+		}
+
+		/// l͈̔͂ʎq̍ŏlƍ݂߂
+		static void QuantizeRange(float min_value, float max_value, float *minimum, float *step)
+		{
+			*minimum = min_value;
+			*step = max_value > min_value ? (max_value - min_value) / 65535.0f : 0.0f;
+		}
+
+		static uint16_t Quantize(float value, float minimum, float step)
+		{
+			if (step <= 0.0f)
+			{
+				return 0;
+			}
+			float q = floorf((value - minimum) / step + 0.5f);
+			return (uint16_t) (q < 0.0f ? 0.0f : (q > 65535.0f ? 65535.0f : q));
+		}
+
+		bool CompressBones(const VmdTrackMotion &motion, const std::vector<int> &curve_map)
+		{
+			bone_names = motion.bone_names;
+			bone_key_offsets = motion.bone_key_offsets;
+			bone_key_frames.Build(motion.bone_key_offsets, motion.bone_key_frames);
+			bone_tracks.resize(bone_names.Count());
+			bone_key_positions.clear();
+			bone_key_orientations.clear();
+			for (int t = 0; t < BoneTrackCount(); t++)
+			{
+				BoneTrack &info = bone_tracks[t];
+				int begin = bone_key_offsets[t];
+				int end = bone_key_offsets[t + 1];
+				float lower[3] = { 0.0f, 0.0f, 0.0f };
+				float upper[3] = { 0.0f, 0.0f, 0.0f };
+				bool moves = false;
+				bool turns = false;
+				for (int k = begin; k < end; k++)
+				{
+					const float *p = &motion.bone_key_positions[k * 3];
+					for (int i = 0; i < 3; i++)
+					{
+						lower[i] = k == begin ? p[i] : std::min(lower[i], p[i]);
+						upper[i] = k == begin ? p[i] : std::max(upper[i], p[i]);
+					}
+					turns = turns || memcmp(&motion.bone_key_orientations[k * 4], &motion.bone_key_orientations[begin * 4], sizeof(float) * 4) != 0;
+				}
+				for (int i = 0; i < 3; i++)
+				{
+					QuantizeRange(lower[i], upper[i], &info.position_min[i], &info.position_step[i]);
+					moves = moves || info.position_step[i] > 0.0f;
+				}
+				info.orientation[0] = info.orientation[1] = info.orientation[2] = 0.0f;
+				info.orientation[3] = 1.0f;
+				if (begin < end)
+				{
+					memcpy(info.orientation, &motion.bone_key_orientations[begin * 4], sizeof(float) * 4);
+				}
+				info.position_offset = moves ? (int) (bone_key_positions.size() / 3) : -1;
+				info.orientation_offset = turns ? (int) (bone_key_orientations.size() / 3) : -1;
+				for (int k = begin; k < end; k++)
+				{
+					if (moves)
+					{
+						const float *p = &motion.bone_key_positions[k * 3];
+						for (int i = 0; i < 3; i++)
+						{
+							bone_key_positions.push_back(Quantize(p[i], info.position_min[i], info.position_step[i]));
+						}
+					}
+					if (turns)
+					{
+						uint16_t packed[3];
+						PackQuaternion(&motion.bone_key_orientations[k * 4], packed);
+						bone_key_orientations.insert(bone_key_orientations.end(), packed, packed + 3);
+					}
+				}
+			}
+			bone_key_positions.shrink_to_fit();
+			bone_key_orientations.shrink_to_fit();
+
+			// 4`l̋Ȑ̑g܂Ƃ߂
+			std::map<std::array<int, 4>, int> set_index;
+			curve_sets.clear();
+			bone_key_curve_sets.resize(motion.bone_key_frames.size());
+			for (size_t k = 0; k < bone_key_curve_sets.size(); k++)
+			{
+				std::array<int, 4> set;
+				for (int channel = 0; channel < 4; channel++)
+				{
+					set[channel] = curve_map[motion.bone_key_curves[k * 4 + channel]];
+				}
+				auto inserted = set_index.emplace(set, (int) set_index.size());
+				if (inserted.second)
+				{
+					if (inserted.first->second > 0xFFFF)
+					{
+						return false;
+					}
+					curve_sets.insert(curve_sets.end(), set.begin(), set.end());
+				}
+				bone_key_curve_sets[k] = (uint16_t) inserted.first->second;
+			}
+			return true;
+		}
+
+		void CompressFaces(const VmdTrackMotion &motion)
+		{
+			face_names = motion.face_names;
+			face_key_offsets = motion.face_key_offsets;
+			face_key_frames.Build(motion.face_key_offsets, motion.face_key_frames);
+			face_tracks.resize(face_names.Count());
+			face_key_weights.resize(motion.face_key_weights.size());
+			for (int t = 0; t < FaceTrackCount(); t++)
+			{
+				int begin = face_key_offsets[t];
+				int end = face_key_offsets[t + 1];
+				if (begin == end)
+				{
+					face_tracks[t].weight_min = face_tracks[t].weight_step = 0.0f;
+					continue;
+				}
+				auto range = std::minmax_element(motion.face_key_weights.begin() + begin, motion.face_key_weights.begin() + end);
+				QuantizeRange(*range.first, *range.second, &face_tracks[t].weight_min, &face_tracks[t].weight_step);
+				for (int k = begin; k < end; k++)
+				{
+					face_key_weights[k] = Quantize(motion.face_key_weights[k], face_tracks[t].weight_min, face_tracks[t].weight_step);
+				}
+			}
+		}
+	};
+
+	/// VmdCompressedMotionCӂ̃t[̒lAWJɒڋ߂
+	/// VmdMotionSamplerƓAgbNƂɑÕL[oĂAt[ɐi߂Đł̓t[ԍ̍𑫂ēǂݐi߂
+	class VmdCompressedSampler
+	{
+	public:
+		explicit VmdCompressedSampler(const VmdCompressedMotion *motion)
+			: motion(motion)
+		{
+			Reset();
+		}
+
+		/// Ώۂ̃[V
+		const VmdCompressedMotion* Motion() const
+		{
+			return motion;
+		}
+
+		/// oĂL[擪ɖ߂
+		void Reset()
+		{
+			bone_cursors.resize(motion->BoneTrackCount());
+			for (int t = 0; t < motion->BoneTrackCount(); t++)
+			{
+				bone_cursors[t] = motion->bone_key_frames.Begin(t, motion->bone_key_offsets[t + 1]);
+			}
+			face_cursors.resize(motion->FaceTrackCount());
+			for (int t = 0; t < motion->FaceTrackCount(); t++)
+			{
+				face_cursors[t] = motion->face_key_frames.Begin(t, motion->face_key_offsets[t + 1]);
+			}
+			camera_cursor = 0;
+		}
+
+		/// {[gbNtrackframeł̈ʒuƉ]߂
+		void SampleBone(int track, float frame, float *position, float *orientation)
+		{
+			int end = motion->bone_key_offsets[track + 1];
+			VmdPackedFrames::Cursor &cursor = bone_cursors[track];
+			motion->bone_key_frames.Seek(track, end, frame, &cursor);
+			if (cursor.key == end)
+			{
+				// L[̂ȂgbN
+				position[0] = position[1] = position[2] = 0.0f;
+				orientation[0] = orientation[1] = orientation[2] = 0.0f;
+				orientation[3] = 1.0f;
+				return;
+			}
+			motion->DecodePosition(track, cursor.key, position);
+			motion->DecodeOrientation(track, cursor.key, orientation);
+			if (cursor.key + 1 == end || frame <= (float) cursor.frame)
+			{
+				return;
+			}
+			int next = cursor.key + 1;
+			float frame1 = (float) motion->bone_key_frames.NextFrame(cursor);
+			float t = (frame - (float) cursor.frame) / (frame1 - (float) cursor.frame);
+			const int *curve = &motion->curve_sets[motion->bone_key_curve_sets[next] * 4];
+			const VmdCurveTable &curves = motion->Curves();
+			float p1[3], q0[4];
+			motion->DecodePosition(track, next, p1);
+			for (int channel = 0; channel < 3; channel++)
+			{
+				position[channel] = oguna::Lerp(position[channel], p1[channel], curves.Evaluate(curve[channel], t));
+			}
+			if (motion->bone_tracks[track].orientation_offset >= 0)
+			{
+				float q1[4];
+				memcpy(q0, orientation, sizeof(q0));
+				motion->DecodeOrientation(track, next, q1);
+				oguna::QuaternionSlerp(q0, q1, curves.Evaluate(curve[3], t), orientation);
+			}
+		}
+
+		/// \gbNtrackframeł̏d݂߂
+		float SampleFace(int track, float frame)
+		{
+			int end = motion->face_key_offsets[track + 1];
+			VmdPackedFrames::Cursor &cursor = face_cursors[track];
+			motion->face_key_frames.Seek(track, end, frame, &cursor);
+			if (cursor.key == end)
+			{
+				return 0.0f;
+			}
+			float weight = motion->DecodeWeight(track, cursor.key);
+			if (cursor.key + 1 == end || frame <= (float) cursor.frame)
+			{
+				return weight;
+			}
+			float frame1 = (float) motion->face_key_frames.NextFrame(cursor);
+			float t = (frame - (float) cursor.frame) / (frame1 - (float) cursor.frame);
+			return oguna::Lerp(weight, motion->DecodeWeight(track, cursor.key + 1), t);
+		}
+
+		/// frameł̃J߂(distance, position, orientation, angleݒ肷)
+		void SampleCamera(float frame, VmdCameraFrame *camera)
+		{
+			camera_cursor = VmdMotionSampler::SampleCameraAt(motion->camera_frames, motion->camera_key_curves, motion->Curves(), frame, camera, camera_cursor);
+		}
+
+		/// S{[gbN̒l߂(positions̓gbN*3Aorientations̓gbN*4)
+		void SampleBones(float frame, float *positions, float *orientations)
+		{
+			for (int track = 0; track < motion->BoneTrackCount(); track++)
+			{
+				SampleBone(track, frame, positions + track * 3, orientations + track * 4);
+			}
+		}
+
+		/// S\gbN̏d݂߂(weights̓gbN)
+		void SampleFaces(float frame, float *weights)
+		{
+			for (int track = 0; track < motion->FaceTrackCount(); track++)
+			{
+				weights[track] = SampleFace(track, frame);
+			}
+		}
+
+	private:
+		const VmdCompressedMotion *motion;
+		/// gbNƂ̑ÕL[
+		std::vector<VmdPackedFrames::Cursor> bone_cursors;
+		std::vector<VmdPackedFrames::Cursor> face_cursors;
+		int camera_cursor;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,194 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+#include "BakedCache.h"
+
+namespace vmd
+{
+	/// VMD̕ԋȐ(_0`127)OvZ\ŕ]
+	/// _̋Ȑ͈ɂ܂Ƃ߂
+	///
+	/// eȐ̓p[^t𓙊ԊuSegmentCount_(x, y)Axɑ΂l܂ŋߎ
+	/// t𓙊ԊuɎ̂ŐڐɂȂȐł덷}
+	/// _̑S͈͂ŌƂ̍1e-3(悭gɂ₩ȋȐł1e-5x)
+	/// x1 == y1x2 == y2̋Ȑ͒Ȃ̂ŕ\ɂ̂܂ܕԂ
+	class VmdCurveTable
+	{
+	public:
+		/// Ȑ{̕
+		static const int SegmentCount = 256;
+		/// xԂ߂̍̕
+		static const int IndexCount = 256;
+		/// ̋Ȑԍ
+		static const int LinearCurve = 0;
+
+		VmdCurveTable()
+		{
+			Clear();
+		}
+
+		/// ׂĂ̋Ȑ폜(c)
+		void Clear()
+		{
+			curves.assign(1, Curve());
+			points.clear();
+			segment_index.clear();
+			curve_index.clear();
+		}
+
+		/// Ȑo^ĔԍԂ
+		int Add(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
+		{
+			if (x1 == y1 && x2 == y2)
+			{
+				return LinearCurve;
+			}
+			uint32_t key = ((uint32_t) x1 << 24) | ((uint32_t) y1 << 16) | ((uint32_t) x2 << 8) | (uint32_t) y2;
+			auto found = curve_index.find(key);
+			if (found != curve_index.end())
+			{
+				return found->second;
+			}
+			Curve curve;
+			curve.points = (int) points.size();
+			curve.segment_index = (int) segment_index.size();
+			curve.control[0] = x1;
+			curve.control[1] = y1;
+			curve.control[2] = x2;
+			curve.control[3] = y2;
+
+			// B(t) = 3(1-t)^2 t p1 + 3(1-t) t^2 p2 + t^3
+			double cx1 = x1 / 127.0, cy1 = y1 / 127.0, cx2 = x2 / 127.0, cy2 = y2 / 127.0;
+			points.resize(points.size() + (SegmentCount + 1) * 2);
+			float *p = &points[curve.points];
+			float last_x = 0.0f;
+			for (int i = 0; i <= SegmentCount; i++)
+			{
+				double t = (double) i / SegmentCount;
+				double s = 1.0 - t;
+				float x = (float) (3.0 * s * s * t * cx1 + 3.0 * s * t * t * cx2 + t * t * t);
+				float y = (float) (3.0 * s * s * t * cy1 + 3.0 * s * t * t * cy2 + t * t * t);
+				// ۂߌ덷x߂Ȃ悤ɂ
+				last_x = x < last_x ? last_x : x;
+				p[i * 2] = last_x;
+				p[i * 2 + 1] = y;
+			}
+
+			// iɂx = i / IndexCount܂ދԂ
+			segment_index.resize(segment_index.size() + IndexCount + 1);
+			uint16_t *index = &segment_index[curve.segment_index];
+			int segment = 0;
+			for (int i = 0; i <= IndexCount; i++)
+			{
+				float x = (float) i / IndexCount;
+				while (segment < SegmentCount - 1 && p[(segment + 1) * 2] <= x)
+				{
+					segment++;
+				}
+				index[i] = (uint16_t) segment;
+			}
+
+			int id = (int) curves.size();
+			curves.push_back(curve);
+			curve_index.emplace(key, id);
+			return id;
+		}
+
+		/// Ȑcurvex(0`1)ɑ΂l߂
+		float Evaluate(int curve, float x) const
+		{
+			if (curve == LinearCurve || x <= 0.0f || x >= 1.0f)
+			{
+				return x <= 0.0f ? 0.0f : (x >= 1.0f ? 1.0f : x);
+			}
+			const Curve &c = curves[curve];
+			const float *p = &points[c.points];
+			int segment = segment_index[c.segment_index + (int) (x * IndexCount)];
+			while (segment < SegmentCount - 1 && p[(segment + 1) * 2] <= x)
+			{
+				segment++;
+			}
+			const float *a = p + segment * 2;
+			float width = a[2] - a[0];
+			float f = width > 0.0f ? (x - a[0]) / width : 0.0f;
+			return a[1] + (a[3] - a[1]) * f;
+		}
+
+		/// Ȑcurve̐_(0`127)
+		const uint8_t* Control(int curve) const
+		{
+			return curves[curve].control;
+		}
+
+		/// o^ĂȐ̐(܂)
+		int Count() const
+		{
+			return (int) curves.size();
+		}
+
+		/// \gĂoCg
+		size_t MemorySize() const
+		{
+			return curves.size() * sizeof(Curve) + points.size() * sizeof(float) + segment_index.size() * sizeof(uint16_t);
+		}
+
+		/// LbVɐidid+2Ƃď
+		void Bake(oguna::BakedWriter *writer, uint32_t id) const
+		{
+			writer->Add(id, curves);
+			writer->Add(id + 1, points);
+			writer->Add(id + 2, segment_index);
+		}
+
+		/// LbV\Rs[A_̍蒼
+		bool LoadBaked(const oguna::BakedFile &file, uint32_t id)
+		{
+			if (!file.Read(id, &curves) || !file.Read(id + 1, &points) || !file.Read(id + 2, &segment_index) || curves.empty())
+			{
+				Clear();
+				return false;
+			}
+			curve_index.clear();
+			for (size_t i = 1; i < curves.size(); i++)
+			{
+				const uint8_t *c = curves[i].control;
+				if ((size_t) curves[i].points + (SegmentCount + 1) * 2 > points.size() || (size_t) curves[i].segment_index + IndexCount + 1 > segment_index.size())
+				{
+					Clear();
+					return false;
+				}
+				curve_index.emplace(((uint32_t) c[0] << 24) | ((uint32_t) c[1] << 16) | ((uint32_t) c[2] << 8) | (uint32_t) c[3], (int) i);
+			}
+			return true;
+		}
+
+	private:
+		struct Curve
+		{
+			Curve()
+				: points(0)
+				, segment_index(0)
+			{
+				control[0] = control[1] = 0;
+				control[2] = control[3] = 127;
+			}
+
+			/// points̊Jnʒu
+			int points;
+			/// segment_index̊Jnʒu
+			int segment_index;
+			/// _
+			uint8_t control[4];
+		};
+
+		std::vector<Curve> curves;
+		/// SȐ(x, y)̗
+		std::vector<float> points;
+		/// SȐ̋Ԃ̍
+		std::vector<uint16_t> segment_index;
+		/// _Ȑԍւ̍
+		std::unordered_map<uint32_t, int> curve_index;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,725 @@
+#pragma once
+#include <math.h>
+#include <algorithm>
+#include <unordered_map>
+#include "Vmd.h"
+#include "VmdCurve.h"
+#include "MathHelper.h"
+#include "ThreadPool.h"
+
+namespace vmd
+{
+	/// L[t[팸̋e덷
+	class VmdReduceOption
+	{
+	public:
+		VmdReduceOption()
+			: position_tolerance(0.01f)
+			, rotation_tolerance(0.002f)
+			, face_tolerance(0.005f)
+			, camera_angle_tolerance(0.05f)
+			, fit_curves(true)
+		{}
+
+		/// ʒůe̋e덷({[ƃJ̈ʒuAJ̋)
+		float position_tolerance;
+		/// ]̋e덷(WAA{[͉]̊pxAJ̓IC[p̊e)
+		float rotation_tolerance;
+		/// \̏d݂̋e덷
+		float face_tolerance;
+		/// J̎p̋e덷(x)
+		float camera_angle_tolerance;
+		/// falseȂԋȐ𓖂Ă͂ߒAŕ\Ԃ팸
+		bool fit_curves;
+	};
+
+	/// VmdMotioñL[t[e덷͈̔͂ō팸
+	/// gbNƂɁAcL[{̕ԋȐŕ\łL[T({Xɉ΂Ă񕪒T)A
+	/// Ԃ̃L[폜ĕԋȐ𓖂Ă͂ߒ
+	/// 덷͌̃[V𐮐t[Ƃɕ]lƂ̍ő
+	/// ԋȐ͍Đ(VmdSampler)ƓVmdCurveTableŕ]A\̋ߎ덷܂߂ċe덷Ɏ߂
+	/// {[ƕ\̓gbNƂoguna::ThreadPool::Shared()ŕɏ
+	/// 팸̃L[̓gbNƂɃt[ԍɕсAgbNœt[ԍ̃L[̓t@CŌ̂̂c
+	class VmdKeyReducer
+	{
+	public:
+		/// {[E\EJ̃L[팸
+		static void Reduce(VmdMotion *motion, const VmdReduceOption &option = VmdReduceOption())
+		{
+			ReduceBones(&motion->bone_frames, option);
+			ReduceFaces(&motion->face_frames, option);
+			ReduceCameras(&motion->camera_frames, option);
+		}
+
+		/// {[̃L[팸
+		static void ReduceBones(std::vector<VmdBoneFrame> *frames, const VmdReduceOption &option)
+		{
+			std::vector<std::vector<VmdBoneFrame>> tracks = SplitTracks(*frames, [](const VmdBoneFrame &frame) -> const std::string& { return frame.name; });
+			oguna::ThreadPool::Shared().Run((int) tracks.size(), [&](int i) {
+				Context context;
+				ReduceBoneTrack(&tracks[i], option, &context);
+			});
+			frames->clear();
+			for (auto &track : tracks)
+			{
+				frames->insert(frames->end(), track.begin(), track.end());
+			}
+		}
+
+		/// \̃L[팸(\͐`ԂȂ̂ŋȐ͓Ă͂߂Ȃ)
+		static void ReduceFaces(std::vector<VmdFaceFrame> *frames, const VmdReduceOption &option)
+		{
+			std::vector<std::vector<VmdFaceFrame>> tracks = SplitTracks(*frames, [](const VmdFaceFrame &frame) -> const std::string& { return frame.face_name; });
+			oguna::ThreadPool::Shared().Run((int) tracks.size(), [&](int i) {
+				ReduceFaceTrack(&tracks[i], option);
+			});
+			frames->clear();
+			for (auto &track : tracks)
+			{
+				frames->insert(frames->end(), track.begin(), track.end());
+			}
+		}
+
+		/// J̃L[팸
+		static void ReduceCameras(std::vector<VmdCameraFrame> *frames, const VmdReduceOption &option)
+		{
+			static const std::string camera;
+			std::vector<std::vector<VmdCameraFrame>> tracks = SplitTracks(*frames, [](const VmdCameraFrame&) -> const std::string& { return camera; });
+			frames->clear();
+			if (!tracks.empty())
+			{
+				Context context;
+				ReduceCameraTrack(&tracks[0], option, &context);
+				frames->swap(tracks[0]);
+			}
+		}
+
+	private:
+		/// ̕ԋȐ(MMD̊l)
+		static const uint8_t* LinearControl()
+		{
+			static const uint8_t control[4] = { 20, 20, 107, 107 };
+			return control;
+		}
+
+		/// Ɨ̈
+		struct Context
+		{
+			/// ԓ̐t[̈ʒu(0`1)
+			std::vector<float> t;
+			/// ԓ̐t[ł̌̒l(`l)
+			std::vector<float> values[7];
+			/// Ă͂߂ɎgKl
+			std::vector<float> normalized;
+			/// Ă͂߂ԋȐ(`lƂx1, y1, x2, y2)
+			uint8_t curves[6][4];
+			/// ŌɐĂ͂߂̕ԋȐ
+			uint8_t accepted[6][4];
+			/// ĐƓ]ɎgԋȐ̕\(gbNƂɍ)
+			VmdCurveTable table;
+
+			Context()
+			{
+				for (auto &curve : curves)
+				{
+					memcpy(curve, LinearControl(), 4);
+				}
+			}
+
+			/// ԋȐxɑ΂lĐƓ\ŋ߂
+			float Evaluate(const uint8_t *control, float x)
+			{
+				return table.Evaluate(table.Add(control[0], control[1], control[2], control[3]), x);
+			}
+		};
+
+		/// OƂɃgbN֕At[ԍɕׂēt[ԍ̃L[͌̂̂c
+		template<typename T, typename Name>
+		static std::vector<std::vector<T>> SplitTracks(const std::vector<T> &frames, Name name)
+		{
+			std::unordered_map<std::string, int> track_of;
+			std::vector<std::vector<T>> tracks;
+			for (const T &frame : frames)
+			{
+				auto inserted = track_of.emplace(name(frame), (int) tracks.size());
+				if (inserted.second)
+				{
+					tracks.emplace_back();
+				}
+				tracks[inserted.first->second].push_back(frame);
+			}
+			for (auto &track : tracks)
+			{
+				std::stable_sort(track.begin(), track.end(), [](const T &a, const T &b) { return a.frame < b.frame; });
+				size_t count = 0;
+				for (size_t i = 0; i < track.size(); i++)
+				{
+					if (count > 0 && track[count - 1].frame == track[i].frame)
+					{
+						track[count - 1] = track[i];
+					}
+					else
+					{
+						track[count++] = track[i];
+					}
+				}
+				track.resize(count);
+			}
+			return tracks;
+		}
+
+		/// 擪̃L[珇ɁAԂŕ\łL[IŎc
+		/// cL[Ƃkeep(OɎcL[, L[)Ă(擪̃L[ł͒ÕL[-1)
+		/// Ԃ̃L[蒷ƂAkeep̎_łfitsŌɐĂяőԂ̂̂ɂȂ
+		template<typename Fits, typename Keep>
+		static void SelectKeys(int count, Fits fits, Keep keep)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+			keep(-1, 0);
+			int anchor = 0;
+			while (anchor < count - 1)
+			{
+				int good = anchor + 1;
+				int bad = count;
+				for (int step = 1; good + step < count; step *= 2)
+				{
+					if (!fits(anchor, good + step))
+					{
+						bad = good + step;
+						break;
+					}
+					good += step;
+				}
+				while (bad - good > 1)
+				{
+					int middle = (good + bad) / 2;
+					if (fits(anchor, middle))
+					{
+						good = middle;
+					}
+					else
+					{
+						bad = middle;
+					}
+				}
+				keep(anchor, good);
+				anchor = good;
+			}
+		}
+
+		/// ԋȐxɑ΂l(x1 == y1x2 == y2Ȃ璼)
+		static float Ease(const uint8_t *control, float x)
+		{
+			if (control[0] == control[1] && control[2] == control[3])
+			{
+				return x;
+			}
+			return oguna::BezierEase(control[0] / 127.0f, control[1] / 127.0f, control[2] / 127.0f, control[3] / 127.0f, x);
+		}
+
+		/// Ȑcontrolŕ\Ƃ̌덷̍ől(limit𒴂ł؂)
+		static float EaseError(const uint8_t *control, const float *t, const float *s, int count, float scale, float limit)
+		{
+			float error = 0.0f;
+			for (int i = 0; i < count && error <= limit; i++)
+			{
+				error = std::max(error, fabsf(Ease(control, t[i]) - s[i]) * scale);
+			}
+			return error;
+		}
+
+		/// (t[i], s[i])덷scale * |y(t) - s|toleranceȉŒʂԋȐ߂
+		/// ŕ\Ȃ΁A_xiqɑIyŏ@ŋ߁Ał悢̂琧_ċl߂
+		/// controlɂ͒OɓĂ͂߂Ȑn(߂ԂȂTɂ̂܂܎g)
+		static bool FitEase(const float *t, const float *s, int count, float scale, float tolerance, bool fit_curves, uint8_t *control)
+		{
+			uint8_t previous[4];
+			memcpy(previous, control, 4);
+			memcpy(control, LinearControl(), 4);
+			float best = EaseError(control, t, s, count, scale, tolerance);
+			if (best <= tolerance)
+			{
+				return true;
+			}
+			if (!fit_curves)
+			{
+				return false;
+			}
+			if (EaseError(previous, t, s, count, scale, tolerance) <= tolerance)
+			{
+				memcpy(control, previous, 4);
+				return true;
+			}
+			// _0`1̋Ȑ0`1͈̔͂Ɏ܂̂ŁA͂ݏo_ΓĂ͂߂܂łȂ
+			float margin = tolerance / scale;
+			for (int i = 0; i < count; i++)
+			{
+				if (s[i] < -margin || s[i] > 1.0f + margin)
+				{
+					return false;
+				}
+			}
+			best = EaseError(control, t, s, count, scale, INFINITY);
+			static const uint8_t grid[] = { 0, 32, 64, 96, 127 };
+			for (uint8_t x1 : grid)
+			{
+				for (uint8_t x2 : grid)
+				{
+					// xBezier̃p[^߂ƁAy͐_y1, y2ɂĐ`ɂȂ
+					double a = 0.0, b = 0.0, c = 0.0, r1 = 0.0, r2 = 0.0;
+					for (int i = 0; i < count; i++)
+					{
+						double u = SolveBezierParameter(x1 / 127.0f, x2 / 127.0f, t[i]);
+						double v = 1.0 - u;
+						double b1 = 3.0 * v * v * u;
+						double b2 = 3.0 * v * u * u;
+						double rest = s[i] - u * u * u;
+						a += b1 * b1;
+						b += b1 * b2;
+						c += b2 * b2;
+						r1 += b1 * rest;
+						r2 += b2 * rest;
+					}
+					double det = a * c - b * b;
+					if (fabs(det) < 1e-12)
+					{
+						continue;
+					}
+					double y1 = (r1 * c - r2 * b) / det;
+					double y2 = (a * r2 - b * r1) / det;
+					uint8_t candidate[4] = { x1, Quantize(y1), x2, Quantize(y2) };
+					float error = EaseError(candidate, t, s, count, scale, best);
+					if (error < best)
+					{
+						best = error;
+						memcpy(control, candidate, 4);
+					}
+				}
+			}
+			for (int step = 16; step > 0 && best > tolerance; step /= 2)
+			{
+				bool improved = true;
+				while (improved && best > tolerance)
+				{
+					improved = false;
+					for (int p = 0; p < 4; p++)
+					{
+						for (int sign = -1; sign <= 1; sign += 2)
+						{
+							uint8_t candidate[4];
+							memcpy(candidate, control, 4);
+							candidate[p] = (uint8_t) std::min(127, std::max(0, candidate[p] + sign * step));
+							float error = EaseError(candidate, t, s, count, scale, best);
+							if (error < best)
+							{
+								best = error;
+								memcpy(control, candidate, 4);
+								improved = true;
+							}
+						}
+					}
+				}
+			}
+			return best <= tolerance;
+		}
+
+		/// 0`1̒l𐧌_(0`127)ɂ
+		static uint8_t Quantize(double value)
+		{
+			return (uint8_t) std::min(127.0, std::max(0.0, floor(value * 127.0 + 0.5)));
+		}
+
+		/// x(u) = xƂȂBezier̃p[^u
+		/// _y0, 1/3, 2/3, 1ɂy(u) = uɂȂ̂ŁABezierEasẻ̂܂܎g
+		static float SolveBezierParameter(float x1, float x2, float x)
+		{
+			return oguna::BezierEase(x1, 1.0f / 3.0f, x2, 2.0f / 3.0f, x);
+		}
+
+		/// lv0v1ւ̕Ԃvalues[i]덷toleranceȉŕ\ԋȐ߂
+		/// Ȑ͌ȒlŒTA\ŕ]Ăe덷Ɏ܂邱Ƃm߂
+		static bool FitChannel(Context *context, const float *values, float v0, float v1, float tolerance, bool fit_curves, uint8_t *control)
+		{
+			int count = (int) context->t.size();
+			float delta = v1 - v0;
+			if (fabsf(delta) < 1e-6f)
+			{
+				memcpy(control, LinearControl(), 4);
+				for (int i = 0; i < count; i++)
+				{
+					if (fabsf(values[i] - v0) > tolerance)
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+			context->normalized.resize(count);
+			for (int i = 0; i < count; i++)
+			{
+				context->normalized[i] = (values[i] - v0) / delta;
+			}
+			if (!FitEase(context->t.data(), context->normalized.data(), count, fabsf(delta), tolerance, fit_curves, control))
+			{
+				return false;
+			}
+			for (int i = 0; i < count; i++)
+			{
+				if (fabsf(context->Evaluate(control, context->t[i]) - context->normalized[i]) * fabsf(delta) > tolerance)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/// l̉]̊px(WA)
+		static float RotationAngle(const float *a, const float *b)
+		{
+			double dot = (double) a[0] * b[0] + (double) a[1] * b[1] + (double) a[2] * b[2] + (double) a[3] * b[3];
+			double sign = dot < 0.0 ? -1.0 : 1.0;
+			double distance = 0.0;
+			for (int i = 0; i < 4; i++)
+			{
+				double d = a[i] - sign * b[i];
+				distance += d * d;
+			}
+			// |a - b| = 2 sin(angle / 4)
+			return (float) (4.0 * asin(std::min(1.0, sqrt(distance) * 0.5)));
+		}
+
+		/// ԋȐ64oCg̕тɏ(1`3sڂ0sڂ1oCg炵)
+		static void StoreBoneInterpolation(const uint8_t (*curves)[4], char *interpolation)
+		{
+			uint8_t row[16];
+			for (int channel = 0; channel < 4; channel++)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					row[i * 4 + channel] = curves[channel][i];
+				}
+			}
+			for (int r = 0; r < 4; r++)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					interpolation[r * 16 + i] = (char) (i + r < 16 ? row[i + r] : 0);
+				}
+			}
+		}
+
+		static void ReduceBoneTrack(std::vector<VmdBoneFrame> *track, const VmdReduceOption &option, Context *context)
+		{
+			std::vector<VmdBoneFrame> &keys = *track;
+			int count = (int) keys.size();
+			for (auto &key : keys)
+			{
+				oguna::QuaternionNormalize(key.orientation);
+			}
+			// ̃L[̕ԋȐ(X, Y, Z, ])̕\ł̔ԍ
+			std::vector<int> original(count * 4);
+			for (int k = 0; k < count; k++)
+			{
+				for (int channel = 0; channel < 4; channel++)
+				{
+					const uint8_t (*row)[4] = (const uint8_t (*)[4]) keys[k].interpolation[0];
+					original[k * 4 + channel] = context->table.Add(row[0][channel], row[1][channel], row[2][channel], row[3][channel]);
+				}
+			}
+
+			// ̃L[kk + 1̊Ԃframeł̒l
+			auto sample = [&](int k, int frame, float *position, float *orientation) {
+				const VmdBoneFrame &p = keys[k];
+				const VmdBoneFrame &q = keys[k + 1];
+				float x = (float) (frame - p.frame) / (float) (q.frame - p.frame);
+				for (int channel = 0; channel < 3; channel++)
+				{
+					float eased = context->table.Evaluate(original[(k + 1) * 4 + channel], x);
+					position[channel] = oguna::Lerp(p.position[channel], q.position[channel], eased);
+				}
+				oguna::QuaternionSlerp(p.orientation, q.orientation, context->table.Evaluate(original[(k + 1) * 4 + 3], x), orientation);
+			};
+
+			auto fits = [&](int a, int b) -> bool {
+				const VmdBoneFrame &first = keys[a];
+				const VmdBoneFrame &last = keys[b];
+				float length = (float) (last.frame - first.frame);
+				context->t.clear();
+				for (int channel = 0; channel < 7; channel++)
+				{
+					context->values[channel].clear();
+				}
+				// ̃L[ŋԓ̐t[]
+				int k = a;
+				for (int frame = first.frame + 1; frame < last.frame; frame++)
+				{
+					while (keys[k + 1].frame <= frame)
+					{
+						k++;
+					}
+					float position[3];
+					float orientation[4];
+					sample(k, frame, position, orientation);
+					context->t.push_back((float) (frame - first.frame) / length);
+					for (int channel = 0; channel < 3; channel++)
+					{
+						context->values[channel].push_back(position[channel]);
+					}
+					for (int i = 0; i < 4; i++)
+					{
+						context->values[3 + i].push_back(orientation[i]);
+					}
+				}
+				for (int channel = 0; channel < 3; channel++)
+				{
+					if (!FitChannel(context, context->values[channel].data(), first.position[channel], last.position[channel], option.position_tolerance, option.fit_curves, context->curves[channel]))
+					{
+						return false;
+					}
+				}
+				// ]͌ʂ̏̈ʒu𓖂Ă͂߂ĂAۂ̊pxm߂
+				int samples = (int) context->t.size();
+				float theta = RotationAngle(first.orientation, last.orientation);
+				std::vector<float> &s = context->normalized;
+				s.resize(samples);
+				for (int i = 0; i < samples; i++)
+				{
+					float q[4] = { context->values[3][i], context->values[4][i], context->values[5][i], context->values[6][i] };
+					if (theta < 1e-6f)
+					{
+						s[i] = 0.0f;
+						continue;
+					}
+					float a0 = RotationAngle(first.orientation, q);
+					float a1 = RotationAngle(q, last.orientation);
+					s[i] = (theta + a0 - a1) / (2.0f * theta);
+				}
+				uint8_t *rotation = context->curves[3];
+				if (theta < 1e-6f)
+				{
+					memcpy(rotation, LinearControl(), 4);
+				}
+				else if (!FitEase(context->t.data(), s.data(), samples, theta, option.rotation_tolerance, option.fit_curves, rotation))
+				{
+					return false;
+				}
+				for (int i = 0; i < samples; i++)
+				{
+					float q[4] = { context->values[3][i], context->values[4][i], context->values[5][i], context->values[6][i] };
+					float fitted[4];
+					oguna::QuaternionSlerp(first.orientation, last.orientation, context->Evaluate(rotation, context->t[i]), fitted);
+					if (RotationAngle(fitted, q) > option.rotation_tolerance)
+					{
+						return false;
+					}
+				}
+				memcpy(context->accepted, context->curves, sizeof(context->curves));
+				return true;
+			};
+
+			std::vector<VmdBoneFrame> reduced;
+			SelectKeys(count, fits, [&](int previous, int k) {
+				reduced.push_back(keys[k]);
+				if (previous >= 0 && k > previous + 1)
+				{
+					StoreBoneInterpolation(context->accepted, &reduced.back().interpolation[0][0][0]);
+				}
+			});
+			// ̃L[ƁÅԂ̐t[̒lׂčŏ̃L[狖e덷ȂAL[ɂ
+			auto near_first = [&](const float *position, const float *orientation) {
+				for (int channel = 0; channel < 3; channel++)
+				{
+					if (fabsf(position[channel] - keys[0].position[channel]) > option.position_tolerance)
+					{
+						return false;
+					}
+				}
+				return RotationAngle(orientation, keys[0].orientation) <= option.rotation_tolerance;
+			};
+			bool constant = reduced.size() > 1;
+			for (int k = 0; k + 1 < count && constant; k++)
+			{
+				constant = near_first(keys[k + 1].position, keys[k + 1].orientation);
+				for (int frame = keys[k].frame + 1; frame < keys[k + 1].frame && constant; frame++)
+				{
+					float position[3];
+					float orientation[4];
+					sample(k, frame, position, orientation);
+					constant = near_first(position, orientation);
+				}
+			}
+			if (constant)
+			{
+				reduced.resize(1);
+			}
+			track->swap(reduced);
+		}
+
+		static void ReduceFaceTrack(std::vector<VmdFaceFrame> *track, const VmdReduceOption &option)
+		{
+			std::vector<VmdFaceFrame> &keys = *track;
+			auto fits = [&](int a, int b) -> bool {
+				const VmdFaceFrame &first = keys[a];
+				const VmdFaceFrame &last = keys[b];
+				float length = (float) (last.frame - first.frame);
+				int k = a;
+				for (uint32_t frame = first.frame + 1; frame < last.frame; frame++)
+				{
+					while (keys[k + 1].frame <= frame)
+					{
+						k++;
+					}
+					const VmdFaceFrame &p = keys[k];
+					const VmdFaceFrame &q = keys[k + 1];
+					float value = oguna::Lerp(p.weight, q.weight, (float) (frame - p.frame) / (float) (q.frame - p.frame));
+					float fitted = oguna::Lerp(first.weight, last.weight, (float) (frame - first.frame) / length);
+					if (fabsf(value - fitted) > option.face_tolerance)
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+			std::vector<VmdFaceFrame> reduced;
+			SelectKeys((int) keys.size(), fits, [&](int, int k) {
+				reduced.push_back(keys[k]);
+			});
+			// ̃L[ƁÅԂ̐t[̒lׂčŏ̃L[狖e덷ȂAL[ɂ
+			bool constant = reduced.size() > 1;
+			for (size_t k = 0; k + 1 < keys.size() && constant; k++)
+			{
+				const VmdFaceFrame &p = keys[k];
+				const VmdFaceFrame &q = keys[k + 1];
+				constant = fabsf(q.weight - keys[0].weight) <= option.face_tolerance;
+				for (uint32_t frame = p.frame + 1; frame < q.frame && constant; frame++)
+				{
+					float value = oguna::Lerp(p.weight, q.weight, (float) (frame - p.frame) / (float) (q.frame - p.frame));
+					constant = fabsf(value - keys[0].weight) <= option.face_tolerance;
+				}
+			}
+			if (constant)
+			{
+				reduced.resize(1);
+			}
+			track->swap(reduced);
+		}
+
+		static void ReduceCameraTrack(std::vector<VmdCameraFrame> *track, const VmdReduceOption &option, Context *context)
+		{
+			std::vector<VmdCameraFrame> &keys = *track;
+			// `lc̕ԋȐ(x1, x2, y1, y2)̏ɕ
+			auto original = [&](int k, int channel, uint8_t *control) {
+				const uint8_t *c = (const uint8_t*) keys[k].interpolation[channel];
+				control[0] = c[0];
+				control[1] = c[2];
+				control[2] = c[1];
+				control[3] = c[3];
+			};
+			// 0`2: ʒuA3`5: ]A6: A7: p
+			auto channel_value = [](const VmdCameraFrame &frame, int channel) {
+				return channel < 3 ? frame.position[channel] : (channel < 6 ? frame.orientation[channel - 3] : (channel == 6 ? frame.distance : frame.angle));
+			};
+			// `lgԋȐ
+			auto channel_curve = [](int channel) { return channel < 3 ? channel : (channel < 6 ? 3 : channel - 2); };
+
+			std::vector<float> values[8];
+			auto fits = [&](int a, int b) -> bool {
+				const VmdCameraFrame &first = keys[a];
+				const VmdCameraFrame &last = keys[b];
+				for (int k = a + 1; k < b; k++)
+				{
+					if (memcmp(keys[k].unknown, last.unknown, sizeof(last.unknown)) != 0)
+					{
+						// ̗LȂǂςL[͂܂Ȃ
+						return false;
+					}
+				}
+				float length = (float) (last.frame - first.frame);
+				context->t.clear();
+				for (auto &v : values)
+				{
+					v.clear();
+				}
+				int k = a;
+				for (int frame = first.frame + 1; frame < last.frame; frame++)
+				{
+					while (keys[k + 1].frame <= frame)
+					{
+						k++;
+					}
+					const VmdCameraFrame &p = keys[k];
+					const VmdCameraFrame &q = keys[k + 1];
+					context->t.push_back((float) (frame - first.frame) / length);
+					float x = (float) (frame - p.frame) / (float) (q.frame - p.frame);
+					for (int channel = 0; channel < 8; channel++)
+					{
+						uint8_t control[4];
+						original(k + 1, channel_curve(channel), control);
+						float value = frame == p.frame ? channel_value(p, channel) : oguna::Lerp(channel_value(p, channel), channel_value(q, channel), context->Evaluate(control, x));
+						values[channel].push_back(value);
+					}
+				}
+				float tolerances[4] = { option.position_tolerance, option.rotation_tolerance, option.position_tolerance, option.camera_angle_tolerance };
+				for (int channel = 0; channel < 3; channel++)
+				{
+					if (!FitChannel(context, values[channel].data(), first.position[channel], last.position[channel], tolerances[0], option.fit_curves, context->curves[channel]))
+					{
+						return false;
+					}
+				}
+				// ]3͈{̋ȐL̂ŁAł傫ς鐬œĂ͂߂Ăcm߂
+				int widest = 3;
+				for (int channel = 4; channel < 6; channel++)
+				{
+					if (fabsf(channel_value(last, channel) - channel_value(first, channel)) > fabsf(channel_value(last, widest) - channel_value(first, widest)))
+					{
+						widest = channel;
+					}
+				}
+				if (!FitChannel(context, values[widest].data(), channel_value(first, widest), channel_value(last, widest), tolerances[1], option.fit_curves, context->curves[3]))
+				{
+					return false;
+				}
+				for (int channel = 3; channel < 6; channel++)
+				{
+					for (size_t i = 0; i < context->t.size(); i++)
+					{
+						float fitted = oguna::Lerp(channel_value(first, channel), channel_value(last, channel), context->Evaluate(context->curves[3], context->t[i]));
+						if (fabsf(fitted - values[channel][i]) > tolerances[1])
+						{
+							return false;
+						}
+					}
+				}
+				if (!FitChannel(context, values[6].data(), first.distance, last.distance, tolerances[2], option.fit_curves, context->curves[4])
+					|| !FitChannel(context, values[7].data(), first.angle, last.angle, tolerances[3], option.fit_curves, context->curves[5]))
+				{
+					return false;
+				}
+				memcpy(context->accepted, context->curves, sizeof(context->curves));
+				return true;
+			};
+
+			std::vector<VmdCameraFrame> reduced;
+			SelectKeys((int) keys.size(), fits, [&](int previous, int k) {
+				reduced.push_back(keys[k]);
+				if (previous >= 0 && k > previous + 1)
+				{
+					VmdCameraFrame &key = reduced.back();
+					for (int channel = 0; channel < 6; channel++)
+					{
+						const uint8_t *control = context->accepted[channel];
+						key.interpolation[channel][0] = (char) control[0];
+						key.interpolation[channel][1] = (char) control[2];
+						key.interpolation[channel][2] = (char) control[1];
+						key.interpolation[channel][3] = (char) control[3];
+					}
+				}
+			});
+			track->swap(reduced);
+		}
+	};
+}
\ No newline at end of file
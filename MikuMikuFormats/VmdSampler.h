@@ -0,0 +1,256 @@
+#pragma once
+#include "VmdTrack.h"
+#include "MathHelper.h"
+
+namespace vmd
+{
+	/// VmdTrackMotionCӂ̃t[̃{[E\EJ̒l߂
+	/// L[ƃL[̊ԂVmdTrackMotion::curves̕\ŃxWFȐ]ĕԂA]͋ʐ`Ԃ
+	/// gbNƂɑO񌩂L[oĂ̂ŁAt[ɐi߂Đł͒TقڕsvɂȂ
+	class VmdMotionSampler
+	{
+	public:
+		explicit VmdMotionSampler(const VmdTrackMotion *motion)
+			: motion(motion)
+			, bone_cursors(motion->bone_key_offsets.begin(), motion->bone_key_offsets.end() - 1)
+			, face_cursors(motion->face_key_offsets.begin(), motion->face_key_offsets.end() - 1)
+			, camera_cursor(0)
+		{}
+
+		/// Ώۂ̃[V
+		const VmdTrackMotion* Motion() const
+		{
+			return motion;
+		}
+
+		/// oĂL[擪ɖ߂
+		void Reset()
+		{
+			bone_cursors.assign(motion->bone_key_offsets.begin(), motion->bone_key_offsets.end() - 1);
+			face_cursors.assign(motion->face_key_offsets.begin(), motion->face_key_offsets.end() - 1);
+			camera_cursor = 0;
+		}
+
+		/// {[gbNtrackframeł̈ʒuƉ]߂
+		void SampleBone(int track, float frame, float *position, float *orientation)
+		{
+			int begin = motion->bone_key_offsets[track];
+			int end = motion->bone_key_offsets[track + 1];
+			int key = FindKey(motion->bone_key_frames.data(), begin, end, frame, bone_cursors[track]);
+			bone_cursors[track] = key;
+			EvaluateBone(*motion, key, end, frame, position, orientation);
+		}
+
+		/// \gbNtrackframeł̏d݂߂
+		float SampleFace(int track, float frame)
+		{
+			int begin = motion->face_key_offsets[track];
+			int end = motion->face_key_offsets[track + 1];
+			int key = FindKey(motion->face_key_frames.data(), begin, end, frame, face_cursors[track]);
+			face_cursors[track] = key;
+			return EvaluateFace(*motion, key, end, frame);
+		}
+
+		/// frameł̃J߂(distance, position, orientation, angleݒ肷)
+		/// ׂ荇t[̃L[̊Ԃ̓J̐؂ւƂĕԂȂ
+		void SampleCamera(float frame, VmdCameraFrame *camera)
+		{
+			camera_cursor = SampleCameraAt(*motion, frame, camera, camera_cursor);
+		}
+
+		/// L[̈ʒuoɓ񕪒TŃJ߂(cursorɑǑʂnƐɂ̋߂𒲂ׂ)
+		static int SampleCameraAt(const VmdTrackMotion &motion, float frame, VmdCameraFrame *camera, int cursor = 0)
+		{
+			return SampleCameraAt(motion.camera_frames, motion.camera_key_curves, motion.curves, frame, camera, cursor);
+		}
+
+		/// Jt[ƕԋȐ̔ԍ(t[*6)AȐ̕\J߂
+		static int SampleCameraAt(const std::vector<VmdCameraFrame> &frames, const std::vector<int> &key_curves, const VmdCurveTable &curves,
+			float frame, VmdCameraFrame *camera, int cursor = 0)
+		{
+			int end = (int) frames.size();
+			if (end == 0)
+			{
+				return 0;
+			}
+			int key = cursor;
+			if (key >= end || ((float) frames[key].frame > frame && key > 0) || (key + 1 < end && (float) frames[key + 1].frame <= frame))
+			{
+				int low = 0;
+				int high = end;
+				while (low < high)
+				{
+					int middle = (low + high) / 2;
+					if ((float) frames[middle].frame <= frame)
+					{
+						low = middle + 1;
+					}
+					else
+					{
+						high = middle;
+					}
+				}
+				key = low > 0 ? low - 1 : 0;
+			}
+			const VmdCameraFrame &a = frames[key];
+			*camera = a;
+			camera->frame = (int) frame;
+			if (key + 1 == end || frame <= (float) a.frame || frames[key + 1].frame - a.frame <= 1)
+			{
+				return key;
+			}
+			const VmdCameraFrame &b = frames[key + 1];
+			const int *curve = &key_curves[(key + 1) * 6];
+			float t = (frame - (float) a.frame) / (float) (b.frame - a.frame);
+			for (int i = 0; i < 3; i++)
+			{
+				camera->position[i] = oguna::Lerp(a.position[i], b.position[i], curves.Evaluate(curve[i], t));
+			}
+			float eased = curves.Evaluate(curve[3], t);
+			for (int i = 0; i < 3; i++)
+			{
+				camera->orientation[i] = oguna::Lerp(a.orientation[i], b.orientation[i], eased);
+			}
+			camera->distance = oguna::Lerp(a.distance, b.distance, curves.Evaluate(curve[4], t));
+			camera->angle = oguna::Lerp(a.angle, b.angle, curves.Evaluate(curve[5], t));
+			return key;
+		}
+
+		/// S{[gbN̒l߂(positions̓gbN*3Aorientations̓gbN*4)
+		void SampleBones(float frame, float *positions, float *orientations)
+		{
+			for (int track = 0; track < motion->BoneTrackCount(); track++)
+			{
+				SampleBone(track, frame, positions + track * 3, orientations + track * 4);
+			}
+		}
+
+		/// S\gbN̏d݂߂(weights̓gbN)
+		void SampleFaces(float frame, float *weights)
+		{
+			for (int track = 0; track < motion->FaceTrackCount(); track++)
+			{
+				weights[track] = SampleFace(track, frame);
+			}
+		}
+
+		/// L[̈ʒuoɓ񕪒TŃ{[̒l߂
+		static void SampleBoneAt(const VmdTrackMotion &motion, int track, float frame, float *position, float *orientation)
+		{
+			int begin = motion.bone_key_offsets[track];
+			int end = motion.bone_key_offsets[track + 1];
+			int key = SearchKey(motion.bone_key_frames.data(), begin, end, frame);
+			EvaluateBone(motion, key, end, frame, position, orientation);
+		}
+
+		/// L[̈ʒuoɓ񕪒Tŕ\̏d݂߂
+		static float SampleFaceAt(const VmdTrackMotion &motion, int track, float frame)
+		{
+			int begin = motion.face_key_offsets[track];
+			int end = motion.face_key_offsets[track + 1];
+			int key = SearchKey(motion.face_key_frames.data(), begin, end, frame);
+			return EvaluateFace(motion, key, end, frame);
+		}
+
+		/// [begin, end)frameȉōŌ̃L[񕪒T(擪OȂbegin)
+		static int SearchKey(const uint32_t *frames, int begin, int end, float frame)
+		{
+			int low = begin;
+			int high = end;
+			while (low < high)
+			{
+				int middle = (low + high) / 2;
+				if ((float) frames[middle] <= frame)
+				{
+					low = middle + 1;
+				}
+				else
+				{
+					high = middle;
+				}
+			}
+			return low > begin ? low - 1 : begin;
+		}
+
+		/// ÕL[cursor߂ɒׁAOꂽ񕪒T
+		static int FindKey(const uint32_t *frames, int begin, int end, float frame, int cursor)
+		{
+			if (begin == end)
+			{
+				return begin;
+			}
+			for (int key = cursor; key < cursor + 2 && key < end; key++)
+			{
+				if ((float) frames[key] <= frame || key == begin)
+				{
+					if (key + 1 == end || frame < (float) frames[key + 1])
+					{
+						return key;
+					}
+				}
+				else
+				{
+					break;
+				}
+			}
+			return SearchKey(frames, begin, end, frame);
+		}
+
+	private:
+		const VmdTrackMotion *motion;
+		/// gbNƂ̑ÕL[
+		std::vector<int> bone_cursors;
+		std::vector<int> face_cursors;
+		int camera_cursor;
+
+		/// L[keyƎ̃L[̊ԂԂ(ԋȐ͎̃L[̂̂g)
+		static void EvaluateBone(const VmdTrackMotion &motion, int key, int end, float frame, float *position, float *orientation)
+		{
+			if (key == end)
+			{
+				// L[̂ȂgbN
+				position[0] = position[1] = position[2] = 0.0f;
+				orientation[0] = orientation[1] = orientation[2] = 0.0f;
+				orientation[3] = 1.0f;
+				return;
+			}
+			const float *p0 = &motion.bone_key_positions[key * 3];
+			const float *q0 = &motion.bone_key_orientations[key * 4];
+			float frame0 = (float) motion.bone_key_frames[key];
+			if (key + 1 == end || frame <= frame0)
+			{
+				memcpy(position, p0, sizeof(float) * 3);
+				memcpy(orientation, q0, sizeof(float) * 4);
+				return;
+			}
+			int next = key + 1;
+			const float *p1 = &motion.bone_key_positions[next * 3];
+			const float *q1 = &motion.bone_key_orientations[next * 4];
+			float frame1 = (float) motion.bone_key_frames[next];
+			float t = (frame - frame0) / (frame1 - frame0);
+			const int *curve = &motion.bone_key_curves[next * 4];
+			for (int channel = 0; channel < 3; channel++)
+			{
+				position[channel] = oguna::Lerp(p0[channel], p1[channel], motion.curves.Evaluate(curve[channel], t));
+			}
+			oguna::QuaternionSlerp(q0, q1, motion.curves.Evaluate(curve[3], t), orientation);
+		}
+
+		/// \̏d݂͐`Ԃ
+		static float EvaluateFace(const VmdTrackMotion &motion, int key, int end, float frame)
+		{
+			if (key == end)
+			{
+				return 0.0f;
+			}
+			float frame0 = (float) motion.face_key_frames[key];
+			if (key + 1 == end || frame <= frame0)
+			{
+				return motion.face_key_weights[key];
+			}
+			float frame1 = (float) motion.face_key_frames[key + 1];
+			float t = (frame - frame0) / (frame1 - frame0);
+			return oguna::Lerp(motion.face_key_weights[key], motion.face_key_weights[key + 1], t);
+		}
+	};
+}
\ No newline at end of file
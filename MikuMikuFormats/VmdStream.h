@@ -0,0 +1,327 @@
+#pragma once
+#include <algorithm>
+#include "Vmd.h"
+
+namespace vmd
+{
+	/// VMD̃ZNV
+	enum class VmdSection
+	{
+		Bone = 0,
+		Face,
+		Camera,
+		Light,
+		Ik,
+		/// I[
+		End,
+	};
+
+	/// VMDVmdMotionɓWJɐ擪萔ǂ
+	/// Xg[͌Œ蒷̓obt@oRœǂ݁AR[h̔z܂Ƃ܂蕪g񂷂̂ŁA
+	/// L[̐ɂ炸̃œǂݐi߂
+	/// reader.Open(filename);
+	/// while (reader.Next())
+	/// {
+	///     if (reader.Section() == VmdSection::Bone) { for (auto &frame : reader.BoneFrames()) ... }
+	/// }
+	class VmdStreamReader
+	{
+	public:
+		/// xbatch_size܂ł̃R[hǂ݁AXg[buffer_sizeoCgǂ
+		explicit VmdStreamReader(size_t batch_size = 4096, size_t buffer_size = 1 << 16)
+			: batch_size(batch_size > 0 ? batch_size : 1)
+			, buffer_size(buffer_size)
+			, stream(nullptr)
+			, version(0)
+			, section(VmdSection::End)
+			, section_count(0)
+			, section_remain(0)
+			, failed(false)
+		{}
+
+		VmdStreamReader(const VmdStreamReader&) = delete;
+		VmdStreamReader& operator=(const VmdStreamReader&) = delete;
+
+		/// t@CJăwb_ǂ
+		bool Open(const char *filename)
+		{
+			Close();
+			file.open(filename, std::ios::binary);
+			if (!file)
+			{
+				std::cerr << "could not open \"" << filename << "\"" << std::endl;
+				return false;
+			}
+			return Open(&file);
+		}
+
+		/// Xg[̃wb_ǂ(Xg[͓ǂݏI܂ŌĂяoێ)
+		bool Open(std::istream *stream)
+		{
+			this->stream = stream;
+			reader = std::make_unique<oguna::BinaryReader>(stream, buffer_size);
+			failed = false;
+			try
+			{
+				const char *magic = reader->View(30);
+				if (strncmp(magic, "Vocaloid Motion Data", 20))
+				{
+					throw "invalid vmd file.";
+				}
+				version = std::atoi(std::string(magic + 20, 10).c_str());
+				model_name = reader->ReadFixedString(20);
+				BeginSection(VmdSection::Bone);
+			}
+			catch (const char *message)
+			{
+				std::cerr << message << std::endl;
+				Fail();
+				return false;
+			}
+			return true;
+		}
+
+		/// 
+		void Close()
+		{
+			reader = nullptr;
+			if (file.is_open())
+			{
+				file.close();
+			}
+			file.clear();
+			stream = nullptr;
+			section = VmdSection::End;
+			section_count = section_remain = 0;
+		}
+
+		/// f
+		const std::string& ModelName() const
+		{
+			return model_name;
+		}
+
+		/// o[W
+		int Version() const
+		{
+			return version;
+		}
+
+		/// ONextœǂ񂾃R[h̃ZNV
+		VmdSection Section() const
+		{
+			return section;
+		}
+
+		/// ݂̃ZNṼR[h
+		int SectionCount() const
+		{
+			return section_count;
+		}
+
+		/// ǂݍ݂Ɏsǂ
+		bool Failed() const
+		{
+			return failed;
+		}
+
+		/// ̂܂Ƃ܂ǂ(̃ZNV͔΂)
+		/// I[ɒB邩sfalseԂ
+		bool Next()
+		{
+			if (!reader)
+			{
+				return false;
+			}
+			try
+			{
+				while (section_remain == 0)
+				{
+					if (section == VmdSection::End)
+					{
+						return false;
+					}
+					BeginSection((VmdSection) ((int) section + 1));
+				}
+				int count = (int) std::min<size_t>(batch_size, (size_t) section_remain);
+				switch (section)
+				{
+				case VmdSection::Bone:
+					ReadBatch(&bone_frames, count);
+					break;
+				case VmdSection::Face:
+					ReadBatch(&face_frames, count);
+					break;
+				case VmdSection::Camera:
+					ReadBatch(&camera_frames, count);
+					break;
+				case VmdSection::Light:
+					ReadBatch(&light_frames, count);
+					break;
+				case VmdSection::Ik:
+					ReadBatch(&ik_frames, count);
+					break;
+				default:
+					return false;
+				}
+				section_remain -= count;
+				return true;
+			}
+			catch (const char *message)
+			{
+				std::cerr << message << std::endl;
+				Fail();
+				return false;
+			}
+		}
+
+		/// ݂̃ZNV̎cWJɓǂݔ΂
+		void SkipSection()
+		{
+			if (!reader || section_remain == 0)
+			{
+				return;
+			}
+			try
+			{
+				switch (section)
+				{
+				case VmdSection::Bone:
+					reader->Skip((size_t) 111 * section_remain);
+					break;
+				case VmdSection::Face:
+					reader->Skip((size_t) 23 * section_remain);
+					break;
+				case VmdSection::Camera:
+					reader->Skip((size_t) 63 * section_remain);
+					break;
+				case VmdSection::Light:
+					reader->Skip((size_t) 28 * section_remain);
+					break;
+				case VmdSection::Ik:
+					// IKt[͉ϒȂ̂ňǂ
+					for (int i = 0; i < section_remain; i++)
+					{
+						reader->Skip(sizeof(int) + sizeof(uint8_t));
+						reader->Skip((size_t) 21 * reader->Read<int>());
+					}
+					break;
+				default:
+					break;
+				}
+				section_remain = 0;
+			}
+			catch (const char *message)
+			{
+				std::cerr << message << std::endl;
+				Fail();
+			}
+		}
+
+		/// ONextœǂ񂾃{[t[
+		const std::vector<VmdBoneFrame>& BoneFrames() const
+		{
+			return bone_frames;
+		}
+
+		/// ONextœǂ񂾕\t[
+		const std::vector<VmdFaceFrame>& FaceFrames() const
+		{
+			return face_frames;
+		}
+
+		/// ONextœǂ񂾃Jt[
+		const std::vector<VmdCameraFrame>& CameraFrames() const
+		{
+			return camera_frames;
+		}
+
+		/// ONextœǂ񂾃Cgt[
+		const std::vector<VmdLightFrame>& LightFrames() const
+		{
+			return light_frames;
+		}
+
+		/// ONextœǂIKt[
+		const std::vector<VmdIkFrame>& IkFrames() const
+		{
+			return ik_frames;
+		}
+
+	private:
+		size_t batch_size;
+		size_t buffer_size;
+		/// Open(filename)ŊJt@C
+		std::ifstream file;
+		std::istream *stream;
+		std::unique_ptr<oguna::BinaryReader> reader;
+		std::string model_name;
+		int version;
+		VmdSection section;
+		int section_count;
+		/// ݂̃ZNV̖ǂ̃R[h
+		int section_remain;
+		bool failed;
+		std::vector<VmdBoneFrame> bone_frames;
+		std::vector<VmdFaceFrame> face_frames;
+		std::vector<VmdCameraFrame> camera_frames;
+		std::vector<VmdLightFrame> light_frames;
+		std::vector<VmdIkFrame> ik_frames;
+
+		/// ZNV̗vfǂ
+		/// ZtVhE͓ǂݔ΂AÂ`ŏȗĂZNV͏I[Ƃ
+		void BeginSection(VmdSection next)
+		{
+			section = next;
+			section_count = section_remain = 0;
+			if (next == VmdSection::Ik)
+			{
+				if (reader->Eof())
+				{
+					section = VmdSection::End;
+					return;
+				}
+				int self_shadow_count = reader->Read<int>();
+				if (self_shadow_count < 0)
+				{
+					throw "invalid self shadow count";
+				}
+				reader->Skip((size_t) 9 * self_shadow_count);
+				if (reader->Eof())
+				{
+					section = VmdSection::End;
+					return;
+				}
+			}
+			if (next == VmdSection::End)
+			{
+				return;
+			}
+			section_count = reader->Read<int>();
+			if (section_count < 0)
+			{
+				throw "invalid frame count";
+			}
+			section_remain = section_count;
+		}
+
+		/// count̃R[hǂ(vf͎g)
+		template<typename T>
+		void ReadBatch(std::vector<T> *out, int count)
+		{
+			out->resize(count);
+			for (int i = 0; i < count; i++)
+			{
+				(*out)[i].Read(reader.get());
+			}
+		}
+
+		void Fail()
+		{
+			failed = true;
+			reader = nullptr;
+			section = VmdSection::End;
+			section_count = section_remain = 0;
+		}
+	};
+}
\ No newline at end of file
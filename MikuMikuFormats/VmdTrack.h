@@ -0,0 +1,783 @@
+#pragma once
+#include <algorithm>
+#include "Vmd.h"
+#include "VmdCurve.h"
+#include "StringPool.h"
+
+namespace vmd
+{
+	/// {[E\ƂɃL[t[܂Ƃ߁AvfƂ̔zɊi[[V
+	/// gbNt̃L[[key_offsets[t], key_offsets[t + 1])͈̔͂Ƀt[ԍɕ
+	/// gbNœt[ԍ̃L[ꍇ̓t@CŌ̂̂c
+	/// {[ƕ\͕ANamePool()ɓo^ԍŎ
+	class VmdTrackMotion
+	{
+	public:
+		/// name_poolnullptrȂ烂[VO̕\
+		/// ̃fE[VŖOLƂ́Aoguna::StringPool::Shared()Ȃǃ[V܂Ŏc\n
+		explicit VmdTrackMotion(oguna::StringPool *name_pool = nullptr)
+			: version(0)
+			, own_name_pool(name_pool ? nullptr : std::make_shared<oguna::StringPool>())
+			, name_pool(name_pool ? name_pool : own_name_pool.get())
+		{
+			bone_key_offsets.push_back(0);
+			face_key_offsets.push_back(0);
+		}
+
+		/// f
+		std::string model_name;
+		/// o[W
+		int version;
+
+		/// {[NamePool()̔ԍ(gbN)
+		oguna::StringIdList bone_names;
+		/// {[gbNƂ̃L[̊Jnʒu(gbN+1)
+		std::vector<int> bone_key_offsets;
+		/// t[ԍ(L[)
+		std::vector<uint32_t> bone_key_frames;
+		/// ʒu(L[*3)
+		std::vector<float> bone_key_positions;
+		/// ](L[*4)
+		std::vector<float> bone_key_orientations;
+		/// ԋȐ(L[*64AVmdBoneFrame::interpolationƓ)
+		std::vector<char> bone_key_interpolations;
+		/// ԋȐcurves̔ԍ(L[*4AX, Y, Z, ]̏)
+		std::vector<int> bone_key_curves;
+
+		/// \NamePool()̔ԍ(gbN)
+		oguna::StringIdList face_names;
+		/// \gbNƂ̃L[̊Jnʒu(gbN+1)
+		std::vector<int> face_key_offsets;
+		/// t[ԍ(L[)
+		std::vector<uint32_t> face_key_frames;
+		/// \̏d(L[)
+		std::vector<float> face_key_weights;
+
+		/// Jt[(t[ԍ)
+		std::vector<VmdCameraFrame> camera_frames;
+		/// J̕ԋȐcurves̔ԍ(t[*6AX, Y, Z, ], , p̏)
+		std::vector<int> camera_key_curves;
+		/// Cgt[(t[ԍ)
+		std::vector<VmdLightFrame> light_frames;
+		/// IKt[(t[ԍ)
+		std::vector<VmdIkFrame> ik_frames;
+
+		/// {[ƃJ̕ԋȐ̕\(Ȑ͈ɂ܂Ƃ߂)
+		VmdCurveTable curves;
+
+		/// {[gbN
+		int BoneTrackCount() const
+		{
+			return bone_names.Count();
+		}
+
+		/// \gbN
+		int FaceTrackCount() const
+		{
+			return face_names.Count();
+		}
+
+		/// Oo^Ă\
+		oguna::StringPool* NamePool() const
+		{
+			return name_pool;
+		}
+
+		/// gbNt̃{[(NamePool()j܂ŗL)
+		oguna::StringView BoneName(int t) const
+		{
+			return name_pool->View(bone_names.Id(t));
+		}
+
+		/// gbNt̕\
+		oguna::StringView FaceName(int t) const
+		{
+			return name_pool->View(face_names.Id(t));
+		}
+
+		/// {[gbNԍ(Ȃ-1)
+		int FindBoneTrack(const std::string &name) const
+		{
+			return FindBoneTrackById(name_pool->Find(name));
+		}
+
+		/// \gbNԍ(Ȃ-1)
+		int FindFaceTrack(const std::string &name) const
+		{
+			return FindFaceTrackById(name_pool->Find(name));
+		}
+
+		/// {[ƕ\poolɓo^AȌpool̔ԍŎ
+		/// poolɖOo^fƂ́AׂɔԍŃgbNΉt
+		void InternNames(oguna::StringPool *pool)
+		{
+			bone_names.Reintern(*name_pool, pool);
+			face_names.Reintern(*name_pool, pool);
+			name_pool = pool;
+			own_name_pool.reset();
+		}
+
+		/// NamePool()̔ԍ{[gbN(Ȃ-1)
+		int FindBoneTrackById(uint32_t name_id) const
+		{
+			return bone_names.Find(name_id);
+		}
+
+		/// NamePool()̔ԍ\gbN(Ȃ-1)
+		int FindFaceTrackById(uint32_t name_id) const
+		{
+			return face_names.Find(name_id);
+		}
+
+		/// ׂẴgbNƃt[폜
+		void Clear()
+		{
+			model_name.clear();
+			version = 0;
+			bone_names.Clear();
+			bone_key_offsets.assign(1, 0);
+			bone_key_frames.clear();
+			bone_key_positions.clear();
+			bone_key_orientations.clear();
+			bone_key_interpolations.clear();
+			bone_key_curves.clear();
+			face_names.Clear();
+			face_key_offsets.assign(1, 0);
+			face_key_frames.clear();
+			face_key_weights.clear();
+			camera_frames.clear();
+			camera_key_curves.clear();
+			light_frames.clear();
+			ik_frames.clear();
+			curves.Clear();
+		}
+
+		/// Ō̃L[̃t[ԍ
+		uint32_t MaxFrame() const
+		{
+			uint32_t max_frame = 0;
+			for (uint32_t frame : bone_key_frames)
+			{
+				max_frame = std::max(max_frame, frame);
+			}
+			for (uint32_t frame : face_key_frames)
+			{
+				max_frame = std::max(max_frame, frame);
+			}
+			if (!camera_frames.empty())
+			{
+				max_frame = std::max(max_frame, (uint32_t) camera_frames.back().frame);
+			}
+			return max_frame;
+		}
+
+		/// cache_filenamenullptrłȂ΁Ãt@C̃nbVvLbV}bvēǂݍ݁A
+		/// ȂΌ̃t@C͂ăLbVo
+		/// Oname_pool(nullptrȂ烂[VOŎ\)ɓo^
+		static std::unique_ptr<VmdTrackMotion> LoadFromFile(char const *filename, char const *cache_filename = nullptr,
+			oguna::StringPool *name_pool = nullptr)
+		{
+			oguna::MappedFile file;
+			if (!file.Open(filename))
+			{
+				std::cerr << "could not open \"" << filename << "\"" << std::endl;
+				return nullptr;
+			}
+			uint64_t hash = 0;
+			if (cache_filename)
+			{
+				hash = oguna::HashBytes(file.Data(), file.Size());
+				oguna::BakedFile cache;
+				auto cached = std::make_unique<VmdTrackMotion>(name_pool);
+				if (cache.Open(cache_filename, oguna::BakedKind::Motion, hash, file.Size()) && cached->LoadBaked(cache))
+				{
+					return cached;
+				}
+			}
+			oguna::BinaryReader reader(file.Data(), file.Size());
+			auto result = LoadFromReader(&reader, name_pool);
+			if (result && cache_filename)
+			{
+				oguna::BakedWriter writer;
+				result->Bake(&writer);
+				if (!writer.Save(cache_filename, oguna::BakedKind::Motion, hash, file.Size()))
+				{
+					std::cerr << "could not write \"" << cache_filename << "\"" << std::endl;
+				}
+			}
+			return result;
+		}
+
+		static std::unique_ptr<VmdTrackMotion> LoadFromStream(std::ifstream *stream, oguna::StringPool *name_pool = nullptr)
+		{
+			oguna::BinaryReader reader(stream);
+			return LoadFromReader(&reader, name_pool);
+		}
+
+		static std::unique_ptr<VmdTrackMotion> LoadFromReader(oguna::BinaryReader *reader, oguna::StringPool *name_pool = nullptr)
+		{
+			try
+			{
+				return ReadTracks(reader, name_pool);
+			}
+			catch (const char *message)
+			{
+				std::cerr << message << std::endl;
+				return nullptr;
+			}
+		}
+
+		/// VmdMotiongbNgݗĂ
+		static std::unique_ptr<VmdTrackMotion> FromMotion(const VmdMotion &motion, oguna::StringPool *name_pool = nullptr)
+		{
+			auto result = std::make_unique<VmdTrackMotion>(name_pool);
+			result->model_name = motion.model_name;
+			result->version = motion.version;
+
+			// VMDƓт̃R[hɋlߒĂgݗĂ
+			std::vector<char> records(motion.bone_frames.size() * BoneRecordSize, 0);
+			for (size_t i = 0; i < motion.bone_frames.size(); i++)
+			{
+				const VmdBoneFrame &frame = motion.bone_frames[i];
+				char *record = &records[i * BoneRecordSize];
+				memcpy(record, frame.name.data(), std::min<size_t>(frame.name.size(), 15));
+				memcpy(record + 15, &frame.frame, sizeof(int));
+				memcpy(record + 19, frame.position, sizeof(float) * 3);
+				memcpy(record + 31, frame.orientation, sizeof(float) * 4);
+				memcpy(record + 47, frame.interpolation, sizeof(char) * 64);
+			}
+			result->BuildBoneTracks(records.data(), (int) motion.bone_frames.size());
+
+			records.assign(motion.face_frames.size() * FaceRecordSize, 0);
+			for (size_t i = 0; i < motion.face_frames.size(); i++)
+			{
+				const VmdFaceFrame &frame = motion.face_frames[i];
+				char *record = &records[i * FaceRecordSize];
+				memcpy(record, frame.face_name.data(), std::min<size_t>(frame.face_name.size(), 15));
+				memcpy(record + 15, &frame.frame, sizeof(uint32_t));
+				memcpy(record + 19, &frame.weight, sizeof(float));
+			}
+			result->BuildFaceTracks(records.data(), (int) motion.face_frames.size());
+
+			result->camera_frames = motion.camera_frames;
+			result->light_frames = motion.light_frames;
+			result->ik_frames = motion.ik_frames;
+			result->SortFrames();
+			result->BuildCurves();
+			return result;
+		}
+
+		/// VmdMotionɖ߂({[E\t[̓gbNEt[ԍɕ)
+		std::unique_ptr<VmdMotion> ToMotion() const
+		{
+			auto result = std::make_unique<VmdMotion>();
+			result->model_name = model_name;
+			result->version = version;
+			result->bone_frames.resize(bone_key_frames.size());
+			for (int t = 0; t < BoneTrackCount(); t++)
+			{
+				std::string name = BoneName(t).ToString();
+				for (int k = bone_key_offsets[t]; k < bone_key_offsets[t + 1]; k++)
+				{
+					VmdBoneFrame &frame = result->bone_frames[k];
+					frame.name = name;
+					frame.frame = (int) bone_key_frames[k];
+					memcpy(frame.position, &bone_key_positions[k * 3], sizeof(float) * 3);
+					memcpy(frame.orientation, &bone_key_orientations[k * 4], sizeof(float) * 4);
+					memcpy(frame.interpolation, &bone_key_interpolations[k * 64], sizeof(char) * 64);
+				}
+			}
+			result->face_frames.resize(face_key_frames.size());
+			for (int t = 0; t < FaceTrackCount(); t++)
+			{
+				std::string name = FaceName(t).ToString();
+				for (int k = face_key_offsets[t]; k < face_key_offsets[t + 1]; k++)
+				{
+					VmdFaceFrame &frame = result->face_frames[k];
+					frame.face_name = name;
+					frame.frame = face_key_frames[k];
+					frame.weight = face_key_weights[k];
+				}
+			}
+			result->camera_frames = camera_frames;
+			result->light_frames = light_frames;
+			result->ik_frames = ik_frames;
+			return result;
+		}
+
+		/// ׂĂ̔zLbV̐߂Ƃď
+		void Bake(oguna::BakedWriter *writer) const
+		{
+			writer->Add(SectionVersion, &version, 1);
+			writer->Add(SectionModelName, model_name);
+			BakeNames(writer, SectionBoneNames, *name_pool, bone_names);
+			writer->Add(SectionBoneKeyOffsets, bone_key_offsets);
+			writer->Add(SectionBoneKeyFrames, bone_key_frames);
+			writer->Add(SectionBoneKeyPositions, bone_key_positions);
+			writer->Add(SectionBoneKeyOrientations, bone_key_orientations);
+			writer->Add(SectionBoneKeyInterpolations, bone_key_interpolations);
+			writer->Add(SectionBoneKeyCurves, bone_key_curves);
+			BakeNames(writer, SectionFaceNames, *name_pool, face_names);
+			writer->Add(SectionFaceKeyOffsets, face_key_offsets);
+			writer->Add(SectionFaceKeyFrames, face_key_frames);
+			writer->Add(SectionFaceKeyWeights, face_key_weights);
+			writer->Add(SectionCameraFrames, camera_frames);
+			writer->Add(SectionCameraKeyCurves, camera_key_curves);
+			writer->Add(SectionLightFrames, light_frames);
+			// IKt[(t[ԍ, \, IK͈̔)ƁAIKƂ̖OƗLEɕ
+			std::vector<int> ik_records;
+			std::vector<std::string> ik_names;
+			std::vector<uint8_t> ik_enables;
+			for (auto &frame : ik_frames)
+			{
+				ik_records.push_back(frame.frame);
+				ik_records.push_back(frame.display ? 1 : 0);
+				ik_records.push_back((int) ik_names.size());
+				for (auto &ik_enable : frame.ik_enable)
+				{
+					ik_names.push_back(ik_enable.ik_name);
+					ik_enables.push_back(ik_enable.enable ? 1 : 0);
+				}
+			}
+			writer->Add(SectionIkRecords, ik_records);
+			BakeNames(writer, SectionIkNames, ik_names);
+			writer->Add(SectionIkEnables, ik_enables);
+			curves.Bake(writer, SectionCurves);
+		}
+
+		/// LbVz܂Ƃ߂ăRs[AONamePool()ɓo^
+		/// ߂Ă邩Az̑傫͈͂Ȃ΋ɂfalseԂ
+		bool LoadBaked(const oguna::BakedFile &file)
+		{
+			size_t count;
+			const int *baked_version = file.Section<int>(SectionVersion, &count);
+			if (baked_version == nullptr || count != 1)
+			{
+				Clear();
+				return false;
+			}
+			version = *baked_version;
+			std::vector<int> ik_records;
+			std::vector<std::string> ik_names;
+			std::vector<uint8_t> ik_enables;
+			bool loaded = file.Read(SectionModelName, &model_name)
+				&& LoadNames(file, SectionBoneNames, name_pool, &bone_names)
+				&& file.Read(SectionBoneKeyOffsets, &bone_key_offsets)
+				&& file.Read(SectionBoneKeyFrames, &bone_key_frames)
+				&& file.Read(SectionBoneKeyPositions, &bone_key_positions)
+				&& file.Read(SectionBoneKeyOrientations, &bone_key_orientations)
+				&& file.Read(SectionBoneKeyInterpolations, &bone_key_interpolations)
+				&& file.Read(SectionBoneKeyCurves, &bone_key_curves)
+				&& LoadNames(file, SectionFaceNames, name_pool, &face_names)
+				&& file.Read(SectionFaceKeyOffsets, &face_key_offsets)
+				&& file.Read(SectionFaceKeyFrames, &face_key_frames)
+				&& file.Read(SectionFaceKeyWeights, &face_key_weights)
+				&& file.Read(SectionCameraFrames, &camera_frames)
+				&& file.Read(SectionCameraKeyCurves, &camera_key_curves)
+				&& file.Read(SectionLightFrames, &light_frames)
+				&& file.Read(SectionIkRecords, &ik_records)
+				&& LoadNames(file, SectionIkNames, &ik_names)
+				&& file.Read(SectionIkEnables, &ik_enables)
+				&& curves.LoadBaked(file, SectionCurves)
+				&& IsValidOffsets(bone_key_offsets, bone_names.Count(), bone_key_frames.size())
+				&& bone_key_positions.size() == bone_key_frames.size() * 3
+				&& bone_key_orientations.size() == bone_key_frames.size() * 4
+				&& bone_key_interpolations.size() == bone_key_frames.size() * 64
+				&& IsValidCurves(bone_key_curves, bone_key_frames.size() * 4, curves.Count())
+				&& IsValidOffsets(face_key_offsets, face_names.Count(), face_key_frames.size())
+				&& face_key_weights.size() == face_key_frames.size()
+				&& IsValidCurves(camera_key_curves, camera_frames.size() * 6, curves.Count())
+				&& IsValidIkRecords(ik_records, ik_names.size())
+				&& ik_names.size() == ik_enables.size();
+			if (!loaded)
+			{
+				Clear();
+				return false;
+			}
+			ik_frames.resize(ik_records.size() / 3);
+			for (size_t i = 0; i < ik_frames.size(); i++)
+			{
+				int begin = ik_records[i * 3 + 2];
+				int end = i + 1 < ik_frames.size() ? ik_records[i * 3 + 5] : (int) ik_names.size();
+				ik_frames[i].frame = ik_records[i * 3];
+				ik_frames[i].display = ik_records[i * 3 + 1] != 0;
+				ik_frames[i].ik_enable.resize(end - begin);
+				for (int k = begin; k < end; k++)
+				{
+					ik_frames[i].ik_enable[k - begin].ik_name = ik_names[k];
+					ik_frames[i].ik_enable[k - begin].enable = ik_enables[k] != 0;
+				}
+			}
+			return true;
+		}
+
+	private:
+		/// LbV̐
+		enum BakedSectionId : uint32_t
+		{
+			SectionVersion = 1,
+			SectionModelName,
+			SectionBoneNames,
+			SectionBoneKeyOffsets = SectionBoneNames + 2,
+			SectionBoneKeyFrames,
+			SectionBoneKeyPositions,
+			SectionBoneKeyOrientations,
+			SectionBoneKeyInterpolations,
+			SectionBoneKeyCurves,
+			SectionFaceNames,
+			SectionFaceKeyOffsets = SectionFaceNames + 2,
+			SectionFaceKeyFrames,
+			SectionFaceKeyWeights,
+			SectionCameraFrames,
+			SectionCameraKeyCurves,
+			SectionLightFrames,
+			SectionIkRecords,
+			SectionIkNames,
+			SectionIkEnables = SectionIkNames + 2,
+			SectionCurves,
+		};
+
+		/// OA(id)ƁAOƂ̏I[̈ʒu(id+1)Ƃď
+		static void BakeNames(oguna::BakedWriter *writer, uint32_t id, const std::vector<std::string> &names)
+		{
+			std::string chars;
+			std::vector<uint32_t> ends;
+			for (auto &name : names)
+			{
+				chars += name;
+				ends.push_back((uint32_t) chars.size());
+			}
+			writer->Add(id, chars);
+			writer->Add(id + 1, ends);
+		}
+
+		static void BakeNames(oguna::BakedWriter *writer, uint32_t id, const oguna::StringPool &pool, const oguna::StringIdList &names)
+		{
+			std::vector<std::string> strings(names.Count());
+			for (int i = 0; i < names.Count(); i++)
+			{
+				strings[i] = pool.Get(names.Id(i));
+			}
+			BakeNames(writer, id, strings);
+		}
+
+		static bool LoadNames(const oguna::BakedFile &file, uint32_t id, std::vector<std::string> *names)
+		{
+			size_t char_count, count;
+			const char *chars = file.Section<char>(id, &char_count);
+			const uint32_t *ends = file.Section<uint32_t>(id + 1, &count);
+			if (chars == nullptr || ends == nullptr)
+			{
+				return false;
+			}
+			names->resize(count);
+			uint32_t begin = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				if (ends[i] < begin || ends[i] > char_count)
+				{
+					return false;
+				}
+				(*names)[i].assign(chars + begin, ends[i] - begin);
+				begin = ends[i];
+			}
+			return true;
+		}
+
+		/// ǂݍ񂾖Opoolɓo^
+		static bool LoadNames(const oguna::BakedFile &file, uint32_t id, oguna::StringPool *pool, oguna::StringIdList *names)
+		{
+			std::vector<std::string> strings;
+			if (!LoadNames(file, id, &strings))
+			{
+				return false;
+			}
+			names->Clear();
+			names->Reserve(strings.size());
+			for (auto &name : strings)
+			{
+				names->Push(pool->Intern(name));
+			}
+			return true;
+		}
+
+		/// gbNƂ̃L[̊Jnʒu0n܂Č炸AL[ŏI邩ǂ
+		static bool IsValidOffsets(const std::vector<int> &offsets, size_t track_count, size_t key_count)
+		{
+			if (offsets.size() != track_count + 1 || offsets.front() != 0 || (size_t) offsets.back() != key_count)
+			{
+				return false;
+			}
+			for (size_t t = 0; t < track_count; t++)
+			{
+				if (offsets[t] > offsets[t + 1])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/// ԋȐ̔ԍcountAׂĕ\͈͓̔ǂ
+		static bool IsValidCurves(const std::vector<int> &ids, size_t count, int curve_count)
+		{
+			if (ids.size() != count)
+			{
+				return false;
+			}
+			for (int id : ids)
+			{
+				if (id < 0 || id >= curve_count)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/// IKt[Ƃ̖O̊Jnʒu炸AO̐𒴂Ȃǂ
+		static bool IsValidIkRecords(const std::vector<int> &records, size_t name_count)
+		{
+			if (records.size() % 3 != 0)
+			{
+				return false;
+			}
+			int begin = 0;
+			for (size_t i = 2; i < records.size(); i += 3)
+			{
+				if (records[i] < begin || (size_t) records[i] > name_count)
+				{
+					return false;
+				}
+				begin = records[i];
+			}
+			return true;
+		}
+
+		static const size_t BoneRecordSize = 111;
+		static const size_t FaceRecordSize = 23;
+
+		friend class VmdCompressedMotion;
+
+		/// O̖O̕\(L̕\gƂnullptrARs[∳k[VƋL)
+		std::shared_ptr<oguna::StringPool> own_name_pool;
+		/// Oo^\
+		oguna::StringPool *name_pool;
+
+		/// 擪15oCgOA4oCgt[ԍ̃R[h𖼑OƂɂ܂Ƃ߂
+		/// Opoolɓo^namesɉAorderɂ̓gbNEt[ԍɕׂR[hԍ
+		static void GroupRecords(const char *records, size_t record_size, int count,
+			oguna::StringPool *pool, oguna::StringIdList *names,
+			std::vector<int> *offsets, std::vector<int> *order)
+		{
+			// 32rbgt[ԍA32rbgR[hԍɂבւp̃L[
+			// t[ԍ̃L[̓t@Cɕ
+			std::vector<uint64_t> keys(count);
+			std::vector<int> track_of(count);
+			std::vector<int> key_counts;
+			int last_track = -1;
+			const char *last_name = nullptr;
+			for (int i = 0; i < count; i++)
+			{
+				const char *name = records + i * record_size;
+				uint32_t frame;
+				memcpy(&frame, name + 15, sizeof(uint32_t));
+				keys[i] = ((uint64_t) frame << 32) | (uint32_t) i;
+				// {[̃L[͘AĂ邱Ƃ̂ŒO̖OƐɔׂ
+				if (last_name && memcmp(name, last_name, 15) == 0)
+				{
+					track_of[i] = last_track;
+					key_counts[last_track]++;
+					continue;
+				}
+				const char *terminal = (const char*) memchr(name, '\0', 15);
+				uint32_t id = pool->Intern(name, terminal ? terminal - name : 15);
+				int track = names->Find(id);
+				if (track < 0)
+				{
+					track = names->Push(id);
+					key_counts.push_back(0);
+				}
+				track_of[i] = track;
+				key_counts[track]++;
+				last_track = track;
+				last_name = name;
+			}
+
+			// gbNƂɐU蕪Ăt[ԍɕׂ
+			int track_count = names->Count();
+			std::vector<int> begin(track_count + 1, 0);
+			for (int t = 0; t < track_count; t++)
+			{
+				begin[t + 1] = begin[t] + key_counts[t];
+			}
+			std::vector<int> cursor(begin.begin(), begin.end() - 1);
+			std::vector<uint64_t> sorted(count);
+			for (int i = 0; i < count; i++)
+			{
+				sorted[cursor[track_of[i]]++] = keys[i];
+			}
+			order->clear();
+			order->reserve(count);
+			offsets->assign(1, 0);
+			for (int t = 0; t < track_count; t++)
+			{
+				auto first = sorted.begin() + begin[t];
+				auto last = sorted.begin() + begin[t + 1];
+				if (!std::is_sorted(first, last))
+				{
+					std::sort(first, last);
+				}
+				for (auto it = first; it != last; ++it)
+				{
+					if (it + 1 != last && (*it >> 32) == (*(it + 1) >> 32))
+					{
+						continue;
+					}
+					order->push_back((int) (uint32_t) *it);
+				}
+				offsets->push_back((int) order->size());
+			}
+		}
+
+		void BuildBoneTracks(const char *records, int count)
+		{
+			std::vector<int> order;
+			GroupRecords(records, BoneRecordSize, count, name_pool, &bone_names, &bone_key_offsets, &order);
+			size_t key_count = order.size();
+			bone_key_frames.resize(key_count);
+			bone_key_positions.resize(key_count * 3);
+			bone_key_orientations.resize(key_count * 4);
+			bone_key_interpolations.resize(key_count * 64);
+			for (size_t k = 0; k < key_count; k++)
+			{
+				const char *record = records + order[k] * BoneRecordSize;
+				memcpy(&bone_key_frames[k], record + 15, sizeof(uint32_t));
+				memcpy(&bone_key_positions[k * 3], record + 19, sizeof(float) * 3);
+				memcpy(&bone_key_orientations[k * 4], record + 31, sizeof(float) * 4);
+				memcpy(&bone_key_interpolations[k * 64], record + 47, sizeof(char) * 64);
+			}
+		}
+
+		void BuildFaceTracks(const char *records, int count)
+		{
+			std::vector<int> order;
+			GroupRecords(records, FaceRecordSize, count, name_pool, &face_names, &face_key_offsets, &order);
+			size_t key_count = order.size();
+			face_key_frames.resize(key_count);
+			face_key_weights.resize(key_count);
+			for (size_t k = 0; k < key_count; k++)
+			{
+				const char *record = records + order[k] * FaceRecordSize;
+				memcpy(&face_key_frames[k], record + 15, sizeof(uint32_t));
+				memcpy(&face_key_weights[k], record + 19, sizeof(float));
+			}
+		}
+
+		/// ԋȐ̕\
+		void BuildCurves()
+		{
+			curves.Clear();
+			size_t key_count = bone_key_frames.size();
+			bone_key_curves.resize(key_count * 4);
+			for (size_t k = 0; k < key_count; k++)
+			{
+				// 擪16oCgx1, y1, x2, y2̏X, Y, Z, ]̒l
+				const uint8_t *interpolation = (const uint8_t*) &bone_key_interpolations[k * 64];
+				for (int channel = 0; channel < 4; channel++)
+				{
+					bone_key_curves[k * 4 + channel] = curves.Add(interpolation[channel], interpolation[4 + channel], interpolation[8 + channel], interpolation[12 + channel]);
+				}
+			}
+			camera_key_curves.resize(camera_frames.size() * 6);
+			for (size_t k = 0; k < camera_frames.size(); k++)
+			{
+				// `lƂx1, x2, y1, y2̏ɕ
+				for (int channel = 0; channel < 6; channel++)
+				{
+					const uint8_t *c = (const uint8_t*) camera_frames[k].interpolation[channel];
+					camera_key_curves[k * 6 + channel] = curves.Add(c[0], c[2], c[1], c[3]);
+				}
+			}
+		}
+
+		void SortFrames()
+		{
+			auto by_frame = [](const auto &a, const auto &b) { return a.frame < b.frame; };
+			std::stable_sort(camera_frames.begin(), camera_frames.end(), by_frame);
+			std::stable_sort(light_frames.begin(), light_frames.end(), by_frame);
+			std::stable_sort(ik_frames.begin(), ik_frames.end(), by_frame);
+		}
+
+		static std::unique_ptr<VmdTrackMotion> ReadTracks(oguna::BinaryReader *reader, oguna::StringPool *name_pool)
+		{
+			auto result = std::make_unique<VmdTrackMotion>(name_pool);
+
+			// magic and version
+			const char *magic = reader->View(30);
+			if (strncmp(magic, "Vocaloid Motion Data", 20))
+			{
+				std::cerr << "invalid vmd file." << std::endl;
+				return nullptr;
+			}
+			result->version = std::atoi(std::string(magic + 20, 10).c_str());
+
+			// name
+			result->model_name = reader->ReadFixedString(20);
+
+			// bone frames
+			// Œ蒷R[h܂Ƃ߂ĎQƂAL[Ƃɕ炸ɃgbN֐U蕪
+			int bone_frame_num = reader->Read<int>();
+			if (bone_frame_num < 0)
+			{
+				throw "invalid bone frame count";
+			}
+			result->BuildBoneTracks(reader->View((size_t) bone_frame_num * BoneRecordSize), bone_frame_num);
+
+			// face frames
+			int face_frame_num = reader->Read<int>();
+			if (face_frame_num < 0)
+			{
+				throw "invalid face frame count";
+			}
+			result->BuildFaceTracks(reader->View((size_t) face_frame_num * FaceRecordSize), face_frame_num);
+
+			// camera frames
+			int camera_frame_num = reader->Read<int>();
+			result->camera_frames.resize(camera_frame_num);
+			for (int i = 0; i < camera_frame_num; i++)
+			{
+				result->camera_frames[i].Read(reader);
+			}
+
+			// light frames
+			int light_frame_num = reader->Read<int>();
+			result->light_frames.resize(light_frame_num);
+			for (int i = 0; i < light_frame_num; i++)
+			{
+				result->light_frames[i].Read(reader);
+			}
+
+			// unknown2
+			if (!reader->Eof())
+			{
+				reader->Skip(4);
+			}
+
+			// ik frames
+			if (!reader->Eof())
+			{
+				int ik_num = reader->Read<int>();
+				result->ik_frames.resize(ik_num);
+				for (int i = 0; i < ik_num; i++)
+				{
+					result->ik_frames[i].Read(reader);
+				}
+			}
+
+			result->SortFrames();
+			result->BuildCurves();
+			return result;
+		}
+	};
+}
\ No newline at end of file